@@ -0,0 +1,84 @@
+/**
+ * \file bench/connect/main.cpp
+ * \brief Measures the startup cost of a channel: construct + connect, then disconnect + destroy.
+ *
+ * Usage: bench-connect [loops = 1000]
+ *
+ * Each case is timed in a loop, the results are printed in microseconds.
+ * - cold: nobody else has the channel, so the segments are created and removed each time.
+ * - warm: a peer keeps the channel alive, so the segments are only opened and closed.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "libipc/ipc.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+struct result_t {
+    double connect_;
+    double disconnect_;
+};
+
+void report(char const *title, std::vector<result_t> &rs) {
+    auto print = [title](char const *phase, std::vector<double> &v) {
+        std::sort(v.begin(), v.end());
+        double sum = 0;
+        for (double d : v) sum += d;
+        std::printf("%-24s %-10s avg %9.2f  p50 %9.2f  p99 %9.2f  max %9.2f\n", title, phase,
+                    sum / v.size(), v[v.size() / 2], v[v.size() * 99 / 100], v.back());
+    };
+    std::vector<double> con, dis;
+    for (auto const &r : rs) {
+        con.push_back(r.connect_);
+        dis.push_back(r.disconnect_);
+    }
+    print("connect", con);
+    print("disconnect", dis);
+}
+
+double us_since(steady_clock::time_point tp) {
+    return std::chrono::duration<double, std::micro>(steady_clock::now() - tp).count();
+}
+
+void run(char const *title, std::size_t loops, unsigned mode) {
+    std::vector<result_t> rs;
+    rs.reserve(loops);
+    char const *name = "bench-connect";
+    for (std::size_t i = 0; i < loops; ++i) {
+        auto tp = steady_clock::now();
+        auto *ch = new ipc::channel{name, mode};
+        result_t r;
+        r.connect_ = us_since(tp);
+        tp = steady_clock::now();
+        delete ch;
+        r.disconnect_ = us_since(tp);
+        rs.push_back(r);
+    }
+    report(title, rs);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::size_t loops = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000;
+    if (loops == 0) return -1;
+
+    // The last one closing the channel removes its storage.
+    ipc::channel::clear_storage("bench-connect");
+    run("cold sender",   loops, ipc::sender);
+    run("cold receiver", loops, ipc::receiver);
+    {
+        ipc::channel peer {"bench-connect", ipc::receiver | ipc::sender};
+        run("warm sender",   loops, ipc::sender);
+        run("warm receiver", loops, ipc::receiver);
+    }
+    return 0;
+}
@@ -0,0 +1,354 @@
+/**
+ * \file bench/ipc/main.cpp
+ * \brief Measures the throughput and latency of the channels, and prints the results as JSON.
+ *
+ * Usage: bench-ipc [options]
+ *   --kind      route,channel,unicast   the channels to measure (all by default)
+ *   --mode      thread,process          run the peers as threads, or as forked processes (all by default)
+ *   --sizes     8,64,...                message sizes in bytes
+ *   --receivers 1,2,...                 receiver counts
+ *   --producers 1,2,...                 producer counts (only a channel has more than 1)
+ *   --bytes     N                       about how many bytes are received per case (256 MB by default)
+ *   --quick                             a small matrix, for a smoke test
+ *   --perf                              count cycles, instructions, cache misses, context switches
+ *                                       and futex calls by perf_event_open (Linux only)
+ *
+ * Without the size / receiver / producer options, each kind runs a size sweep with 1 producer & 1 receiver,
+ * a receiver sweep and a producer sweep at 64 B.
+ * The senders block when the queue is full ('ipc::backpressure::block'), so every receiver gets every message.
+ * The latency is stamped at send (see 'trace_latency'), so it includes waiting for free space under full load.
+ * The perf counters are reported per message sent, summed over all the peers (and the waiting parent),
+ * from the start signal until the last receiver is done; a counter unavailable here is null.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BENCH_IPC_FORK
+#endif
+
+#include "libipc/ipc.h"
+#include "libipc/shm.h"
+
+#include "perf_counters.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+using unicast = ipc::chan<ipc::relat::single, ipc::relat::single, ipc::trans::unicast>;
+
+/* Shared by all the peers of a case, it lives in shared memory for the forked ones. */
+struct control_t {
+    std::atomic<unsigned> ready;
+    std::atomic<unsigned> done;
+    std::atomic<bool>     go;
+    std::atomic<bool>     quit;
+};
+
+struct case_t {
+    std::string kind;
+    bool        process;
+    std::size_t size;
+    std::size_t producers;
+    std::size_t receivers;
+    std::size_t count; // messages of each producer
+    bool        perf;
+};
+
+struct options {
+    std::vector<std::string> kinds {"route", "channel", "unicast"};
+    std::vector<bool>        modes {false, true};
+    std::vector<std::size_t> sizes, receivers, producers;
+    std::size_t              bytes = 256 * 1024 * 1024;
+    bool                     quick = false;
+    bool                     perf  = false;
+};
+
+std::vector<std::size_t> parse_list(char const *s) {
+    std::vector<std::size_t> v;
+    for (char *end; *s != '\0'; s = end) {
+        v.push_back(std::strtoull(s, &end, 10));
+        if (*end == ',') ++end;
+        else if (*end != '\0') return {};
+    }
+    return v;
+}
+
+std::vector<std::string> parse_names(char const *s) {
+    std::vector<std::string> v;
+    std::string cur;
+    for (; ; ++s) {
+        if ((*s == ',') || (*s == '\0')) {
+            if (!cur.empty()) v.push_back(cur);
+            cur.clear();
+            if (*s == '\0') break;
+        }
+        else cur.push_back(*s);
+    }
+    return v;
+}
+
+template <typename Chan>
+void receiver_main(control_t *ctl, char const *name, std::size_t expected) {
+    Chan ch {name, ipc::receiver};
+    ctl->ready.fetch_add(1, std::memory_order_release);
+    std::size_t got = 0;
+    while ((got < expected) && !ctl->quit.load(std::memory_order_acquire)) {
+        if (!ch.recv(100).empty()) ++got;
+    }
+    ctl->done.fetch_add(1, std::memory_order_release);
+    while (!ctl->quit.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+template <typename Chan>
+void sender_main(control_t *ctl, char const *name, case_t const &c) {
+    Chan ch {name, ipc::sender};
+    ch.backpressure(ipc::backpressure::block);
+    ch.trace_latency();
+    ch.wait_for_recv(c.receivers);
+    std::vector<char> buf(c.size, 'x');
+    ctl->ready.fetch_add(1, std::memory_order_release);
+    while (!ctl->go.load(std::memory_order_acquire)) std::this_thread::yield();
+    for (std::size_t i = 0; (i < c.count) && !ctl->quit.load(std::memory_order_relaxed); ++i) {
+        ch.send(buf.data(), buf.size());
+    }
+    while (!ctl->quit.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+long run_id() {
+#if defined(BENCH_IPC_FORK)
+    return static_cast<long>(::getpid());
+#else
+    return static_cast<long>(std::chrono::system_clock::now().time_since_epoch().count() % 1000000);
+#endif
+}
+
+/* Starts a peer as a thread, or as a forked process. */
+template <typename F>
+void spawn(bool process, std::vector<std::thread> &threads, std::vector<long> &children, F &&f) {
+#if defined(BENCH_IPC_FORK)
+    if (process) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            f();
+            ::_exit(0);
+        }
+        children.push_back(static_cast<long>(pid));
+        return;
+    }
+#endif
+    threads.emplace_back(std::forward<F>(f));
+}
+
+template <typename Chan>
+bool run(case_t const &c, std::size_t index, bool first) {
+    // A name of its own for each run, in case a killed run left some segments behind.
+    std::string name = "bench-ipc-" + std::to_string(run_id()) + "-" + std::to_string(index);
+    ipc::shm::handle ctl_shm {(name + "-ctl").c_str(), sizeof(control_t)};
+    auto *ctl = static_cast<control_t *>(ctl_shm.get());
+    if (ctl == nullptr) return false;
+    ctl->ready.store(0);
+    ctl->done .store(0);
+    ctl->go   .store(false);
+    ctl->quit .store(false);
+
+    // Opened before the peers are started, to be inherited by them.
+    bench::perf_counters perf;
+    bool has_perf = c.perf && perf.open();
+
+    std::vector<std::thread> threads;
+    std::vector<long> children;
+    std::size_t expected = c.producers * c.count;
+    for (std::size_t i = 0; i < c.receivers; ++i) {
+        spawn(c.process, threads, children, [ctl, &name, expected] {
+            receiver_main<Chan>(ctl, name.c_str(), expected);
+        });
+    }
+    for (std::size_t i = 0; i < c.producers; ++i) {
+        spawn(c.process, threads, children, [ctl, &name, &c] {
+            sender_main<Chan>(ctl, name.c_str(), c);
+        });
+    }
+
+    // Times from all the peers ready, until all the receivers are done.
+    auto deadline = steady_clock::now() + std::chrono::seconds(60);
+    bool timeout = false;
+    auto wait_for = [&](std::atomic<unsigned> &n, std::size_t target) {
+        while (n.load(std::memory_order_acquire) < target) {
+            if (steady_clock::now() > deadline) {
+                timeout = true;
+                return;
+            }
+            std::this_thread::yield();
+        }
+    };
+    wait_for(ctl->ready, c.receivers + c.producers);
+    if (has_perf) perf.enable();
+    auto tp = steady_clock::now();
+    ctl->go.store(true, std::memory_order_release);
+    wait_for(ctl->done, c.receivers);
+    double secs = std::chrono::duration<double>(steady_clock::now() - tp).count();
+    if (has_perf) perf.disable();
+
+    // Reads the counters before the peers close the channel.
+    ipc::chan_stats st {};
+    Chan::stats(name.c_str(), st);
+    ctl->quit.store(true, std::memory_order_release);
+    for (auto &t : threads) t.join();
+#if defined(BENCH_IPC_FORK)
+    for (auto pid : children) ::waitpid(static_cast<pid_t>(pid), nullptr, 0);
+#endif
+
+    // The messages really received by each receiver if timed out.
+    double msgs = timeout ? static_cast<double>(st.msgs_recv) / static_cast<double>(c.receivers)
+                          : static_cast<double>(expected);
+    std::printf("%s\n  {\"kind\": \"%s\", \"mode\": \"%s\", \"size\": %zu, \"producers\": %zu, \"receivers\": %zu, "
+                "\"messages\": %zu, \"seconds\": %.6f, \"msgs_per_sec\": %.1f, \"mib_per_sec\": %.2f, "
+                "\"latency_ns\": {\"count\": %llu, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu}, "
+                "\"timeout\": %s",
+                first ? "" : ",", c.kind.c_str(), c.process ? "process" : "thread",
+                c.size, c.producers, c.receivers, expected, secs,
+                msgs / secs, msgs * static_cast<double>(c.size) / secs / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(st.latency.count),
+                static_cast<unsigned long long>(st.latency.p50_ns),
+                static_cast<unsigned long long>(st.latency.p99_ns),
+                static_cast<unsigned long long>(st.latency.p999_ns),
+                static_cast<unsigned long long>(st.latency.max_ns),
+                timeout ? "true" : "false");
+    if (c.perf) {
+        double sent = timeout ? static_cast<double>(st.msgs_sent) : static_cast<double>(expected);
+        std::printf(", \"perf_per_msg\": {");
+        for (std::size_t i = 0; i < bench::perf_counters::count; ++i) {
+            std::printf("%s\"%s\": ", (i == 0) ? "" : ", ", bench::perf_counters::name_of(i));
+            if (has_perf && perf.valid(i) && (sent > 0)) {
+                std::printf("%.3f", static_cast<double>(perf.value(i)) / sent);
+            } else {
+                std::printf("null");
+            }
+        }
+        std::printf("}");
+    }
+    std::printf("}");
+    std::fflush(stdout);
+    ctl_shm.clear();
+    return !timeout;
+}
+
+bool run(case_t const &c, std::size_t index, bool first) {
+    std::fprintf(stderr, "[%zu] %s %s: size %zu, producers %zu, receivers %zu, messages %zu\n", index,
+                 c.kind.c_str(), c.process ? "process" : "thread", c.size, c.producers, c.receivers, c.count);
+    if (c.kind == "route")   return run<ipc::route>  (c, index, first);
+    if (c.kind == "channel") return run<ipc::channel>(c, index, first);
+    return run<unicast>(c, index, first);
+}
+
+std::vector<case_t> make_cases(options const &opt) {
+    std::vector<std::size_t> all_sizes {8, 64, 256, 1024, 4096, 16384, 65536, 1024 * 1024, 16 * 1024 * 1024};
+    std::vector<std::size_t> all_recvs {1, 2, 4, 8, 16, 32};
+    std::vector<std::size_t> all_prods {1, 2, 4, 8};
+    if (opt.quick) {
+        all_sizes = {8, 4096, 1024 * 1024};
+        all_recvs = {1, 4};
+        all_prods = {1, 4};
+    }
+    bool custom = !opt.sizes.empty() || !opt.receivers.empty() || !opt.producers.empty();
+    auto pick = [](std::vector<std::size_t> const &v, std::size_t def) {
+        return v.empty() ? std::vector<std::size_t>{def} : v;
+    };
+    std::vector<case_t> cases;
+    auto add = [&](std::string const &kind, bool process, std::size_t size, std::size_t p, std::size_t r) {
+        // a route has a single producer, a unicast channel a single receiver as well
+        if ((kind != "channel") && (p > 1)) return;
+        if ((kind == "unicast") && (r > 1)) return;
+        // every message sent is received r times
+        std::size_t count = (std::max)(std::size_t(16), (std::min)(std::size_t(200000), opt.bytes / size / (p * r)));
+        if (opt.quick) count = (std::min)(count, std::size_t(10000));
+        cases.push_back({kind, process, size, p, r, count, opt.perf});
+    };
+    for (auto const &kind : opt.kinds) {
+        for (bool process : opt.modes) {
+            if (custom) {
+                for (auto size : pick(opt.sizes, 64))
+                for (auto p : pick(opt.producers, 1))
+                for (auto r : pick(opt.receivers, 1)) add(kind, process, size, p, r);
+                continue;
+            }
+            for (auto size : all_sizes) add(kind, process, size, 1, 1);
+            for (auto r : all_recvs) if (r > 1) add(kind, process, 64, 1, r);
+            for (auto p : all_prods) if (p > 1) add(kind, process, 64, p, 1);
+        }
+    }
+    return cases;
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: bench-ipc [--kind route,channel,unicast] [--mode thread,process] "
+                         "[--sizes 8,64,...] [--receivers 1,2,...] [--producers 1,2,...] [--bytes N] [--quick] [--perf]\n");
+    return -1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        auto arg = [&]() -> char const * { return (i + 1 < argc) ? argv[++i] : ""; };
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            opt.quick = true;
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            opt.perf = true;
+        } else if (std::strcmp(argv[i], "--kind") == 0) {
+            opt.kinds = parse_names(arg());
+        } else if (std::strcmp(argv[i], "--mode") == 0) {
+            opt.modes.clear();
+            for (auto const &m : parse_names(arg())) {
+                if (m == "thread") opt.modes.push_back(false);
+                else if (m == "process") opt.modes.push_back(true);
+                else return usage();
+            }
+        } else if (std::strcmp(argv[i], "--sizes") == 0) {
+            if ((opt.sizes = parse_list(arg())).empty()) return usage();
+        } else if (std::strcmp(argv[i], "--receivers") == 0) {
+            if ((opt.receivers = parse_list(arg())).empty()) return usage();
+        } else if (std::strcmp(argv[i], "--producers") == 0) {
+            if ((opt.producers = parse_list(arg())).empty()) return usage();
+        } else if (std::strcmp(argv[i], "--bytes") == 0) {
+            opt.bytes = std::strtoull(arg(), nullptr, 10);
+        } else {
+            return usage();
+        }
+    }
+#if !defined(BENCH_IPC_FORK)
+    opt.modes.erase(std::remove(opt.modes.begin(), opt.modes.end(), true), opt.modes.end());
+#endif
+    for (auto const &k : opt.kinds) {
+        if ((k != "route") && (k != "channel") && (k != "unicast")) return usage();
+    }
+    for (auto s : opt.sizes) if (s == 0) return usage();
+    for (auto r : opt.receivers) if ((r == 0) || (r > 32)) return usage();
+    for (auto p : opt.producers) if (p == 0) return usage();
+
+    auto cases = make_cases(opt);
+    std::printf("{\"hardware_concurrency\": %u, \"results\": [", std::thread::hardware_concurrency());
+    bool ok = true;
+    for (std::size_t i = 0; i < cases.size(); ++i) {
+        ok = run(cases[i], i, i == 0) && ok;
+    }
+    std::printf("\n]}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/**
+ * \file bench/ipc/perf_counters.h
+ * \brief Hardware & software counters of a benchmark case, by perf_event_open (Linux only).
+ *
+ * The counters are opened by the parent before any peer is started, and are inherited
+ * by the peer threads and the forked peer processes, so they sum up the whole case.
+ * A counter the kernel refuses (no PMU in a VM, perf_event_paranoid, no tracefs) is reported as null.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+class perf_counters {
+public:
+    enum : std::size_t {
+        cycles,
+        instructions,
+        cache_misses,
+        context_switches,
+        futex_calls,
+        count
+    };
+
+    static char const *name_of(std::size_t i) noexcept {
+        static char const *names[count] = {
+            "cycles", "instructions", "cache_misses", "context_switches", "futex_calls"
+        };
+        return names[i];
+    }
+
+private:
+    int           fds_   [count];
+    std::uint64_t values_[count];
+
+#if defined(__linux__)
+    /* The id of the tracepoint syscalls:sys_enter_futex, or -1. */
+    static long long futex_tracepoint() noexcept {
+        for (char const *path : {"/sys/kernel/tracing/events/syscalls/sys_enter_futex/id",
+                                 "/sys/kernel/debug/tracing/events/syscalls/sys_enter_futex/id"}) {
+            std::FILE *fp = std::fopen(path, "r");
+            if (fp == nullptr) continue;
+            long long id = -1;
+            if (std::fscanf(fp, "%lld", &id) != 1) id = -1;
+            std::fclose(fp);
+            if (id >= 0) return id;
+        }
+        return -1;
+    }
+
+    static int open_event(std::uint32_t type, std::uint64_t config) noexcept {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = type;
+        attr.config         = config;
+        attr.disabled       = 1;
+        attr.inherit        = 1;
+        attr.exclude_hv     = 1;
+        attr.exclude_kernel = (type == PERF_TYPE_HARDWARE) ? 1 : 0;
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0 /*this process*/, -1, -1, 0));
+    }
+#endif
+
+public:
+    perf_counters() noexcept {
+        for (auto &fd : fds_) fd = -1;
+        for (auto &v : values_) v = 0;
+    }
+
+    ~perf_counters() noexcept {
+        close();
+    }
+
+    perf_counters(perf_counters const &) = delete;
+    perf_counters &operator=(perf_counters const &) = delete;
+
+    /* Must be called before the peers are started, to have them inherit the counters. */
+    bool open() noexcept {
+        close();
+#if defined(__linux__)
+        fds_[cycles]           = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds_[instructions]     = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds_[cache_misses]     = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds_[context_switches] = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+        auto futex = futex_tracepoint();
+        if (futex >= 0) {
+            fds_[futex_calls]  = open_event(PERF_TYPE_TRACEPOINT, static_cast<std::uint64_t>(futex));
+        }
+#endif
+        for (int fd : fds_) if (fd >= 0) return true;
+        return false;
+    }
+
+    void close() noexcept {
+        for (auto &fd : fds_) {
+#if defined(__linux__)
+            if (fd >= 0) ::close(fd);
+#endif
+            fd = -1;
+        }
+    }
+
+    bool valid(std::size_t i) const noexcept {
+        return fds_[i] >= 0;
+    }
+
+    /* Enabling or disabling a counter applies to the inherited ones as well. */
+    void enable() noexcept {
+#if defined(__linux__)
+        for (int fd : fds_) {
+            if (fd < 0) continue;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /* Stops counting and reads the values, which include the peers still alive. */
+    void disable() noexcept {
+#if defined(__linux__)
+        for (std::size_t i = 0; i < count; ++i) {
+            values_[i] = 0;
+            if (fds_[i] < 0) continue;
+            ::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            std::uint64_t v = 0;
+            if (::read(fds_[i], &v, sizeof(v)) == static_cast<ssize_t>(sizeof(v))) values_[i] = v;
+        }
+#endif
+    }
+
+    std::uint64_t value(std::size_t i) const noexcept {
+        return values_[i];
+    }
+};
+
+} // namespace bench
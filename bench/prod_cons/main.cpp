@@ -0,0 +1,282 @@
+/**
+ * \file bench/prod_cons/main.cpp
+ * \brief Measures the ring algorithms ('prod_cons_impl' over 'circ::elem_array') on their own,
+ *        without the waiters, fragmenting and buffers of the channels.
+ *
+ * Usage: bench-prod-cons [options]
+ *   --flag      ssu,smu,mmu,smb,mmb   the specializations to measure (all by default),
+ *                                     s/m: single/multi producer & consumer, u/b: unicast/broadcast
+ *   --producers 1,2,...               producer counts, the single-producer ones only run 1 (1,2,4,8 by default)
+ *   --consumers 1,2,...               consumer counts, ssu only runs 1 (1,2,4,8 by default)
+ *   --count     N                     messages of each producer (1000000 by default)
+ *   --shm                             places the ring in shared memory, instead of on the heap
+ *
+ * Every peer is a thread, spinning with 'std::this_thread::yield' while the ring is full or empty.
+ * For each case it prints:
+ * - ns/msg: the elapsed time per message pushed, over all the producers;
+ * - push_retry / pop_retry: the retries of the CAS loops per operation (see 'LIBIPC_PROD_CONS_RETRY');
+ * - full / empty: the failed pushes & pops per successful one.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct retry_counts {
+    std::uint64_t push;
+    std::uint64_t push_n;
+    std::uint64_t force_push;
+    std::uint64_t pop;
+};
+
+thread_local retry_counts retries__ {};
+
+} // namespace
+
+#define LIBIPC_PROD_CONS_RETRY(op) (++retries__.op)
+
+#include "libipc/queue.h"
+#include "libipc/policy.h"
+#include "libipc/shm.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+struct msg_t {
+    std::uint32_t producer;
+    std::uint32_t seq;
+
+    msg_t() = default;
+    msg_t(std::uint32_t p, std::uint32_t s) : producer(p), seq(s) {}
+};
+
+struct options {
+    std::vector<std::string> flags {"ssu", "smu", "mmu", "smb", "mmb"};
+    std::vector<std::size_t> producers {1, 2, 4, 8};
+    std::vector<std::size_t> consumers {1, 2, 4, 8};
+    std::size_t              count = 1000000;
+    bool                     shm   = false;
+};
+
+struct result_t {
+    double        secs;
+    std::uint64_t pushes, pops;
+    std::uint64_t push_retries, pop_retries;
+    std::uint64_t fulls, empties;
+    bool          ok;
+};
+
+std::vector<std::size_t> parse_list(char const *s) {
+    std::vector<std::size_t> v;
+    for (char *end; *s != '\0'; s = end) {
+        v.push_back(std::strtoull(s, &end, 10));
+        if (*end == ',') ++end;
+        else if (*end != '\0') return {};
+    }
+    return v;
+}
+
+std::vector<std::string> parse_names(char const *s) {
+    std::vector<std::string> v;
+    std::string cur;
+    for (; ; ++s) {
+        if ((*s == ',') || (*s == '\0')) {
+            if (!cur.empty()) v.push_back(cur);
+            cur.clear();
+            if (*s == '\0') break;
+        }
+        else cur.push_back(*s);
+    }
+    return v;
+}
+
+/* The ring on the heap, or in a shared memory segment. */
+template <typename Elems>
+class ring_storage {
+    std::unique_ptr<Elems> heap_;
+    ipc::shm::handle       shm_;
+
+public:
+    Elems *make(bool shm, char const *name) {
+        if (!shm) {
+            heap_.reset(new Elems);
+            return heap_.get();
+        }
+        // constructed anew, in case a killed run left the segment behind
+        if (!shm_.acquire(name, sizeof(Elems))) return nullptr;
+        return ::new (shm_.get()) Elems;
+    }
+
+    ~ring_storage() {
+        shm_.clear();
+    }
+};
+
+template <typename Flag>
+result_t run(options const &opt, std::size_t producers, std::size_t consumers, std::string const &name) {
+    using queue_t = ipc::queue<msg_t, ipc::policy::choose<ipc::circ::elem_array, Flag>>;
+    constexpr bool broadcast = ipc::relat_trait<Flag>::is_broadcast;
+
+    result_t res {};
+    ring_storage<typename queue_t::elems_t> storage;
+    auto *elems = storage.make(opt.shm, name.c_str());
+    if (elems == nullptr) return res;
+
+    // Every thread has its own queue object over the same ring, the way the processes would have.
+    std::vector<std::unique_ptr<queue_t>> readers;
+    for (std::size_t i = 0; i < consumers; ++i) {
+        readers.emplace_back(new queue_t{elems});
+        if (!readers.back()->connect()) return res;
+    }
+
+    std::size_t total = producers * opt.count;
+    std::atomic<std::size_t> consumed {0}; // for unicast, the consumers share the messages
+    std::atomic<unsigned> ready {0};
+    std::atomic<bool> go {false};
+    std::atomic<std::uint64_t> pushes {0}, pops {0}, push_retries {0}, pop_retries {0}, fulls {0}, empties {0};
+    std::atomic<bool> bad {false};
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < consumers; ++i) {
+        threads.emplace_back([&, i] {
+            auto &que = *readers[i];
+            std::vector<std::uint32_t> next(producers, 0); // the order of each producer is kept
+            std::uint64_t got = 0, empty = 0;
+            ready.fetch_add(1, std::memory_order_release);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            retries__ = {};
+            msg_t msg;
+            for (;;) {
+                if (broadcast ? (got >= total) : (consumed.load(std::memory_order_relaxed) >= total)) break;
+                if (!que.pop(msg)) {
+                    ++empty;
+                    std::this_thread::yield();
+                    continue;
+                }
+                ++got;
+                if (broadcast && (msg.seq != next[msg.producer]++)) bad.store(true, std::memory_order_relaxed);
+                if (!broadcast) consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+            pops        .fetch_add(got, std::memory_order_relaxed);
+            empties     .fetch_add(empty, std::memory_order_relaxed);
+            pop_retries .fetch_add(retries__.pop, std::memory_order_relaxed);
+        });
+    }
+    for (std::size_t i = 0; i < producers; ++i) {
+        threads.emplace_back([&, i] {
+            queue_t que {elems};
+            bool can_send = que.ready_sending();
+            std::uint64_t full = 0;
+            ready.fetch_add(1, std::memory_order_release);
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            if (!can_send) {
+                bad.store(true, std::memory_order_relaxed);
+                return;
+            }
+            retries__ = {};
+            for (std::uint32_t n = 0; n < opt.count; ++n) {
+                while (!que.push([](void *) { return true; }, static_cast<std::uint32_t>(i), n)) {
+                    ++full;
+                    std::this_thread::yield();
+                }
+            }
+            que.shut_sending();
+            pushes      .fetch_add(opt.count, std::memory_order_relaxed);
+            fulls       .fetch_add(full, std::memory_order_relaxed);
+            push_retries.fetch_add(retries__.push, std::memory_order_relaxed);
+        });
+    }
+
+    while (ready.load(std::memory_order_acquire) < producers + consumers) std::this_thread::yield();
+    auto tp = steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto &t : threads) t.join();
+    res.secs         = std::chrono::duration<double>(steady_clock::now() - tp).count();
+    res.pushes       = pushes;
+    res.pops         = pops;
+    res.push_retries = push_retries;
+    res.pop_retries  = pop_retries;
+    res.fulls        = fulls;
+    res.empties      = empties;
+    res.ok           = !bad && (res.pops == (broadcast ? total * consumers : total));
+    return res;
+}
+
+double per(std::uint64_t n, std::uint64_t d) {
+    return (d == 0) ? 0 : static_cast<double>(n) / static_cast<double>(d);
+}
+
+template <typename Flag>
+void run_flag(options const &opt, char const *flag) {
+    using trait = ipc::relat_trait<Flag>;
+    for (auto p : opt.producers) {
+        if (!trait::is_multi_producer && (p > 1)) continue;
+        for (auto c : opt.consumers) {
+            if (!trait::is_multi_consumer && (c > 1)) continue;
+            auto name = "bench-prod-cons-" + std::string(flag);
+            auto res = run<Flag>(opt, p, c, name);
+            std::printf("%-4s %9zu %9zu %10.2f %12.1f %11.4f %11.4f %9.3f %9.3f %s\n", flag, p, c,
+                        res.secs * 1e9 / static_cast<double>(p * opt.count),
+                        per(res.pushes, 1) / res.secs,
+                        per(res.push_retries, res.pushes), per(res.pop_retries, res.pops),
+                        per(res.fulls, res.pushes), per(res.empties, res.pops),
+                        res.ok ? "" : "(FAILED)");
+            std::fflush(stdout);
+        }
+    }
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: bench-prod-cons [--flag ssu,smu,mmu,smb,mmb] [--producers 1,2,...] "
+                         "[--consumers 1,2,...] [--count N] [--shm]\n");
+    return -1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        auto arg = [&]() -> char const * { return (i + 1 < argc) ? argv[++i] : ""; };
+        if (std::strcmp(argv[i], "--shm") == 0) {
+            opt.shm = true;
+        } else if (std::strcmp(argv[i], "--flag") == 0) {
+            opt.flags = parse_names(arg());
+        } else if (std::strcmp(argv[i], "--producers") == 0) {
+            if ((opt.producers = parse_list(arg())).empty()) return usage();
+        } else if (std::strcmp(argv[i], "--consumers") == 0) {
+            if ((opt.consumers = parse_list(arg())).empty()) return usage();
+        } else if (std::strcmp(argv[i], "--count") == 0) {
+            if ((opt.count = std::strtoull(arg(), nullptr, 10)) == 0) return usage();
+        } else {
+            return usage();
+        }
+    }
+    for (auto p : opt.producers) if (p == 0) return usage();
+    for (auto c : opt.consumers) if ((c == 0) || (c > 32)) return usage();
+
+    using namespace ipc;
+    std::printf("ring on the %s, %zu messages of %zu bytes per producer\n",
+                opt.shm ? "shared memory" : "heap", opt.count, sizeof(msg_t));
+    std::printf("%-4s %9s %9s %10s %12s %11s %11s %9s %9s\n", "flag", "producers", "consumers",
+                "ns/msg", "msgs/s", "push_retry", "pop_retry", "full", "empty");
+    for (auto const &f : opt.flags) {
+        if      (f == "ssu") run_flag<wr<relat::single, relat::single, trans::unicast  >>(opt, "ssu");
+        else if (f == "smu") run_flag<wr<relat::single, relat::multi , trans::unicast  >>(opt, "smu");
+        else if (f == "mmu") run_flag<wr<relat::multi , relat::multi , trans::unicast  >>(opt, "mmu");
+        else if (f == "smb") run_flag<wr<relat::single, relat::multi , trans::broadcast>>(opt, "smb");
+        else if (f == "mmb") run_flag<wr<relat::multi , relat::multi , trans::broadcast>>(opt, "mmb");
+        else return usage();
+    }
+    return 0;
+}
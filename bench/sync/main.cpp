@@ -0,0 +1,315 @@
+/**
+ * \file bench/sync/main.cpp
+ * \brief Measures the cross-process sync primitives the waiters are built on, backend by backend.
+ *
+ * Usage: bench-sync [loops = 2000]
+ *
+ * The backends:
+ * - a0:          ipc::sync::mutex / condition (robust priority-inheritance futexes on Linux),
+ *                and ipc::sync::semaphore (a named POSIX semaphore); "libipc" on the other platforms;
+ * - posix:       the way the POSIX backend sets them up, a robust process-shared pthread mutex,
+ *                a process-shared pthread condition, and an unnamed process-shared semaphore;
+ * - posix-plain: the same, except the mutex is not robust.
+ *
+ * The cases:
+ * - mutex.uncontended: lock + unlock in one process, the mean in ns;
+ * - mutex.handoff:     a forked process blocked in lock, from the unlock of the owner until it returns;
+ * - condition.wake:    a forked process waiting, from notify until the wait returns with the mutex;
+ * - semaphore.wake:    a forked process blocked in wait, from post until the wait returns.
+ * The wakeups are timed by the steady clock of both processes, the quantiles are in ns.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "libipc/imp/detect_plat.h"
+
+#if !defined(LIBIPC_OS_WIN)
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "libipc/mutex.h"
+#include "libipc/condition.h"
+#include "libipc/semaphore.h"
+#include "libipc/shm.h"
+
+#include "libipc/utility/log_histogram.h"
+
+namespace {
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/* Gives the peer enough time to block. */
+void settle() {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+void spin_until(std::atomic<std::uint32_t> const &v, std::uint32_t expected) {
+    while (v.load(std::memory_order_acquire) != expected) std::this_thread::yield();
+}
+
+/* Shared by the two processes of a case. */
+struct control_t {
+    std::atomic<std::uint32_t> phase;
+    std::atomic<std::uint32_t> waiting;
+    std::atomic<std::uint32_t> signaled;
+    std::atomic<std::uint32_t> done;
+    std::atomic<std::uint64_t> t0;
+    std::atomic<std::uint64_t> sum;
+    ipc::log_histogram         hist;
+};
+
+/* The primitives of the library, opened by name in each process. */
+class a0_backend {
+    ipc::sync::mutex     mtx_;
+    ipc::sync::condition cnd_;
+    ipc::sync::semaphore sem_;
+
+public:
+    static char const *name() noexcept {
+#if defined(LIBIPC_OS_LINUX)
+        return "a0";
+#else
+        return "libipc";
+#endif
+    }
+
+    bool create(std::string const &prefix) {
+        return open(prefix);
+    }
+
+    bool open(std::string const &prefix) {
+        return mtx_.open((prefix + "-mtx").c_str())
+            && cnd_.open((prefix + "-cnd").c_str())
+            && sem_.open((prefix + "-sem").c_str(), 0);
+    }
+
+    void lock()     { mtx_.lock(); }
+    void unlock()   { mtx_.unlock(); }
+    void wait()     { cnd_.wait(mtx_); }
+    void notify()   { cnd_.notify(mtx_); }
+    void post()     { sem_.post(); }
+    void sem_wait() { sem_.wait(); }
+};
+
+/* Process-shared pthread objects placed in a segment, set up like the POSIX backend does. */
+template <bool Robust>
+class posix_backend {
+    struct block_t {
+        pthread_mutex_t mtx;
+        pthread_cond_t  cnd;
+        sem_t           sem;
+    };
+
+    ipc::shm::handle shm_;
+    block_t *blk_ = nullptr;
+
+public:
+    static char const *name() noexcept { return Robust ? "posix" : "posix-plain"; }
+
+    bool create(std::string const &prefix) {
+        if (!open(prefix)) return false;
+        pthread_mutexattr_t ma;
+        pthread_mutexattr_init(&ma);
+        pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+        if (Robust) pthread_mutexattr_setrobust(&ma, PTHREAD_MUTEX_ROBUST);
+        int eno = pthread_mutex_init(&blk_->mtx, &ma);
+        pthread_mutexattr_destroy(&ma);
+        pthread_condattr_t ca;
+        pthread_condattr_init(&ca);
+        pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+        eno = eno || pthread_cond_init(&blk_->cnd, &ca);
+        pthread_condattr_destroy(&ca);
+        return (eno == 0) && (sem_init(&blk_->sem, 1, 0) == 0);
+    }
+
+    bool open(std::string const &prefix) {
+        if (!shm_.acquire((prefix + "-blk").c_str(), sizeof(block_t))) return false;
+        blk_ = static_cast<block_t *>(shm_.get());
+        return blk_ != nullptr;
+    }
+
+    void lock()     { pthread_mutex_lock(&blk_->mtx); }
+    void unlock()   { pthread_mutex_unlock(&blk_->mtx); }
+    void wait()     { pthread_cond_wait(&blk_->cnd, &blk_->mtx); }
+    void notify()   { pthread_cond_signal(&blk_->cnd); }
+    void post()     { sem_post(&blk_->sem); }
+    void sem_wait() { while ((::sem_wait(&blk_->sem) != 0) && (errno == EINTR)) ; }
+};
+
+void record(control_t *ctl, std::uint64_t t1, std::memory_order order) {
+    auto ns = t1 - ctl->t0.load(order);
+    ctl->hist.record(ns);
+    ctl->sum.fetch_add(ns, std::memory_order_relaxed);
+}
+
+/* The side of a case blocking & recording in the forked process, 'i' is the round from 1 on. */
+template <typename B>
+void waiter_side(char const *test, B &be, control_t *ctl, unsigned loops) {
+    std::string t = test;
+    for (std::uint32_t i = 1; i <= loops; ++i) {
+        if (t == "mutex.handoff") {
+            spin_until(ctl->phase, i);
+            ctl->waiting.store(i, std::memory_order_release);
+            be.lock();
+            record(ctl, now_ns(), std::memory_order_relaxed);
+            be.unlock();
+        } else if (t == "condition.wake") {
+            be.lock();
+            ctl->waiting.store(i, std::memory_order_release);
+            while (ctl->signaled.load(std::memory_order_acquire) != i) be.wait();
+            record(ctl, now_ns(), std::memory_order_relaxed);
+            be.unlock();
+        } else { // semaphore.wake
+            ctl->waiting.store(i, std::memory_order_release);
+            be.sem_wait();
+            record(ctl, now_ns(), std::memory_order_acquire);
+        }
+        ctl->done.store(i, std::memory_order_release);
+    }
+}
+
+template <typename B>
+void waker_side(char const *test, B &be, control_t *ctl, unsigned loops) {
+    std::string t = test;
+    for (std::uint32_t i = 1; i <= loops; ++i) {
+        if (t == "mutex.handoff") {
+            be.lock();
+            ctl->phase.store(i, std::memory_order_release);
+            spin_until(ctl->waiting, i);
+            settle();
+            ctl->t0.store(now_ns(), std::memory_order_relaxed);
+            be.unlock();
+        } else if (t == "condition.wake") {
+            spin_until(ctl->waiting, i);
+            be.lock(); // the peer is in wait once it has released the mutex
+            ctl->signaled.store(i, std::memory_order_release);
+            ctl->t0.store(now_ns(), std::memory_order_relaxed);
+            be.notify();
+            be.unlock();
+        } else { // semaphore.wake
+            spin_until(ctl->waiting, i);
+            settle();
+            ctl->t0.store(now_ns(), std::memory_order_release);
+            be.post();
+        }
+        spin_until(ctl->done, i);
+    }
+}
+
+void print_row(char const *test, char const *backend, unsigned count,
+               double mean, std::uint64_t const *q /*p50, p99, max*/) {
+    if (q == nullptr) {
+        std::printf("%-18s %-12s %8u %10.1f %10s %10s %10s\n", test, backend, count, mean, "-", "-", "-");
+    } else {
+        std::printf("%-18s %-12s %8u %10.1f %10llu %10llu %10llu\n", test, backend, count, mean,
+                    static_cast<unsigned long long>(q[0]),
+                    static_cast<unsigned long long>(q[1]),
+                    static_cast<unsigned long long>(q[2]));
+    }
+    std::fflush(stdout);
+}
+
+template <typename B>
+bool run_uncontended(std::string const &prefix, unsigned loops) {
+    B be;
+    if (!be.open(prefix)) return false;
+    unsigned n = loops * 100;
+    auto t0 = now_ns();
+    for (unsigned i = 0; i < n; ++i) {
+        be.lock();
+        be.unlock();
+    }
+    print_row("mutex.uncontended", B::name(), n, static_cast<double>(now_ns() - t0) / n, nullptr);
+    return true;
+}
+
+template <typename B>
+bool run_wake(char const *test, std::string const &prefix, control_t *ctl, unsigned loops) {
+    ctl->phase   .store(0);
+    ctl->waiting .store(0);
+    ctl->signaled.store(0);
+    ctl->done    .store(0);
+    ctl->sum     .store(0);
+    ctl->hist.reset();
+
+    pid_t pid = ::fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        B be;
+        if (be.open(prefix)) waiter_side(test, be, ctl, loops);
+        ::_exit(0);
+    }
+    {
+        B be;
+        if (!be.open(prefix)) {
+            ::kill(pid, SIGKILL);
+            ::waitpid(pid, nullptr, 0);
+            return false;
+        }
+        waker_side(test, be, ctl, loops);
+    }
+    ::waitpid(pid, nullptr, 0);
+
+    double const qs[] = {0.5, 0.99, 1.0};
+    std::uint64_t q[3] {};
+    std::uint64_t count = ctl->hist.quantiles(qs, q, 3);
+    double mean = (count == 0) ? 0 : static_cast<double>(ctl->sum.load()) / static_cast<double>(count);
+    print_row(test, B::name(), static_cast<unsigned>(count), mean, q);
+    return true;
+}
+
+template <typename B>
+bool run_backend(control_t *ctl, unsigned loops) {
+    std::string prefix = "bench-sync-" + std::to_string(::getpid()) + "-" + B::name();
+    B owner; // keeps the objects alive through the cases, they are removed along with the last user
+    bool ok = owner.create(prefix)
+           && run_uncontended<B>(prefix, loops)
+           && run_wake<B>("mutex.handoff" , prefix, ctl, loops)
+           && run_wake<B>("condition.wake", prefix, ctl, loops)
+           && run_wake<B>("semaphore.wake", prefix, ctl, loops);
+    if (!ok) std::fprintf(stderr, "%s: failed\n", B::name());
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    unsigned loops = 2000;
+    if (argc > 1) loops = static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10));
+    if (loops == 0) loops = 1;
+
+    std::string ctl_name = "bench-sync-" + std::to_string(::getpid()) + "-ctl";
+    ipc::shm::handle ctl_shm {ctl_name.c_str(), sizeof(control_t)};
+    auto *ctl = static_cast<control_t *>(ctl_shm.get());
+    if (ctl == nullptr) return -1;
+
+    std::printf("%-18s %-12s %8s %10s %10s %10s %10s\n", "test", "backend", "count", "mean_ns", "p50_ns", "p99_ns", "max_ns");
+    bool ok = run_backend<a0_backend>(ctl, loops);
+    ok = run_backend<posix_backend<true >>(ctl, loops) && ok;
+    ok = run_backend<posix_backend<false>>(ctl, loops) && ok;
+    ctl_shm.clear();
+    return ok ? 0 : 1;
+}
+
+#else /*!LIBIPC_OS_WIN*/
+
+int main() {
+    std::printf("bench-sync compares the POSIX backends across forked processes, it doesn't run on Windows.\n");
+    return 0;
+}
+
+#endif/*!LIBIPC_OS_WIN*/
@@ -14,12 +14,20 @@ class LIBIPC_EXPORT buffer {
 public:
     using destructor_t = void (*)(void*, std::size_t);
 
-    buffer();
+    enum : std::size_t {
+        /// Payloads (or destructor contexts) up to this size are stored inside the buffer itself.
+        small_size = ipc::data_length
+    };
+
+    buffer() noexcept;
 
     buffer(void* p, std::size_t s, destructor_t d);
     // mem_to_free: pointer to be passed to destructor (if different from p)
     // Use case: when p points into a larger allocated block that needs to be freed
     buffer(void* p, std::size_t s, destructor_t d, void* mem_to_free);
+    // ctx: ctx_size bytes copied into the buffer, the destructor receives a pointer to the copy
+    // Use case: the destructor needs a small context, and it shouldn't be allocated separately
+    buffer(void* p, std::size_t s, destructor_t d, void const * ctx, std::size_t ctx_size);
     buffer(void* p, std::size_t s);
 
     template <std::size_t N>
@@ -28,11 +36,14 @@ public:
     }
     explicit buffer(char & c);
 
-    buffer(buffer&& rhs);
+    buffer(buffer&& rhs) noexcept;
     ~buffer();
 
-    void swap(buffer& rhs);
-    buffer& operator=(buffer rhs);
+    /// Makes a buffer owning a copy of the data, small payloads don't touch the allocator.
+    static buffer copy_of(void const * p, std::size_t s);
+
+    void swap(buffer& rhs) noexcept;
+    buffer& operator=(buffer rhs) noexcept;
 
     bool empty() const noexcept;
 
@@ -63,8 +74,22 @@ public:
     friend LIBIPC_EXPORT bool operator!=(buffer const & b1, buffer const & b2);
 
 private:
-    class buffer_;
-    buffer_* p_;
+    enum class storage : byte_t {
+        none,
+        payload,    // p_ points to sbo_
+        context,    // a_ points to sbo_
+        heap_context
+    };
+
+    void move_from(buffer& rhs) noexcept;
+    void reset() noexcept;
+
+    void*        p_;
+    std::size_t  s_;
+    void*        a_;
+    destructor_t d_;
+    storage      st_;
+    alignas(std::max_align_t) byte_t sbo_[small_size];
 };
 
 } // namespace ipc
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>  // std::uint64_t
+#include <cstddef>  // std::size_t
 
 #include "libipc/imp/export.h"
 #include "libipc/def.h"
@@ -24,6 +25,16 @@ public:
     bool valid() const noexcept;
 
     bool open(char const *name) noexcept;
+
+    /**
+     * \brief Opens the condition on caller-provided shared memory of at least 'storage_size()' bytes.
+     * \param init true for the only opener which initializes the memory.
+     * \return false if the platform doesn't support it (e.g. Windows).
+     * \remarks 'close' leaves the memory as it is, 'clear' destroys the condition in it.
+    */
+    bool open(void *mem, std::size_t size, bool init) noexcept;
+    static std::size_t storage_size() noexcept;
+
     void close() noexcept;
 
     void clear() noexcept;
@@ -0,0 +1,272 @@
+/**
+ * \file libipc/conflating_chan.h
+ * \author mutouyun (orz@orzz.org)
+ * \brief A channel keeping only the latest value of each key for the readers (last value cache).
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "libipc/def.h"
+#include "libipc/rw_lock.h"
+#include "libipc/imp/fmt.h"
+#include "libipc/seqlock.h"
+#include "libipc/shm_hash_map.h"
+
+namespace ipc {
+
+/**
+ * \brief A broadcast channel which conflates the messages of the same key.
+ *
+ * \remarks The latest value of each key is kept in a 'shm_hash_map', and every send appends
+ *          the bucket of its key to a fixed-size change log. A reader follows the log and
+ *          keeps at most one pending entry per key, which always delivers the latest value,
+ *          so older unread values of the key are dropped instead of blocking the writers.
+ *          A reader overrun by the log, or connecting for the first time, rescans the whole map,
+ *          so it never disconnects and always catches up with bounded memory.
+ *          Any number of writers and readers may use the same name.
+ *
+ * \tparam Key The type of the key (topic), trivially copyable.
+ * \tparam T The type of the value, trivially copyable.
+ */
+template <typename Key, typename T,
+          typename Hash     = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class conflating_chan {
+
+  using map_t = shm_hash_map<Key, T, Hash, KeyEqual>;
+
+  enum : unsigned {
+    entry_timeout = 3000 // refills finding the next entry unwritten, before taking its writer as gone
+  };
+
+  /// \brief The change log, an entry is (lap << 32 | bucket index).
+  struct log_t {
+    std::atomic<std::uint64_t> tail_;
+    std::atomic<std::uint64_t> entries_[1];
+  };
+
+  std::string name_;
+  map_t map_;
+  detail::snapshot_chan_base notice_; // holds the change log, and wakes up the blocking readers
+  log_t *log_ = nullptr;
+  std::size_t shift_ = 0;
+
+  // The state of the reader, local to the process.
+  std::uint64_t              rd_     = 0;
+  unsigned                   stall_  = 0; // refills stopped at the entry rd_, still being written
+  bool                       rescan_ = true;
+  std::vector<std::uint64_t> seen_;   // sequence of the value last delivered of each bucket
+  std::vector<bool>          queued_; // whether the bucket is pending
+  std::deque<std::uint32_t>  pending_;
+
+  std::uint64_t mask() const noexcept {
+    return (std::uint64_t(1) << shift_) - 1;
+  }
+
+  static std::size_t log_size(std::size_t count) noexcept {
+    return sizeof(log_t) + sizeof(std::atomic<std::uint64_t>) * (count - 1);
+  }
+
+  /// \brief Names the segments the way the library prefixes its own.
+  static std::string segment_name(char const *name, char const *kind) {
+    return ipc::fmt(name, "__IPC_SHM__", kind);
+  }
+
+  static std::string map_name(char const *name) {
+    return segment_name(name, "LV_MAP__");
+  }
+
+  static std::string log_name(char const *name) {
+    return segment_name(name, "LV_LOG__");
+  }
+
+  void queue(std::uint32_t index) {
+    if (queued_[index]) return;
+    queued_[index] = true;
+    pending_.push_back(index);
+  }
+
+  void rescan() {
+    rd_ = log_->tail_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < map_.capacity(); ++i) {
+      queue(static_cast<std::uint32_t>(i));
+    }
+    stall_  = 0;
+    rescan_ = false;
+  }
+
+  /// \brief Moves the changes in the log to the pending queue, without waiting.
+  /// \remarks A writer appends its entry after assigning the value, so if the entry is still
+  ///          being written, the next refill tries again. A rescan delivers the value in any case.
+  void refill() {
+    if (rescan_) {
+      rescan();
+      return;
+    }
+    auto tail = log_->tail_.load(std::memory_order_acquire);
+    if (tail - rd_ > mask() + 1) {
+      rescan(); // overrun
+      return;
+    }
+    for (; rd_ != tail; ++rd_) {
+      auto lap = (rd_ >> shift_) + 1;
+      auto e   = log_->entries_[rd_ & mask()].load(std::memory_order_acquire);
+      if ((e >> 32) < lap) {
+        if (++stall_ < entry_timeout) return;
+        rescan(); // the writer might be gone
+        return;
+      }
+      stall_ = 0;
+      if ((e >> 32) != lap) {
+        rescan(); // overwritten by a later lap
+        return;
+      }
+      queue(static_cast<std::uint32_t>(e));
+    }
+  }
+
+public:
+  using key_type    = Key;
+  using mapped_type = T;
+
+  conflating_chan() = default;
+
+  conflating_chan(char const *name, std::size_t capacity) {
+    connect(name, capacity);
+  }
+
+  ~conflating_chan() {
+    disconnect();
+  }
+
+  conflating_chan(conflating_chan const &) = delete;
+  conflating_chan &operator=(conflating_chan const &) = delete;
+
+  bool valid() const noexcept {
+    return log_ != nullptr;
+  }
+
+  char const *name() const noexcept {
+    return name_.c_str();
+  }
+
+  /// \brief The number of keys the channel can hold, rounded up to a power of 2.
+  std::size_t capacity() const noexcept {
+    return map_.capacity();
+  }
+
+  /// \brief Connects to the channel, every process must use the same types and capacity.
+  /// \remarks The first receive of a new connection delivers the latest value of every key.
+  bool connect(char const *name, std::size_t capacity) {
+    disconnect();
+    if ((name == nullptr) || (name[0] == '\0') || !map_.open(map_name(name).c_str(), capacity)) {
+      return false;
+    }
+    std::size_t cap = map_.capacity();
+    if (!notice_.open(log_name(name).c_str(), log_size(cap), alignof(log_t))) {
+      map_.close();
+      return false;
+    }
+    log_   = static_cast<log_t *>(notice_.data());
+    shift_ = 0;
+    while ((std::size_t(1) << shift_) < cap) ++shift_;
+    seen_  .assign(cap, 0);
+    queued_.assign(cap, false);
+    pending_.clear();
+    stall_  = 0;
+    rescan_ = true;
+    name_   = name;
+    return true;
+  }
+
+  void disconnect() noexcept {
+    log_ = nullptr;
+    name_.clear();
+    notice_.close();
+    map_.close();
+  }
+
+  /// \brief Disconnects and removes the storage of the channel from the system.
+  void clear() noexcept {
+    log_ = nullptr;
+    name_.clear();
+    notice_.clear();
+    map_.clear();
+  }
+
+  static void clear_storage(char const *name) noexcept {
+    if ((name == nullptr) || (name[0] == '\0')) return;
+    detail::snapshot_chan_base::clear_storage(log_name(name).c_str());
+    map_t::clear_storage(map_name(name).c_str());
+  }
+
+  /// \brief Publishes the value of the key, replacing the unread one.
+  /// \return false if the channel is full of other keys.
+  bool send(Key const &key, T const &value) noexcept {
+    if (!valid()) return false;
+    std::size_t index;
+    if (!map_.insert_or_assign(key, value, index)) return false;
+    auto pos = log_->tail_.fetch_add(1, std::memory_order_relaxed);
+    log_->entries_[pos & mask()].store((((pos >> shift_) + 1) << 32) | index, std::memory_order_release);
+    notice_.notify();
+    return true;
+  }
+
+  /// \brief Receives the latest value of a changed key without blocking.
+  bool try_recv(Key &key, T &value) {
+    if (!valid()) return false;
+    for (bool refilled = false;; refilled = true) {
+      while (!pending_.empty()) {
+        auto index = pending_.front();
+        pending_.pop_front();
+        queued_[index] = false;
+        auto seq = map_.load_at(index, key, value);
+        if ((seq != 0) && (seq != seen_[index])) {
+          seen_[index] = seq;
+          return true;
+        }
+      }
+      if (refilled) return false;
+      refill();
+    }
+  }
+
+  /// \brief Receives the latest value of a changed key, blocks until there is one or timeout.
+  bool recv(Key &key, T &value, std::uint64_t tm = ipc::invalid_value) {
+    if (!valid()) return false;
+    auto const start = std::chrono::steady_clock::now();
+    for (unsigned k = 0; !try_recv(key, value);) {
+      if (stall_ != 0) {
+        // a writer is appending the next entry, it won't take long, but no longer than tm either
+        if ((tm != ipc::invalid_value) &&
+            (std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(tm))) {
+          return false;
+        }
+        ipc::sleep(k);
+        continue;
+      }
+      k = 0;
+      struct ctx_t {
+        log_t const *log;
+        std::uint64_t rd;
+      } ctx {log_, rd_};
+      if (!notice_.wait_if([](void const *p) {
+            auto const *c = static_cast<ctx_t const *>(p);
+            return c->log->tail_.load(std::memory_order_acquire) == c->rd;
+          }, &ctx, tm)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+} // namespace ipc
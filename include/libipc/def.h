@@ -36,6 +36,7 @@ enum : std::size_t {
   large_msg_limit = data_length,
   large_msg_align = 1024,
   large_msg_cache = 32,
+  huge_msg_limit  = 1024 * 1024, ///< larger messages are carried by dedicated segments of the sender
 };
 
 enum class relat { // multiplicity of the relationship
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "libipc/imp/export.h"
+#include "libipc/imp/span.h"
+#include "libipc/imp/byte.h"
 #include "libipc/def.h"
 #include "libipc/buffer.h"
 #include "libipc/shm.h"
@@ -17,6 +20,102 @@ enum : unsigned {
     receiver
 };
 
+/**
+ * The bit of a topic id (0 ~ 63) in a topic set.
+ * Messages and subscriptions carry a set of topics, 0 stands for all of them.
+*/
+constexpr std::uint64_t topic(unsigned id) noexcept {
+    return std::uint64_t(1) << (id % 64);
+}
+
+/**
+ * What 'send' does if the receivers can't keep up, and the queue is still full at timeout.
+ * 'overwrite_oldest' & 'sample' need a broadcast channel, otherwise they act as 'drop_newest'.
+*/
+enum class backpressure : unsigned {
+    disconnect_slow,  // disconnects the receivers that haven't read the oldest message (default)
+    block,            // waits regardless of the timeout, as long as there is a receiver
+    drop_newest,      // drops the message being sent
+    overwrite_oldest, // overwrites the oldest message, the receivers that haven't read it skip it
+    sample            // overwrites as well, then the overrun receivers only get every Nth message
+                      // until they catch up
+};
+
+/**
+ * The messages a receiver has lost under the backpressure policies of the senders,
+ * both are reset when it disconnects.
+*/
+struct loss_stat {
+    std::uint64_t dropped;     // dropped by 'drop_newest', or skipped by 'sample'
+    std::uint64_t overwritten; // overwritten before being read
+};
+
+/**
+ * The latency from send to receive of the messages stamped by their senders, see 'trace_latency'.
+ * The values are the upper bounds of log-scaled buckets, at most 1/16 above the exact ones.
+*/
+struct latency_stat {
+    std::uint64_t count; // of the messages received
+    std::uint64_t p50_ns;
+    std::uint64_t p99_ns;
+    std::uint64_t p999_ns;
+    std::uint64_t max_ns;
+};
+
+/**
+ * The progress of a receiver of a broadcast channel, reported by itself whenever it receives.
+ * 'lag / capacity' is how full the queue is for it, a sender would start to evict
+ * (or overwrite, see 'ipc::backpressure') the receivers when it reaches 1.
+*/
+struct recv_stat {
+    std::uint32_t id;       // the index of its connection (0 ~ 31)
+    std::uint32_t lag;      // the elements of the queue it hasn't read yet
+    std::uint32_t lag_max;  // the largest lag seen whenever the progress has been read
+    std::uint32_t capacity; // the elements of the queue
+    std::uint64_t idle_ns;  // since its last receive reported (every few, or once it has read everything)
+    loss_stat     losses;
+    latency_stat  latency;  // since its connection
+};
+
+/**
+ * The counters of a channel, summed over all its connections since the channel was created.
+ * They live in a segment of their own, which any process may read without connecting.
+*/
+struct chan_stats {
+    std::uint64_t msgs_sent;
+    std::uint64_t bytes_sent;
+    std::uint64_t msgs_recv;
+    std::uint64_t bytes_recv;
+    std::uint64_t fragment_sends;    // messages sent piece by piece
+    std::uint64_t large_sends;       // messages sent through a chunk or a segment
+    std::uint64_t force_pushes;      // the queue was still full at timeout, see 'ipc::backpressure'
+    std::uint64_t wait_timeouts;     // waits of sending or receiving that timed out
+    std::uint64_t storage_fallbacks; // the chunks were all in use, or the storage could not be mapped
+    latency_stat  latency;           // of all the receivers
+};
+
+/**
+ * A snapshot of a channel taken from outside, see 'chan_wrapper::inspect'.
+*/
+struct chan_info {
+    std::uint32_t capacity;   // the elements of the queue
+    std::uint32_t occupancy;  // the elements the slowest receiver hasn't read yet
+    std::uint32_t receivers;  // the bitmask of the connected receivers (broadcast), or their number (unicast)
+    std::uint32_t recv_count; // the entries filled in 'recvs' (broadcast only)
+    recv_stat     recvs[32];
+    chan_stats    stats;
+};
+
+/**
+ * A pool of chunks carrying the large messages of one size class,
+ * shared by all the channels of a prefix.
+*/
+struct chunk_stat {
+    std::uint32_t chunk_size;
+    std::uint32_t in_use;
+    std::uint32_t capacity;
+};
+
 template <typename Flag>
 struct LIBIPC_EXPORT chan_impl {
     static ipc::handle_t init_first();
@@ -45,6 +144,32 @@ struct LIBIPC_EXPORT chan_impl {
 
     static bool   try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm);
     static buff_t try_recv(ipc::handle_t h);
+
+    // Only the receivers subscribing to any of the topics would get the message (broadcast only).
+    static bool publish    (ipc::handle_t h, std::uint64_t topics, void const * data, std::size_t size, std::uint64_t tm);
+    static bool try_publish(ipc::handle_t h, std::uint64_t topics, void const * data, std::size_t size, std::uint64_t tm);
+    static bool subscribe  (ipc::handle_t h, std::uint64_t topics);
+
+    static bool      backpressure(ipc::handle_t h, ipc::backpressure policy, std::uint32_t sample_rate);
+    static loss_stat losses      (ipc::handle_t h);
+
+    // Fills the progress of at most 'n' receivers, returns the number filled (broadcast only).
+    static std::size_t recv_stats(ipc::handle_t h, recv_stat * stats, std::size_t n);
+
+    // Reads the counters of a channel by name, returns false if there are none yet.
+    static bool       stats(prefix, char const * name, chan_stats * st);
+    static chan_stats stats(ipc::handle_t h);
+
+    static bool trace_latency(ipc::handle_t h, bool on);
+
+    // Reads the state of a channel by name without connecting to it, false if it doesn't exist.
+    static bool        inspect    (prefix, char const * name, chan_info * info);
+    static std::size_t chunk_stats(prefix, char const * name, chunk_stat * stats, std::size_t n);
+
+    // Returns the message size, 0 on failure.
+    // If the message is larger than 'size', it is kept for the next receive call.
+    static std::size_t recv_into    (ipc::handle_t h, void * buf, std::size_t size, std::uint64_t tm);
+    static std::size_t try_recv_into(ipc::handle_t h, void * buf, std::size_t size);
 };
 
 template <typename Flag>
@@ -171,7 +296,8 @@ public:
     }
 
     /**
-     * If timeout, this function would call 'force_push' to send the data forcibly.
+     * If timeout, this function would handle the full queue according to the backpressure policy,
+     * which calls 'force_push' to send the data forcibly by default.
     */
     bool send(void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
         return detail_t::send(h_, data, size, tm);
@@ -196,6 +322,108 @@ public:
         return this->try_send(str.c_str(), str.size() + 1, tm);
     }
 
+    /**
+     * Sends the message only to the receivers subscribing to any of the topics (see 'ipc::topic'),
+     * the others never see it. If no receiver subscribes to them, the message is dropped.
+     * Topics only work in broadcast mode, otherwise these are the same as 'send' & 'try_send'.
+    */
+    bool publish(std::uint64_t topics, void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
+        return detail_t::publish(h_, topics, data, size, tm);
+    }
+    bool publish(std::uint64_t topics, buff_t const & buff, std::uint64_t tm = default_timeout) {
+        return this->publish(topics, buff.data(), buff.size(), tm);
+    }
+    bool publish(std::uint64_t topics, std::string const & str, std::uint64_t tm = default_timeout) {
+        return this->publish(topics, str.c_str(), str.size() + 1, tm);
+    }
+
+    bool try_publish(std::uint64_t topics, void const * data, std::size_t size, std::uint64_t tm = default_timeout) {
+        return detail_t::try_publish(h_, topics, data, size, tm);
+    }
+    bool try_publish(std::uint64_t topics, buff_t const & buff, std::uint64_t tm = default_timeout) {
+        return this->try_publish(topics, buff.data(), buff.size(), tm);
+    }
+
+    /**
+     * Receives only the messages published to any of the topics, or sent without topics.
+     * The filter is evaluated by the senders, so other messages are never touched.
+     * 0 (the default) receives everything.
+    */
+    bool subscribe(std::uint64_t topics) {
+        return detail_t::subscribe(h_, topics);
+    }
+
+    /**
+     * Sets what 'send' does if the queue is still full at timeout, see 'ipc::backpressure'.
+     * Under 'sample', an overrun receiver gets 1 of every 'sample_rate' messages until it catches up.
+     * 'try_send' always just returns false.
+    */
+    bool backpressure(ipc::backpressure policy, std::uint32_t sample_rate = 8) {
+        return detail_t::backpressure(h_, policy, sample_rate);
+    }
+
+    /**
+     * The messages this receiver has lost so far.
+     * Compared between two receives, a change means a gap in between.
+    */
+    loss_stat losses() const {
+        return detail_t::losses(h_);
+    }
+
+    /**
+     * The progress of all the receivers connected now, for monitoring how far behind they are.
+     * Only broadcast channels track it, otherwise it is empty.
+    */
+    std::vector<recv_stat> recv_stats() const {
+        std::vector<recv_stat> stats(32);
+        stats.resize(detail_t::recv_stats(h_, stats.data(), stats.size()));
+        return stats;
+    }
+
+    /**
+     * Stamps the messages this sender sends from now on with the time of sending,
+     * then their receivers would record the latency (see 'ipc::latency_stat').
+     * It costs a clock read per message, and nothing if it is off (default).
+     * The stamp takes the last 8 bytes of the queue element ending a message,
+     * so the messages filling them (e.g. 57 to 64 bytes) are not traced.
+    */
+    bool trace_latency(bool on = true) {
+        return detail_t::trace_latency(h_, on);
+    }
+
+    // The counters of this channel, see 'ipc::chan_stats'.
+    chan_stats stats() const {
+        return detail_t::stats(h_);
+    }
+
+    // Reads the counters of a channel without connecting to it, false if there are none yet.
+    static bool stats(char const * name, chan_stats & st) {
+        return detail_t::stats({nullptr}, name, &st);
+    }
+
+    static bool stats(prefix pref, char const * name, chan_stats & st) {
+        return detail_t::stats(pref, name, &st);
+    }
+
+    /**
+     * Takes a snapshot of a channel without connecting to it, for monitoring tools.
+     * Returns false if there is no such channel.
+    */
+    static bool inspect(char const * name, chan_info & info) {
+        return detail_t::inspect({nullptr}, name, &info);
+    }
+
+    static bool inspect(prefix pref, char const * name, chan_info & info) {
+        return detail_t::inspect(pref, name, &info);
+    }
+
+    // The chunk pools used by the senders of a channel.
+    static std::vector<chunk_stat> chunk_stats(prefix pref, char const * name) {
+        std::vector<chunk_stat> stats(64);
+        stats.resize(detail_t::chunk_stats(pref, name, stats.data(), stats.size()));
+        return stats;
+    }
+
     buff_t recv(std::uint64_t tm = invalid_value) {
         return detail_t::recv(h_, tm);
     }
@@ -203,6 +431,26 @@ public:
     buff_t try_recv() {
         return detail_t::try_recv(h_);
     }
+
+    /**
+     * Receives a message directly into the caller's buffer.
+     * Returns the size of the message, or 0 if timeout or failed.
+     * If the returned size is larger than the buffer, nothing has been written:
+     * the message is kept and the next recv/recv_into call would return it again.
+    */
+    std::size_t recv_into(void * buf, std::size_t size, std::uint64_t tm = invalid_value) {
+        return detail_t::recv_into(h_, buf, size, tm);
+    }
+    std::size_t recv_into(ipc::span<ipc::byte> buf, std::uint64_t tm = invalid_value) {
+        return this->recv_into(buf.data(), buf.size(), tm);
+    }
+
+    std::size_t try_recv_into(void * buf, std::size_t size) {
+        return detail_t::try_recv_into(h_, buf, size);
+    }
+    std::size_t try_recv_into(ipc::span<ipc::byte> buf) {
+        return this->try_recv_into(buf.data(), buf.size());
+    }
 };
 
 template <relat Rp, relat Rc, trans Ts>
@@ -0,0 +1,151 @@
+/**
+ * \file libipc/mem/offset_ptr.h
+ * \author mutouyun (orz@orzz.org)
+ * \brief A pointer storing the distance to its target, so it stays valid in shared memory.
+ */
+#pragma once
+
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace ipc {
+namespace mem {
+
+/**
+ * \brief A pointer that stores the offset from itself to the object it points to.
+ *
+ * \remarks An offset_ptr and its target placed in the same shared memory segment
+ *          remain valid whatever address the segment is mapped at in each process.
+ *          Copying an offset_ptr recalculates the offset for the new location.
+ *          As in boost.interprocess, an offset of 1 stands for the null pointer.
+ */
+template <typename T>
+class offset_ptr {
+
+  template <typename U>
+  friend class offset_ptr;
+
+  std::ptrdiff_t off_;
+
+  static std::ptrdiff_t offset_of(void const *self, void const *p) noexcept {
+    if (p == nullptr) return 1;
+    return static_cast<std::ptrdiff_t>(reinterpret_cast<std::uintptr_t>(p)
+                                     - reinterpret_cast<std::uintptr_t>(self));
+  }
+
+  template <typename U>
+  using enable_if_convertible = typename std::enable_if<std::is_convertible<U *, T *>::value>::type;
+
+public:
+  // type definitions
+  typedef T                                         element_type;
+  typedef T *                                       pointer;
+  typedef typename std::add_lvalue_reference<T>::type reference;
+  typedef typename std::remove_cv<T>::type          value_type;
+  typedef std::ptrdiff_t                            difference_type;
+  typedef std::random_access_iterator_tag           iterator_category;
+
+  template <typename U>
+  using rebind = offset_ptr<U>;
+
+  offset_ptr() noexcept : off_(1) {}
+  offset_ptr(std::nullptr_t) noexcept : off_(1) {}
+  offset_ptr(T *p) noexcept : off_(offset_of(this, p)) {}
+
+  offset_ptr(offset_ptr const &other) noexcept
+    : off_(offset_of(this, other.get())) {}
+
+  template <typename U, typename = enable_if_convertible<U>>
+  offset_ptr(offset_ptr<U> const &other) noexcept
+    : off_(offset_of(this, static_cast<T *>(other.get()))) {}
+
+  /// \brief Supports static_cast between related pointers, e.g. from offset_ptr<void>.
+  template <typename U, typename = void,
+            typename = typename std::enable_if<!std::is_convertible<U *, T *>::value>::type,
+            typename = decltype(static_cast<T *>(std::declval<U *>()))>
+  explicit offset_ptr(offset_ptr<U> const &other) noexcept
+    : off_(offset_of(this, static_cast<T *>(other.get()))) {}
+
+  offset_ptr &operator=(offset_ptr const &other) noexcept {
+    off_ = offset_of(this, other.get());
+    return *this;
+  }
+
+  offset_ptr &operator=(T *p) noexcept {
+    off_ = offset_of(this, p);
+    return *this;
+  }
+
+  offset_ptr &operator=(std::nullptr_t) noexcept {
+    off_ = 1;
+    return *this;
+  }
+
+  T *get() const noexcept {
+    if (off_ == 1) return nullptr;
+    return reinterpret_cast<T *>(reinterpret_cast<std::uintptr_t>(this) + off_);
+  }
+
+  template <typename U = T>
+  static offset_ptr pointer_to(typename std::enable_if<!std::is_void<U>::value, U>::type &r) noexcept {
+    return offset_ptr{&r};
+  }
+
+  explicit operator bool() const noexcept { return off_ != 1; }
+  operator T *() const noexcept { return get(); }
+
+  template <typename U = T>
+  auto operator*() const noexcept -> typename std::enable_if<!std::is_void<U>::value, U &>::type {
+    return *get();
+  }
+
+  T *operator->() const noexcept { return get(); }
+
+  template <typename U = T>
+  auto operator[](difference_type n) const noexcept -> typename std::enable_if<!std::is_void<U>::value, U &>::type {
+    return get()[n];
+  }
+
+  offset_ptr &operator+=(difference_type n) noexcept { return *this = get() + n; }
+  offset_ptr &operator-=(difference_type n) noexcept { return *this = get() - n; }
+
+  offset_ptr &operator++() noexcept { return *this += 1; }
+  offset_ptr &operator--() noexcept { return *this -= 1; }
+  offset_ptr  operator++(int) noexcept { offset_ptr tmp {*this}; ++(*this); return tmp; }
+  offset_ptr  operator--(int) noexcept { offset_ptr tmp {*this}; --(*this); return tmp; }
+
+  friend offset_ptr operator+(offset_ptr const &p, difference_type n) noexcept { return offset_ptr{p.get() + n}; }
+  friend offset_ptr operator+(difference_type n, offset_ptr const &p) noexcept { return offset_ptr{p.get() + n}; }
+  friend offset_ptr operator-(offset_ptr const &p, difference_type n) noexcept { return offset_ptr{p.get() - n}; }
+
+  friend difference_type operator-(offset_ptr const &a, offset_ptr const &b) noexcept {
+    return a.get() - b.get();
+  }
+};
+
+template <typename T, typename U>
+bool operator==(offset_ptr<T> const &a, offset_ptr<U> const &b) noexcept { return a.get() == b.get(); }
+template <typename T, typename U>
+bool operator!=(offset_ptr<T> const &a, offset_ptr<U> const &b) noexcept { return a.get() != b.get(); }
+template <typename T, typename U>
+bool operator< (offset_ptr<T> const &a, offset_ptr<U> const &b) noexcept { return a.get() <  b.get(); }
+template <typename T, typename U>
+bool operator<=(offset_ptr<T> const &a, offset_ptr<U> const &b) noexcept { return a.get() <= b.get(); }
+template <typename T, typename U>
+bool operator> (offset_ptr<T> const &a, offset_ptr<U> const &b) noexcept { return a.get() >  b.get(); }
+template <typename T, typename U>
+bool operator>=(offset_ptr<T> const &a, offset_ptr<U> const &b) noexcept { return a.get() >= b.get(); }
+
+template <typename T>
+bool operator==(offset_ptr<T> const &p, std::nullptr_t) noexcept { return !p; }
+template <typename T>
+bool operator==(std::nullptr_t, offset_ptr<T> const &p) noexcept { return !p; }
+template <typename T>
+bool operator!=(offset_ptr<T> const &p, std::nullptr_t) noexcept { return bool(p); }
+template <typename T>
+bool operator!=(std::nullptr_t, offset_ptr<T> const &p) noexcept { return bool(p); }
+
+} // namespace mem
+} // namespace ipc
@@ -0,0 +1,116 @@
+/**
+ * \file libipc/mem/shm_allocator.h
+ * \author mutouyun (orz@orzz.org)
+ * \brief An allocator for standard library containers placed in shared memory.
+ */
+#pragma once
+
+#include <cstddef>
+#include <new>      // std::bad_alloc
+#include <utility>
+#include <limits>
+#include <type_traits>
+
+#include "libipc/imp/detect_plat.h"
+#include "libipc/imp/uninitialized.h"
+#include "libipc/mem/offset_ptr.h"
+#include "libipc/mem/shm_memory_resource.h"
+
+namespace ipc {
+namespace mem {
+
+/**
+ * \brief An allocator allocating from a 'shm_heap', with 'offset_ptr' as its pointer type.
+ *
+ * \remarks The allocator only refers to the heap through an 'offset_ptr',
+ *          so a container using it can be placed in the same segment and used by every process mapping it.
+ *          Pointers in the segment are only valid for the containers supporting fancy pointers,
+ *          e.g. std::vector and std::deque of libstdc++ / libc++.
+ *
+ * \see https://en.cppreference.com/w/cpp/named_req/Allocator#Fancy_pointers
+ */
+template <typename T>
+class shm_allocator {
+
+  template <typename U>
+  friend class shm_allocator;
+
+  offset_ptr<shm_heap> heap_;
+
+public:
+  // type definitions
+  typedef T                                    value_type;
+  typedef offset_ptr<T>                        pointer;
+  typedef offset_ptr<T const>                  const_pointer;
+  typedef offset_ptr<void>                     void_pointer;
+  typedef offset_ptr<void const>               const_void_pointer;
+  typedef std::size_t                          size_type;
+  typedef std::ptrdiff_t                       difference_type;
+
+  // the other type of std_allocator
+  template <typename U>
+  struct rebind {
+    using other = shm_allocator<U>;
+  };
+
+  shm_allocator(shm_heap *heap) noexcept
+    : heap_(heap) {}
+
+  shm_allocator(shm_memory_resource &mem_res) noexcept
+    : heap_(mem_res.heap()) {}
+
+  shm_allocator           (shm_allocator const &other) noexcept = default;
+  shm_allocator& operator=(shm_allocator const &other) noexcept = default;
+
+  template <typename U>
+  shm_allocator(shm_allocator<U> const &other) noexcept
+    : heap_(other.heap_) {}
+
+  shm_heap *heap() const noexcept {
+    return heap_.get();
+  }
+
+  constexpr size_type max_size() const noexcept {
+    return (std::numeric_limits<size_type>::max)() / sizeof(value_type);
+  }
+
+  /// \brief Allocates storage for count objects from the heap.
+  /// \remark Throws std::bad_alloc if the heap can't satisfy it, as the containers expect.
+  pointer allocate(size_type count) {
+    if (count == 0) return nullptr;
+    void *p = nullptr;
+    if ((count <= this->max_size()) && heap_) {
+      p = heap_->allocate(sizeof(value_type) * count, alignof(value_type));
+    }
+    if (p == nullptr) LIBIPC_THROW(std::bad_alloc{}, nullptr);
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(pointer p, size_type count) noexcept {
+    if ((count == 0) || (count > this->max_size()) || !heap_) return;
+    heap_->deallocate(p.get(), sizeof(value_type) * count, alignof(value_type));
+  }
+
+  template <typename U, typename... P>
+  static void construct(U *p, P && ... params) {
+    std::ignore = ipc::construct<U>(p, std::forward<P>(params)...);
+  }
+
+  template <typename U>
+  static void destroy(U *p) {
+    std::ignore = ipc::destroy(p);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(shm_allocator<T> const &a, shm_allocator<U> const &b) noexcept {
+  return a.heap() == b.heap();
+}
+
+template <typename T, typename U>
+bool operator!=(shm_allocator<T> const &a, shm_allocator<U> const &b) noexcept {
+  return a.heap() != b.heap();
+}
+
+} // namespace mem
+} // namespace ipc
@@ -0,0 +1,110 @@
+/**
+ * \file libipc/mem/shm_memory_resource.h
+ * \author mutouyun (orz@orzz.org)
+ * \brief A memory resource carving its allocations out of a named shared memory segment.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>  // std::size_t, std::max_align_t
+#include <cstdint>
+
+#include "libipc/imp/export.h"
+#include "libipc/shm.h"
+
+namespace ipc {
+namespace mem {
+
+/**
+ * \class LIBIPC_EXPORT shm_heap
+ * \brief The allocator state placed at the head of a shared memory segment.
+ *
+ * \remarks All the state lives in the segment, so any process mapping it can allocate and deallocate.
+ *          Allocations are rounded up to a power-of-two size class (16 bytes ~ 64 GB, the largest heap),
+ *          freed blocks go to a lock-free list of their class, and new blocks are cut from the
+ *          untouched tail of the segment. Blocks are never merged or returned to the tail.
+ */
+class LIBIPC_EXPORT shm_heap {
+public:
+  enum : std::size_t {
+    min_class_shift = 4,  // 16 bytes
+    max_class_shift = 36, // 64 GB
+    class_count     = max_class_shift - min_class_shift + 1,
+    max_alignment   = 4096
+  };
+
+  shm_heap(shm_heap const &) = delete;
+  shm_heap &operator=(shm_heap const &) = delete;
+
+  /// \brief Initializes the heap on zero-filled memory of a new segment, or attaches to an initialized one.
+  /// \return nullptr if the memory is too small or holds something else.
+  static shm_heap *make(void *mem, std::size_t size) noexcept;
+
+  /// \brief Allocates storage with a size of at least bytes bytes, aligned to the specified alignment.
+  /// \remark Returns nullptr if the segment is exhausted, or the size or alignment is not supported.
+  void *allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) noexcept;
+
+  /// \brief Deallocates the storage pointed to by p, bytes and alignment must be the same as allocation.
+  void deallocate(void *p, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) noexcept;
+
+  /// \brief The object shared through this heap, nullptr if it hasn't been set.
+  void *root() const noexcept;
+
+  /// \brief Sets the root object, fails if another one has been set.
+  bool set_root(void *p) noexcept;
+
+  /// \brief The size of the whole segment.
+  std::size_t size() const noexcept;
+
+  /// \brief The bytes cut from the segment so far, including the heap itself.
+  std::size_t used() const noexcept;
+
+private:
+  std::uint32_t              magic_;
+  std::atomic<std::uint32_t> state_;
+  std::uint64_t              size_;
+  std::atomic<std::uint64_t> top_;                 // offset of the untouched tail
+  std::atomic<std::uint64_t> root_;                // offset of the root object, 0 if none
+  std::atomic<std::uint64_t> free_[class_count];   // tagged heads of the free lists
+
+  shm_heap() = default;
+
+  std::uint8_t *base() const noexcept;
+};
+
+/**
+ * \class LIBIPC_EXPORT shm_memory_resource
+ * \brief A memory resource allocating from a named shared memory segment through its 'shm_heap'.
+ * \remarks Pointers into the segment differ between processes,
+ *          store them as 'offset_ptr' in the structures placed in it.
+ */
+class LIBIPC_EXPORT shm_memory_resource {
+
+  ipc::shm::handle shm_;
+  shm_heap *heap_;
+
+public:
+  shm_memory_resource() noexcept;
+  shm_memory_resource(char const *name, std::size_t size) noexcept;
+  ~shm_memory_resource() noexcept;
+
+  shm_memory_resource(shm_memory_resource const &) = delete;
+  shm_memory_resource &operator=(shm_memory_resource const &) = delete;
+
+  bool valid() const noexcept;
+  bool open(char const *name, std::size_t size) noexcept;
+  void close() noexcept;
+
+  /// \brief Closes the resource and removes the segment from the system.
+  void clear() noexcept;
+  static void clear_storage(char const *name) noexcept;
+
+  shm_heap *heap() const noexcept;
+  char const *name() const noexcept;
+
+  void *allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) noexcept;
+  void deallocate(void *p, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t)) noexcept;
+};
+
+} // namespace mem
+} // namespace ipc
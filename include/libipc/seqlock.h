@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "libipc/imp/export.h"
+#include "libipc/imp/aligned.h"
+#include "libipc/def.h"
+#include "libipc/rw_lock.h"
+
+namespace ipc {
+
+/**
+ * \class seqlock
+ * \brief A single-writer / many-reader snapshot of a trivially copyable value.
+ * \remarks The writer makes the sequence odd, writes the value in place and makes it even again,
+ *          readers copy the value and retry if the sequence has changed meanwhile.
+ *          It is standard-layout and zero-filled memory is a valid empty seqlock,
+ *          so it can be placed directly in shared memory.
+ *          Only one writer may store at a time.
+*/
+template <typename T>
+class seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable.");
+
+    std::atomic<std::uint64_t> seq_ {0};
+    ipc::aligned<T>            data_;
+
+public:
+    seqlock() noexcept = default;
+
+    seqlock(seqlock const &) = delete;
+    seqlock &operator=(seqlock const &) = delete;
+
+    /// \brief The number of stores times 2, odd while a store is in progress, 0 if never stored.
+    std::uint64_t sequence() const noexcept {
+        return seq_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const noexcept {
+        return sequence() == 0;
+    }
+
+    void store(T const &value) noexcept {
+        auto seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(static_cast<void *>(data_.ptr()), &value, sizeof(T));
+        seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    /// \brief Copies the value once, fails if a store is in progress or has overlapped.
+    /// \param seq receives the sequence of the copied value, if not null.
+    bool try_load(T &value, std::uint64_t *seq = nullptr) const noexcept {
+        auto s = seq_.load(std::memory_order_acquire);
+        if ((s & 1) != 0) return false;
+        std::memcpy(static_cast<void *>(&value), data_.ptr(), sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) != s) return false;
+        if (seq != nullptr) *seq = s;
+        return true;
+    }
+
+    /// \brief Copies the value, retrying until there is no overlapping store.
+    /// \return The sequence of the copied value, 0 if nothing has been stored.
+    std::uint64_t load(T &value) const noexcept {
+        std::uint64_t s = 0;
+        for (unsigned k = 0; !try_load(value, &s); ipc::yield(k)) ;
+        return s;
+    }
+};
+
+namespace detail {
+
+/**
+ * \brief The type-erased part of 'snapshot_chan': a named segment holding a seqlock,
+ *        and a waiter for the readers who block on changes.
+*/
+class LIBIPC_EXPORT snapshot_chan_base {
+public:
+    snapshot_chan_base();
+    ~snapshot_chan_base();
+
+    snapshot_chan_base(snapshot_chan_base const &) = delete;
+    snapshot_chan_base &operator=(snapshot_chan_base const &) = delete;
+
+    bool valid() const noexcept;
+    char const * name() const noexcept;
+
+    bool open(char const * name, std::size_t data_size, std::size_t data_align) noexcept;
+    void close() noexcept;
+    void clear() noexcept;
+    static void clear_storage(char const * name) noexcept;
+
+    void * data() const noexcept;
+
+    /// \brief Wakes the waiting readers up, does nothing if there is none.
+    void notify() noexcept;
+
+    /// \brief Waits until pred returns false, or timeout.
+    bool wait_if(bool (*pred)(void const *), void const * ctx, std::uint64_t tm) noexcept;
+
+private:
+    class snapshot_chan_;
+    snapshot_chan_* p_;
+};
+
+} // namespace detail
+
+/**
+ * \class snapshot_chan
+ * \brief Publishes the latest value of T through a named shared memory segment ("latest value wins").
+ * \remarks Unlike a channel, readers never fall behind: each read gets the latest value,
+ *          and the writer never waits for them.
+ *          A reader may block until the value changes, the writer only pays for the notification
+ *          while someone is waiting.
+*/
+template <typename T>
+class snapshot_chan : private detail::snapshot_chan_base {
+
+    using base_t = detail::snapshot_chan_base;
+
+    seqlock<T> *sl_ = nullptr;
+
+public:
+    snapshot_chan() = default;
+
+    explicit snapshot_chan(char const * name) {
+        open(name);
+    }
+
+    using base_t::valid;
+    using base_t::name;
+    using base_t::clear_storage;
+
+    bool open(char const * name) noexcept {
+        if (!base_t::open(name, sizeof(seqlock<T>), alignof(seqlock<T>))) {
+            sl_ = nullptr;
+            return false;
+        }
+        sl_ = static_cast<seqlock<T> *>(base_t::data());
+        return true;
+    }
+
+    void close() noexcept {
+        sl_ = nullptr;
+        base_t::close();
+    }
+
+    /// \brief Closes the channel and removes its storage from the system.
+    void clear() noexcept {
+        sl_ = nullptr;
+        base_t::clear();
+    }
+
+    /// \brief The sequence of the latest value, 0 if nothing has been written.
+    std::uint64_t sequence() const noexcept {
+        return (sl_ == nullptr) ? 0 : sl_->sequence();
+    }
+
+    /// \brief Publishes the value, there should be only one writer at a time.
+    bool write(T const &value) noexcept {
+        if (sl_ == nullptr) return false;
+        sl_->store(value);
+        base_t::notify();
+        return true;
+    }
+
+    /// \brief Copies the latest value.
+    /// \return The sequence of the value, 0 if nothing has been written.
+    std::uint64_t read(T &value) const noexcept {
+        if (sl_ == nullptr) return 0;
+        return sl_->load(value);
+    }
+
+    /// \brief Waits for a value newer than the sequence 'seq', and copies it.
+    /// \return The sequence of the value, 0 if timeout.
+    std::uint64_t wait_for_change(std::uint64_t seq, T &value, std::uint64_t tm = ipc::invalid_value) noexcept {
+        if (sl_ == nullptr) return 0;
+        struct ctx_t {
+            seqlock<T> *sl;
+            std::uint64_t seq;
+        } ctx {sl_, seq};
+        bool ret = base_t::wait_if([](void const *p) {
+            auto const *c = static_cast<ctx_t const *>(p);
+            auto s = c->sl->sequence();
+            return (s == c->seq) || ((s & 1) != 0);
+        }, &ctx, tm);
+        if (!ret) return 0;
+        auto s = sl_->load(value);
+        return (s == seq) ? 0 : s;
+    }
+};
+
+} // namespace ipc
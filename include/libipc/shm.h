@@ -46,6 +46,10 @@ LIBIPC_EXPORT void         remove (char const * name) noexcept;
 LIBIPC_EXPORT std::int32_t get_ref(id_t id);
 LIBIPC_EXPORT void sub_ref(id_t id);
 
+// Whether the name the id was acquired with still refers to the shared memory it has mapped.
+// It would not once the name has been removed, and maybe created again, by another handle or process.
+LIBIPC_EXPORT bool is_current(id_t id) noexcept;
+
 class LIBIPC_EXPORT handle {
 public:
     handle();
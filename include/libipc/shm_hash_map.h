@@ -0,0 +1,326 @@
+/**
+ * \file libipc/shm_hash_map.h
+ * \author mutouyun (orz@orzz.org)
+ * \brief A fixed-capacity lock-free hash map living in a named shared memory segment.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "libipc/imp/aligned.h"
+#include "libipc/imp/log.h"
+#include "libipc/rw_lock.h"
+#include "libipc/shm.h"
+
+namespace ipc {
+
+/**
+ * \brief A hash map shared by every process opening the same name.
+ *
+ * \remarks Buckets are laid out in the segment with open addressing (linear probing),
+ *          and the capacity is fixed when the segment is created.
+ *          - Writers claim an empty bucket with a CAS on its state, and update a value
+ *            by turning its sequence odd with a CAS, so writers of different keys never block each other.
+ *          - Readers copy the value in place and retry if the sequence changed (seqlock), they never write.
+ *          Keys cannot be erased. The key and value types must be trivially copyable,
+ *          and Hash must give the same result in every process (e.g. std::hash of integers).
+ *
+ * \tparam Key The type of the key.
+ * \tparam T The type of the value.
+ */
+template <typename Key, typename T,
+          typename Hash     = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class shm_hash_map {
+
+  static_assert(std::is_trivially_copyable<Key>::value, "Key must be trivially copyable.");
+  static_assert(std::is_trivially_copyable<T>::value  , "T must be trivially copyable.");
+
+  enum : std::uint32_t {
+    magic = 0x50414D48, // "HMAP"
+  };
+
+  enum : std::uint32_t {
+    state_empty,
+    state_initializing,
+    state_ready
+  };
+
+  enum : unsigned {
+    ready_timeout = 3000 // times of waiting for the initializing process
+  };
+
+  struct head_t {
+    std::uint32_t              magic_;
+    std::atomic<std::uint32_t> state_;
+    std::uint64_t              capacity_;
+    std::uint32_t              key_size_;
+    std::uint32_t              value_size_;
+    std::atomic<std::uint64_t> count_;
+  };
+
+  struct bucket_t {
+    std::atomic<std::uint32_t> state_;  // state_empty -> state_initializing -> state_ready
+    std::atomic<std::uint64_t> seq_;    // odd while the value is being written, never wraps to 0
+    ipc::aligned<Key>          key_;
+    ipc::aligned<T>            value_;
+  };
+
+  ipc::shm::handle shm_;
+  head_t   *head_    = nullptr;
+  bucket_t *buckets_ = nullptr;
+  std::size_t mask_  = 0;
+
+  static constexpr std::size_t head_size() noexcept {
+    return ipc::round_up<std::size_t>(sizeof(head_t), alignof(bucket_t));
+  }
+
+  static std::size_t round_capacity(std::size_t n) noexcept {
+    std::size_t c = 2;
+    while (c < n) c <<= 1;
+    return c;
+  }
+
+  bool init_head(std::size_t capacity) noexcept {
+    LIBIPC_LOG();
+    // The memory of a new segment is zero-filled, so the state can be read before construction.
+    auto state = static_cast<std::uint32_t>(state_empty);
+    if (head_->state_.compare_exchange_strong(state, state_initializing, std::memory_order_acq_rel)) {
+      head_->magic_      = magic;
+      head_->capacity_   = capacity;
+      head_->key_size_   = sizeof(Key);
+      head_->value_size_ = sizeof(T);
+      head_->count_.store(0, std::memory_order_relaxed);
+      head_->state_.store(state_ready, std::memory_order_release);
+      return true;
+    }
+    for (unsigned k = 0, n = 0; head_->state_.load(std::memory_order_acquire) != state_ready; ++n) {
+      if (n >= ready_timeout) {
+        log.error("the shm_hash_map is not initialized: ", shm_.name());
+        return false;
+      }
+      ipc::sleep(k);
+    }
+    if ((head_->magic_      != magic)
+     || (head_->capacity_   != capacity)
+     || (head_->key_size_   != sizeof(Key))
+     || (head_->value_size_ != sizeof(T))) {
+      log.error("the segment holds a different shm_hash_map: ", shm_.name(),
+                ", capacity = ", head_->capacity_, ", expected = ", capacity,
+                ", key size = ", head_->key_size_, ", expected = ", sizeof(Key),
+                ", value size = ", head_->value_size_, ", expected = ", sizeof(T));
+      return false;
+    }
+    return true;
+  }
+
+  /// \brief Waits for a bucket being claimed by another writer to get its key.
+  static std::uint32_t wait_key(bucket_t &b) noexcept {
+    std::uint32_t st;
+    for (unsigned k = 0; (st = b.state_.load(std::memory_order_acquire)) == state_initializing;) {
+      ipc::yield(k);
+    }
+    return st;
+  }
+
+  /// \brief Finds the bucket of the key, claims an empty one if insert is true.
+  bucket_t *locate(Key const &key, bool insert) const noexcept {
+    std::size_t i = Hash{}(key) & mask_;
+    for (std::size_t n = 0; n <= mask_; ++n, i = (i + 1) & mask_) {
+      bucket_t &b = buckets_[i];
+      std::uint32_t st = b.state_.load(std::memory_order_acquire);
+      if ((st == state_empty) && insert) {
+        if (b.state_.compare_exchange_strong(st, state_initializing, std::memory_order_acq_rel)) {
+          std::memcpy(static_cast<void *>(b.key_.ptr()), &key, sizeof(Key));
+          b.state_.store(state_ready, std::memory_order_release);
+          head_->count_.fetch_add(1, std::memory_order_relaxed);
+          return &b;
+        }
+      }
+      if (st == state_empty) return nullptr; // the probing sequence ends here
+      if (st == state_initializing) st = wait_key(b);
+      if ((st == state_ready) && KeyEqual{}(*b.key_.ptr(), key)) {
+        return &b;
+      }
+    }
+    return nullptr;
+  }
+
+  static void write_value(bucket_t &b, T const &value) noexcept {
+    auto seq = b.seq_.load(std::memory_order_relaxed);
+    for (unsigned k = 0;;) {
+      if (((seq & 1) == 0) &&
+          b.seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        break;
+      }
+      ipc::yield(k);
+      seq = b.seq_.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(static_cast<void *>(b.value_.ptr()), &value, sizeof(T));
+    b.seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /// \brief Returns the sequence of the copied value, 0 if the value hasn't been assigned.
+  static std::uint64_t read_value(bucket_t const &b, T &value) noexcept {
+    for (unsigned k = 0;;) {
+      auto seq = b.seq_.load(std::memory_order_acquire);
+      if (seq == 0) return 0; // claimed but not yet assigned
+      if ((seq & 1) == 0) {
+        std::memcpy(static_cast<void *>(&value), b.value_.ptr(), sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (b.seq_.load(std::memory_order_relaxed) == seq) return seq;
+      }
+      ipc::yield(k);
+    }
+  }
+
+public:
+  using key_type    = Key;
+  using mapped_type = T;
+  using size_type   = std::size_t;
+
+  shm_hash_map() noexcept = default;
+
+  shm_hash_map(char const *name, std::size_t capacity) noexcept {
+    open(name, capacity);
+  }
+
+  ~shm_hash_map() noexcept {
+    close();
+  }
+
+  shm_hash_map(shm_hash_map const &) = delete;
+  shm_hash_map &operator=(shm_hash_map const &) = delete;
+
+  /// \brief The bytes of the segment holding a map of the capacity (rounded up to a power of 2).
+  static std::size_t storage_size(std::size_t capacity) noexcept {
+    return head_size() + sizeof(bucket_t) * round_capacity(capacity);
+  }
+
+  bool valid() const noexcept {
+    return head_ != nullptr;
+  }
+
+  /// \brief Opens the map, every process must use the same types and capacity.
+  /// \remarks A smaller segment is rejected, but a larger one can't be detected
+  ///          since the segment is then mapped again with another size.
+  bool open(char const *name, std::size_t capacity) noexcept {
+    LIBIPC_LOG();
+    close();
+    if (capacity == 0) {
+      log.error("invalid capacity of shm_hash_map: ", name);
+      return false;
+    }
+    std::size_t cap = round_capacity(capacity);
+    if (!shm_.acquire(name, storage_size(cap))) {
+      log.error("failed: acquire the segment of shm_hash_map: ", name);
+      return false;
+    }
+    head_ = static_cast<head_t *>(shm_.get());
+    if (!init_head(cap)) {
+      head_ = nullptr;
+      shm_.release();
+      return false;
+    }
+    buckets_ = reinterpret_cast<bucket_t *>(reinterpret_cast<ipc::byte *>(head_) + head_size());
+    mask_    = cap - 1;
+    return true;
+  }
+
+  void close() noexcept {
+    head_    = nullptr;
+    buckets_ = nullptr;
+    mask_    = 0;
+    shm_.release();
+  }
+
+  /// \brief Closes the map and removes the segment from the system.
+  void clear() noexcept {
+    head_    = nullptr;
+    buckets_ = nullptr;
+    mask_    = 0;
+    shm_.clear();
+  }
+
+  static void clear_storage(char const *name) noexcept {
+    ipc::shm::handle::clear_storage(name);
+  }
+
+  char const *name() const noexcept {
+    return shm_.name();
+  }
+
+  size_type capacity() const noexcept {
+    return valid() ? (mask_ + 1) : 0;
+  }
+
+  /// \brief The number of keys, including the ones whose value is still being assigned.
+  size_type size() const noexcept {
+    return valid() ? static_cast<size_type>(head_->count_.load(std::memory_order_relaxed)) : 0;
+  }
+
+  bool empty() const noexcept {
+    return size() == 0;
+  }
+
+  /// \brief Inserts the key, or assigns the value of the existing one.
+  /// \return false if the map is full.
+  bool insert_or_assign(Key const &key, T const &value) noexcept {
+    size_type index;
+    return insert_or_assign(key, value, index);
+  }
+
+  /// \brief Inserts or assigns as above, and gives the index of the bucket holding the key.
+  bool insert_or_assign(Key const &key, T const &value, size_type &index) noexcept {
+    if (!valid()) return false;
+    bucket_t *b = locate(key, true);
+    if (b == nullptr) return false;
+    write_value(*b, value);
+    index = static_cast<size_type>(b - buckets_);
+    return true;
+  }
+
+  /// \brief Copies the latest value of the key without any write to the segment.
+  bool find(Key const &key, T &value) const noexcept {
+    if (!valid()) return false;
+    bucket_t *b = locate(key, false);
+    if (b == nullptr) return false;
+    return read_value(*b, value) != 0;
+  }
+
+  /// \brief Copies the key and the latest value held by the bucket at index (less than 'capacity()').
+  /// \return The sequence of the value, which grows with every assignment, 0 if the bucket has no value.
+  std::uint64_t load_at(size_type index, Key &key, T &value) const noexcept {
+    if (!valid() || (index > mask_)) return 0;
+    bucket_t const &b = buckets_[index];
+    if (b.state_.load(std::memory_order_acquire) != state_ready) return 0;
+    std::memcpy(static_cast<void *>(&key), b.key_.ptr(), sizeof(Key));
+    return read_value(b, value);
+  }
+
+  bool contains(Key const &key) const noexcept {
+    T value;
+    return find(key, value);
+  }
+
+  /// \brief Visits every key with its latest value, the map may be changed at the same time.
+  template <typename F>
+  void for_each(F &&f) const {
+    if (!valid()) return;
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      bucket_t const &b = buckets_[i];
+      if (b.state_.load(std::memory_order_acquire) != state_ready) continue;
+      T value;
+      if (read_value(b, value) != 0) f(*b.key_.ptr(), value);
+    }
+  }
+};
+
+} // namespace ipc
@@ -1,7 +1,8 @@
 #include "libipc/buffer.h"
-#include "libipc/utility/pimpl.h"
+#include "libipc/mem/new.h"
 
 #include <cstring>
+#include <utility>
 
 namespace ipc {
 
@@ -13,33 +14,36 @@ bool operator!=(buffer const & b1, buffer const & b2) {
     return !(b1 == b2);
 }
 
-class buffer::buffer_ : public pimpl<buffer_> {
-public:
-    void*       p_;
-    std::size_t s_;
-    void*       a_;
-    buffer::destructor_t d_;
-
-    buffer_(void* p, std::size_t s, buffer::destructor_t d, void* a)
-        : p_(p), s_(s), a_(a), d_(d) {
-    }
-
-    ~buffer_() {
-        if (d_ == nullptr) return;
-        d_((a_ == nullptr) ? p_ : a_, s_);
-    }
-};
-
-buffer::buffer()
-    : buffer(nullptr, 0, nullptr, nullptr) {
+buffer::buffer() noexcept
+    : p_(nullptr), s_(0), a_(nullptr), d_(nullptr), st_(storage::none) {
 }
 
 buffer::buffer(void* p, std::size_t s, destructor_t d)
-    : p_(p_->make(p, s, d, nullptr)) {
+    : buffer(p, s, d, nullptr) {
 }
 
 buffer::buffer(void* p, std::size_t s, destructor_t d, void* mem_to_free)
-    : p_(p_->make(p, s, d, mem_to_free)) {
+    : p_(p), s_(s), a_(mem_to_free), d_(d), st_(storage::none) {
+}
+
+buffer::buffer(void* p, std::size_t s, destructor_t d, void const * ctx, std::size_t ctx_size)
+    : buffer(p, s, d, nullptr) {
+    if ((ctx == nullptr) || (ctx_size == 0)) return;
+    if (ctx_size <= small_size) {
+        std::memcpy(sbo_, ctx, ctx_size);
+        a_  = sbo_;
+        st_ = storage::context;
+        return;
+    }
+    // Too large to be stored inline, keep its size in the unused inline storage.
+    a_ = mem::alloc(ctx_size);
+    if (a_ == nullptr) {
+        d_ = nullptr; // cannot call the destructor without its context
+        return;
+    }
+    std::memcpy(a_, ctx, ctx_size);
+    std::memcpy(sbo_, &ctx_size, sizeof(ctx_size));
+    st_ = storage::heap_context;
 }
 
 buffer::buffer(void* p, std::size_t s)
@@ -50,38 +54,105 @@ buffer::buffer(char & c)
     : buffer(&c, 1) {
 }
 
-buffer::buffer(buffer&& rhs)
+buffer::buffer(buffer&& rhs) noexcept
     : buffer() {
-    swap(rhs);
+    move_from(rhs);
 }
 
 buffer::~buffer() {
-    p_->clear();
+    reset();
+}
+
+buffer buffer::copy_of(void const * p, std::size_t s) {
+    buffer buf;
+    if ((p == nullptr) || (s == 0)) return buf;
+    if (s <= small_size) {
+        std::memcpy(buf.sbo_, p, s);
+        buf.p_  = buf.sbo_;
+        buf.s_  = s;
+        buf.st_ = storage::payload;
+        return buf;
+    }
+    void *mem = mem::$new<void>(s);
+    if (mem == nullptr) return buf;
+    std::memcpy(mem, p, s);
+    return buffer{mem, s, [](void *p, std::size_t) noexcept {
+        mem::$delete(p);
+    }};
+}
+
+void buffer::reset() noexcept {
+    if (d_ != nullptr) {
+        d_((a_ == nullptr) ? p_ : a_, s_);
+    }
+    if (st_ == storage::heap_context) {
+        std::size_t ctx_size;
+        std::memcpy(&ctx_size, sbo_, sizeof(ctx_size));
+        mem::free(a_, ctx_size);
+    }
+    p_  = nullptr;
+    s_  = 0;
+    a_  = nullptr;
+    d_  = nullptr;
+    st_ = storage::none;
+}
+
+void buffer::move_from(buffer& rhs) noexcept {
+    // The inline storage moves with the buffer, so pointers into it are rebased.
+    p_  = rhs.p_;
+    s_  = rhs.s_;
+    a_  = rhs.a_;
+    d_  = rhs.d_;
+    st_ = rhs.st_;
+    switch (st_) {
+    case storage::payload:
+        std::memcpy(sbo_, rhs.sbo_, s_);
+        p_ = sbo_;
+        break;
+    case storage::context:
+        std::memcpy(sbo_, rhs.sbo_, small_size);
+        a_ = sbo_;
+        break;
+    case storage::heap_context:
+        std::memcpy(sbo_, rhs.sbo_, sizeof(std::size_t));
+        break;
+    default:
+        break;
+    }
+    rhs.p_  = nullptr;
+    rhs.s_  = 0;
+    rhs.a_  = nullptr;
+    rhs.d_  = nullptr;
+    rhs.st_ = storage::none;
 }
 
-void buffer::swap(buffer& rhs) {
-    std::swap(p_, rhs.p_);
+void buffer::swap(buffer& rhs) noexcept {
+    if (this == &rhs) return;
+    buffer tmp {std::move(rhs)};
+    rhs.move_from(*this);
+    this->move_from(tmp);
 }
 
-buffer& buffer::operator=(buffer rhs) {
-    swap(rhs);
+buffer& buffer::operator=(buffer rhs) noexcept {
+    reset();
+    move_from(rhs);
     return *this;
 }
 
 bool buffer::empty() const noexcept {
-    return (impl(p_)->p_ == nullptr) || (impl(p_)->s_ == 0);
+    return (p_ == nullptr) || (s_ == 0);
 }
 
 void* buffer::data() noexcept {
-    return impl(p_)->p_;
+    return p_;
 }
 
 void const * buffer::data() const noexcept {
-    return impl(p_)->p_;
+    return p_;
 }
 
 std::size_t buffer::size() const noexcept {
-    return impl(p_)->s_;
+    return s_;
 }
 
 } // namespace ipc
@@ -120,16 +120,33 @@ public:
         return head_.cursor();
     }
 
+    /* Only the unicast policies know how many elements are not read yet. */
+    auto size() const noexcept {
+        return head_.size();
+    }
+
     template <typename Q, typename F>
     bool push(Q* que, F&& f) {
         return head_.push(que, std::forward<F>(f), block_);
     }
 
+    /* Only the multi-producer broadcast policy supports this. */
+    template <typename Q, typename F>
+    bool push_n(Q* que, std::size_t n, F&& f) {
+        return head_.push_n(que, n, std::forward<F>(f), block_);
+    }
+
     template <typename Q, typename F>
     bool force_push(Q* que, F&& f) {
         return head_.force_push(que, std::forward<F>(f), block_);
     }
 
+    /* Only the multi-producer broadcast policy supports this. */
+    template <typename Q, typename F>
+    bool force_push_n(Q* que, std::size_t n, F&& f) {
+        return head_.force_push_n(que, n, std::forward<F>(f), block_);
+    }
+
     template <typename Q, typename F, typename R>
     bool pop(Q* que, cursor_t* cur, F&& f, R&& out) {
         if (cur == nullptr) return false;
@@ -23,6 +23,28 @@ constexpr u1_t index_of(u2_t c) noexcept {
     return static_cast<u1_t>(c);
 }
 
+/* Returns the index of the lowest bit of a connection id, the slot of its receiver, 0 if none. */
+inline unsigned conn_index_of(cc_t c) noexcept {
+    if (c == 0) return 0;
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(c));
+#else
+    unsigned i = 0;
+    for (; (c & 1u) == 0; c >>= 1) ++i;
+    return i;
+#endif
+}
+
+/* The progress a broadcast receiver has reported about itself. */
+struct progress_t {
+    cc_t          cc_id;
+    u2_t          cursor;      // where it is reading
+    u2_t          lag_max;     // the largest lag seen whenever the progress is read
+    std::uint64_t last_pop;    // steady clock (ns) of its last pop reported, or of its connection
+    std::uint64_t dropped;
+    std::uint64_t overwritten;
+};
+
 class conn_head_base {
 protected:
     std::atomic<cc_t> cc_{0}; // connections
@@ -55,6 +77,26 @@ class conn_head;
 
 template <typename P>
 class conn_head<P, true> : public conn_head_base {
+
+    /* The topics each receiver subscribes to, indexed by the bit of its connected id, 0 for all. */
+    std::atomic<std::uint64_t> topics_[sizeof(cc_t) * 8] {};
+
+    /* The messages each receiver has lost under the backpressure policies of the senders. */
+    struct loss_t {
+        std::atomic<std::uint64_t> dropped_;
+        std::atomic<std::uint64_t> overwritten_;
+    } losses_[sizeof(cc_t) * 8] {};
+
+    /* The receivers overrun by a sender, until they catch up. */
+    std::atomic<cc_t> lagging_ {0};
+
+    /* The progress each receiver reports after its pops, each one on its own cache line. */
+    struct alignas(cache_line_size) track_t {
+        std::atomic<u2_t> cursor_;
+        mutable std::atomic<u2_t> lag_max_; // updated by the readers of the progress
+        std::atomic<std::uint64_t> last_pop_;
+    } tracks_[sizeof(cc_t) * 8] {};
+
 public:
     cc_t connect() noexcept {
         for (unsigned k = 0;; ipc::yield(k)) {
@@ -70,10 +112,123 @@ public:
         }
     }
 
+    /**
+     * \brief Reserves the first free id, lets 'init(id)' set its state up, then publishes it.
+     * \remarks The senders see nothing of the new receiver until 'init' is done,
+     *          the callers connecting concurrently should be serialized by themselves.
+    */
+    template <typename F>
+    cc_t connect(F &&init) noexcept {
+        for (unsigned k = 0;; ipc::yield(k)) {
+            cc_t curr = this->cc_.load(std::memory_order_acquire);
+            cc_t next = curr | (curr + 1);
+            if (next == curr) {
+                return 0;
+            }
+            init(next ^ curr);
+            if (this->cc_.compare_exchange_weak(curr, next, std::memory_order_release)) {
+                return next ^ curr;
+            }
+        }
+    }
+
     cc_t disconnect(cc_t cc_id) noexcept {
+        // The slots of the disconnected receivers go back to all topics, with no loss.
+        for (cc_t rem = cc_id; rem != 0; rem &= rem - 1) {
+            auto i = conn_index_of(rem & ~(rem - 1));
+            topics_[i].store(0, std::memory_order_relaxed);
+            losses_[i].dropped_    .store(0, std::memory_order_relaxed);
+            losses_[i].overwritten_.store(0, std::memory_order_relaxed);
+            tracks_[i].lag_max_    .store(0, std::memory_order_relaxed);
+        }
+        lagging_.fetch_and(~cc_id, std::memory_order_relaxed);
         return this->cc_.fetch_and(~cc_id, std::memory_order_acq_rel) & ~cc_id;
     }
 
+    /**
+     * \brief Sets the topics the receiver is interested in, 0 for all.
+     * \remarks The senders wouldn't address the messages of other topics to the receiver.
+    */
+    void subscribe(cc_t cc_id, std::uint64_t topics) noexcept {
+        if (cc_id == 0) return;
+        topics_[conn_index_of(cc_id)].store(topics, std::memory_order_release);
+    }
+
+    /* Picks the receivers in 'cc' interested in the topics, 0 for all topics. */
+    cc_t recipients(cc_t cc, std::uint64_t topics) const noexcept {
+        if (topics == 0) return cc;
+        cc_t to = 0;
+        for (cc_t rem = cc; rem != 0; rem &= rem - 1) {
+            cc_t id = rem & ~(rem - 1);
+            auto t = topics_[conn_index_of(id)].load(std::memory_order_acquire);
+            if ((t == 0) || ((t & topics) != 0)) to |= id;
+        }
+        return to;
+    }
+
+    /* Counts a message dropped for the receivers in 'cc'. */
+    void count_dropped(cc_t cc) noexcept {
+        for (cc_t rem = cc; rem != 0; rem &= rem - 1) {
+            losses_[conn_index_of(rem & ~(rem - 1))].dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /* Counts a message overwritten before the receivers in 'cc' have read it, and marks them lagging. */
+    void overrun(cc_t cc) noexcept {
+        for (cc_t rem = cc; rem != 0; rem &= rem - 1) {
+            losses_[conn_index_of(rem & ~(rem - 1))].overwritten_.fetch_add(1, std::memory_order_relaxed);
+        }
+        lagging_.fetch_or(cc, std::memory_order_relaxed);
+    }
+
+    cc_t lagging() const noexcept {
+        return lagging_.load(std::memory_order_relaxed);
+    }
+
+    /* Records where the receiver is, and the time of its last pop unless 'now' is 0. */
+    void track(cc_t cc_id, u2_t cursor, std::uint64_t now) noexcept {
+        if (cc_id == 0) return;
+        auto &t = tracks_[conn_index_of(cc_id)];
+        t.cursor_.store(cursor, std::memory_order_relaxed);
+        if (now != 0) t.last_pop_.store(now, std::memory_order_relaxed);
+    }
+
+    /* Clears the lagging mark of a receiver which has read everything. */
+    void caught_up(cc_t cc_id) noexcept {
+        lagging_.fetch_and(~cc_id, std::memory_order_relaxed);
+    }
+
+    /* Fills the progress of the connected receivers, 'cursor' is the one of the writers. */
+    std::size_t progress(progress_t *out, std::size_t n, u2_t cursor) const noexcept {
+        std::size_t i = 0;
+        for (cc_t rem = this->connections(); (rem != 0) && (i < n); rem &= rem - 1) {
+            cc_t id = rem & ~(rem - 1);
+            auto const &t = tracks_[conn_index_of(id)];
+            auto &p = out[i++];
+            p.cc_id    = id;
+            p.cursor   = t.cursor_  .load(std::memory_order_relaxed);
+            p.last_pop = t.last_pop_.load(std::memory_order_relaxed);
+            // the lag is only measured here, rather than on each pop of the receiver
+            u2_t lag = cursor - p.cursor;
+            p.lag_max  = t.lag_max_ .load(std::memory_order_relaxed);
+            while ((lag > p.lag_max) &&
+                   !t.lag_max_.compare_exchange_weak(p.lag_max, lag, std::memory_order_relaxed)) ;
+            if (lag > p.lag_max) p.lag_max = lag;
+            losses(id, p.dropped, p.overwritten);
+        }
+        return i;
+    }
+
+    void losses(cc_t cc_id, std::uint64_t &dropped, std::uint64_t &overwritten) const noexcept {
+        if (cc_id == 0) {
+            dropped = overwritten = 0;
+            return;
+        }
+        auto const &l = losses_[conn_index_of(cc_id)];
+        dropped     = l.dropped_    .load(std::memory_order_relaxed);
+        overwritten = l.overwritten_.load(std::memory_order_relaxed);
+    }
+
     bool connected(cc_t cc_id) const noexcept {
         return (this->connections() & cc_id) != 0;
     }
@@ -88,6 +243,9 @@ public:
 
 template <typename P>
 class conn_head<P, false> : public conn_head_base {
+
+    std::atomic<std::uint64_t> dropped_ {0}; // messages dropped for the only receiver
+
 public:
     cc_t connect() noexcept {
         return this->cc_.fetch_add(1, std::memory_order_relaxed) + 1;
@@ -104,6 +262,38 @@ public:
         }
     }
 
+    /* Topics are only supported in broadcast mode. */
+    void subscribe(cc_t /*cc_id*/, std::uint64_t /*topics*/) noexcept {}
+
+    cc_t recipients(cc_t cc, std::uint64_t /*topics*/) const noexcept {
+        return cc;
+    }
+
+    /* A message could never be overwritten in non-broadcast mode. */
+    void count_dropped(cc_t cc) noexcept {
+        if (cc != 0) dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void overrun(cc_t /*cc*/) noexcept {}
+
+    cc_t lagging() const noexcept {
+        return 0;
+    }
+
+    /* The progress is only tracked in broadcast mode. */
+    void track(cc_t /*cc_id*/, u2_t /*cursor*/, std::uint64_t /*now*/) noexcept {}
+
+    void caught_up(cc_t /*cc_id*/) noexcept {}
+
+    std::size_t progress(progress_t * /*out*/, std::size_t /*n*/, u2_t /*cursor*/) const noexcept {
+        return 0;
+    }
+
+    void losses(cc_t cc_id, std::uint64_t &dropped, std::uint64_t &overwritten) const noexcept {
+        dropped     = (cc_id == 0) ? 0 : dropped_.load(std::memory_order_relaxed);
+        overwritten = 0;
+    }
+
     bool connected(cc_t cc_id) const noexcept {
         // In non-broadcast mode, connection tags are only used for counting.
         return (this->connections() != 0) && (cc_id != 0);
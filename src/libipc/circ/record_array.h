@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>   // std::atomic<?>
+#include <limits>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "libipc/def.h"
+#include "libipc/rw_lock.h"
+
+#include "libipc/circ/elem_def.h"
+#include "libipc/platform/detail.h"
+#include "libipc/utility/utility.h"
+
+namespace ipc {
+namespace circ {
+
+enum : std::size_t {
+    record_ring_default = 64 * 1024 // 64KB
+};
+
+/**
+ * \brief A byte ring storing contiguous, length-prefixed records.
+ *
+ * \remarks Unlike 'elem_array', a message is not split into fixed-size slots:
+ *          the sender claims 'record_head + payload' bytes with one CAS on the claim cursor,
+ *          copies the payload once, and publishes it with one store to the commit flag of the record.
+ *          When a record doesn't fit before the end of the ring, a padding record fills the tail
+ *          and the record starts over from offset 0.
+ *          Payloads may use up to half of the ring, so that a record with its padding always fits.
+*/
+template <typename Flag, std::size_t RingSize = record_ring_default>
+class record_array : public ipc::circ::conn_head<Flag> {
+public:
+    using base_t   = ipc::circ::conn_head<Flag>;
+    using flag_t   = Flag;
+    using policy_t = Flag;
+    using cursor_t = std::uint64_t;
+
+    struct record_head {
+        std::uint32_t size_;    // payload size in bytes
+        std::uint32_t padding_; // != 0 means this record only fills the tail of the ring
+    };
+
+    enum : std::size_t {
+        ring_size    = RingSize,
+        record_align = alignof(std::max_align_t),
+        head_size    = ipc::make_align(record_align, sizeof(record_head)),
+        flag_count   = ring_size / record_align,
+        max_payload  = ring_size / 2 - head_size,
+        conn_max     = (relat_trait<flag_t>::is_broadcast ? sizeof(cc_t) * 8 : 1)
+    };
+
+    static_assert((ring_size & (ring_size - 1)) == 0, "RingSize must be a power of 2.");
+    static_assert(ring_size >= record_align * 4, "RingSize is too small.");
+    static_assert(relat_trait<flag_t>::is_broadcast || !relat_trait<flag_t>::is_multi_consumer,
+                  "Unicast record_array only supports a single consumer.");
+
+private:
+    alignas(cache_line_size) std::atomic<cursor_t> ct_ {0};    // claim cursor
+    alignas(cache_line_size) std::atomic<cursor_t> rd_[conn_max] {}; // read cursors
+    std::atomic<std::uint64_t> f_ct_[flag_count] {};          // commit flags, one per aligned unit
+    alignas(record_align) ipc::byte_t block_[ring_size] {};
+
+    /* in shm, it should be 0 whether it's initialized or not. */
+    std::atomic_flag sender_ = ATOMIC_FLAG_INIT;
+    std::atomic_flag reader_ = ATOMIC_FLAG_INIT;
+
+    // make these be private
+    using base_t::connect;
+    using base_t::disconnect;
+
+    constexpr static std::size_t offset_of(cursor_t cur) noexcept {
+        return static_cast<std::size_t>(cur & (ring_size - 1));
+    }
+
+    std::atomic<std::uint64_t> &commit_flag(cursor_t cur) noexcept {
+        return f_ct_[offset_of(cur) / record_align];
+    }
+
+    record_head *head_at(cursor_t cur) noexcept {
+        return reinterpret_cast<record_head *>(block_ + offset_of(cur));
+    }
+
+    static unsigned reader_index(cc_t cc_id) noexcept {
+        return relat_trait<flag_t>::is_broadcast ? conn_index_of(cc_id) : 0;
+    }
+
+    /* the oldest cursor among the connected readers */
+    cursor_t read_cursor(cc_t cc, cursor_t cur) const noexcept {
+        if (!relat_trait<flag_t>::is_broadcast) {
+            return rd_[0].load(std::memory_order_acquire);
+        }
+        cursor_t min_rd = cur;
+        for (; cc != 0; cc &= cc - 1) {
+            auto rd = rd_[conn_index_of(cc)].load(std::memory_order_acquire);
+            if (static_cast<std::int64_t>(min_rd - rd) > 0) min_rd = rd;
+        }
+        return min_rd;
+    }
+
+    /*
+     * A new reader starts reading from the current claim cursor,
+     * which is stored before its id is published, or the writers would take the cursor
+     * the previous reader of the slot has left for the oldest one.
+     * The slot is only reserved, not owned, until it's published, so the readers connect one by one.
+    */
+    cc_t connect_reader(std::true_type) noexcept {
+        LIBIPC_UNUSED auto guard = ipc::detail::unique_lock(this->lc_);
+        return base_t::connect([this](cc_t cc_id) {
+            rd_[reader_index(cc_id)].store(ct_.load(std::memory_order_acquire), std::memory_order_release);
+        });
+    }
+
+    cc_t connect_reader(std::false_type) noexcept {
+        return base_t::connect();
+    }
+
+public:
+    bool connect_sender() noexcept {
+        if (relat_trait<flag_t>::is_multi_producer) return true;
+        return !sender_.test_and_set(std::memory_order_acq_rel);
+    }
+
+    void disconnect_sender() noexcept {
+        if (relat_trait<flag_t>::is_multi_producer) return;
+        sender_.clear();
+    }
+
+    cc_t connect_receiver() noexcept {
+        if (!relat_trait<flag_t>::is_multi_consumer &&
+            reader_.test_and_set(std::memory_order_acq_rel)) {
+            return 0;
+        }
+        return connect_reader(std::integral_constant<bool, relat_trait<flag_t>::is_broadcast>{});
+    }
+
+    cc_t disconnect_receiver(cc_t cc_id) noexcept {
+        if (!relat_trait<flag_t>::is_multi_consumer) reader_.clear();
+        return base_t::disconnect(cc_id);
+    }
+
+    cursor_t cursor() const noexcept {
+        if (relat_trait<flag_t>::is_broadcast) {
+            return ct_.load(std::memory_order_acquire);
+        }
+        return rd_[0].load(std::memory_order_acquire);
+    }
+
+    /**
+     * \brief Claims a record of 'size' bytes, lets 'f' fill it, then publishes it.
+     * \return false if there is no reader (broadcast), the ring is full or 'size' is too large.
+    */
+    template <typename Q, typename F>
+    bool push(Q* /*que*/, std::size_t size, F&& f) {
+        if (size > max_payload) return false;
+        std::size_t need = ipc::make_align(record_align, head_size + size);
+        cursor_t cur, nxt;
+        std::size_t pad;
+        for (unsigned k = 0;;) {
+            cc_t cc = this->connections(std::memory_order_relaxed);
+            if (relat_trait<flag_t>::is_broadcast && (cc == 0)) {
+                return false; // no reader
+            }
+            cur = ct_.load(std::memory_order_relaxed);
+            std::size_t rem = ring_size - offset_of(cur);
+            pad = (rem < need) ? rem : 0;
+            nxt = cur + pad + need;
+            if ((nxt - read_cursor(cc, cur)) > ring_size) {
+                return false; // full
+            }
+            if (ct_.compare_exchange_weak(cur, nxt, std::memory_order_acq_rel)) {
+                break;
+            }
+            ipc::yield(k);
+        }
+        if (pad != 0) {
+            auto *ph = head_at(cur);
+            ph->size_    = static_cast<std::uint32_t>(pad - head_size);
+            ph->padding_ = 1;
+            commit_flag(cur).store(~cur, std::memory_order_release);
+            cur += pad;
+        }
+        auto *rh = head_at(cur);
+        rh->size_    = static_cast<std::uint32_t>(size);
+        rh->padding_ = 0;
+        std::forward<F>(f)(reinterpret_cast<ipc::byte_t *>(rh) + head_size);
+        commit_flag(cur).store(~cur, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Passes the payload of the next committed record to 'f(void const *, std::size_t)'.
+     * \return false if there is no committed record at 'cur'.
+    */
+    template <typename Q, typename F>
+    bool pop(Q* que, cursor_t* cur, F&& f) {
+        if (cur == nullptr) return false;
+        auto &rd = rd_[reader_index(que->connected_id())];
+        for (;;) {
+            if (commit_flag(*cur).load(std::memory_order_acquire) != ~(*cur)) {
+                return false; // empty
+            }
+            auto *rh = head_at(*cur);
+            cursor_t nxt = *cur + ipc::make_align(record_align, head_size + rh->size_);
+            if (rh->padding_ != 0) {
+                rd.store(*cur = nxt, std::memory_order_release);
+                continue;
+            }
+            std::forward<F>(f)(reinterpret_cast<ipc::byte_t const *>(rh) + head_size,
+                               static_cast<std::size_t>(rh->size_));
+            rd.store(*cur = nxt, std::memory_order_release);
+            return true;
+        }
+    }
+};
+
+} // namespace circ
+} // namespace ipc
@@ -21,8 +21,9 @@
 
 #include "libipc/imp/log.h"
 #include "libipc/utility/id_pool.h"
-#include "libipc/utility/scope_guard.h"
 #include "libipc/utility/utility.h"
+#include "libipc/utility/scope_guard.h"
+#include "libipc/utility/log_histogram.h"
 
 #include "libipc/mem/resource.h"
 #include "libipc/mem/new.h"
@@ -31,8 +32,14 @@
 
 namespace {
 
-using msg_id_t = std::uint32_t;
-using acc_t    = std::atomic<msg_id_t>;
+using msg_id_t  = std::uint32_t;
+using msg_key_t = std::uint64_t;
+using acc_t     = std::atomic<msg_id_t>;
+
+/* message ids are only unique per sender, so a message is identified by (cc_id, id) */
+constexpr msg_key_t msg_key(msg_id_t cc_id, msg_id_t id) noexcept {
+    return (static_cast<msg_key_t>(cc_id) << 32) | static_cast<msg_key_t>(id);
+}
 
 template <std::size_t DataSize, std::size_t AlignSize>
 struct msg_t;
@@ -43,15 +50,24 @@ struct msg_t<0, AlignSize> {
     msg_id_t     id_;
     std::int32_t remain_;
     bool         storage_;
+    bool         head_;     // the first (or the only) fragment of a message
+    bool         stamped_;  // the time of sending is in the last bytes of the data, see 'stamp'
 };
 
+/*
+ * A sender tracing latency stamps the element ending a message with the time of sending,
+ * if the data leaves room for it: a large message, or the last bytes of the others.
+*/
 template <std::size_t DataSize, std::size_t AlignSize>
 struct msg_t : msg_t<0, AlignSize> {
     std::aligned_storage_t<DataSize, AlignSize> data_ {};
 
+    static constexpr std::size_t stamp_offset = sizeof(data_) - sizeof(std::uint64_t);
+
     msg_t() = default;
-    msg_t(msg_id_t cc_id, msg_id_t id, std::int32_t remain, void const * data, std::size_t size)
-        : msg_t<0, AlignSize> {cc_id, id, remain, (data == nullptr) || (size == 0)} {
+    msg_t(msg_id_t cc_id, msg_id_t id, std::int32_t remain, void const * data, std::size_t size, bool head,
+          std::uint64_t stamp)
+        : msg_t<0, AlignSize> {cc_id, id, remain, (data == nullptr) || (size == 0), head, false} {
         if (this->storage_) {
             if (data != nullptr) {
                 // copy storage-id
@@ -60,6 +76,19 @@ struct msg_t : msg_t<0, AlignSize> {
             }
         }
         else std::memcpy(&data_, data, size);
+        if ((stamp != 0) && (this->storage_ || ((remain <= 0) && (size <= stamp_offset)))) {
+            this->stamped_ = true;
+            std::memcpy(reinterpret_cast<ipc::byte_t *>(&data_) + stamp_offset, &stamp, sizeof(stamp));
+        }
+    }
+
+    /* When the message was sent, 0 if it isn't stamped. */
+    std::uint64_t stamp() const noexcept {
+        std::uint64_t s = 0;
+        if (this->stamped_) {
+            std::memcpy(&s, reinterpret_cast<ipc::byte_t const *>(&data_) + stamp_offset, sizeof(s));
+        }
+        return s;
     }
 };
 
@@ -93,14 +122,30 @@ acc_t *cc_acc(std::string const &pref) {
     return static_cast<acc_t *>(it->second.get());
 }
 
+/*
+ * The message being reassembled from its fragments.
+ * The fragments of a message are contiguous in the queue,
+ * so there is at most one message in progress on a connection.
+*/
 struct cache_t {
-    std::size_t fill_;
+    msg_key_t   key_  {};
+    std::size_t fill_ {};
     ipc::buff_t buff_;
 
-    cache_t(std::size_t f, ipc::buff_t && b)
-        : fill_(f), buff_(std::move(b))
+    cache_t() = default;
+    cache_t(msg_key_t k, std::size_t f, ipc::buff_t && b)
+        : key_(k), fill_(f), buff_(std::move(b))
     {}
 
+    bool empty() const noexcept {
+        return buff_.empty();
+    }
+
+    /* whether a fragment of 'remain_size' bytes (including itself) continues this message */
+    bool follows(msg_key_t key, std::size_t remain_size) const noexcept {
+        return !empty() && (key_ == key) && (fill_ + remain_size == buff_.size());
+    }
+
     void append(void const * data, std::size_t size) {
         if (fill_ >= buff_.size() || data == nullptr || size == 0) return;
         auto new_fill = (ipc::detail::min)(fill_ + size, buff_.size());
@@ -109,24 +154,247 @@ struct cache_t {
     }
 };
 
+enum : ipc::storage_id_t {
+    storage_failed    = -1,         // the storage could not be mapped
+    storage_exhausted = -2,         // all the storages are in use
+    segment_id_flag   = 0x40000000  // the storage is a dedicated segment of the sender
+};
+
+enum : std::size_t {
+    segment_align = 64 * 1024
+};
+
+/*
+ * The head of a dedicated segment, which carries the payload of one large message at a time.
+ * The sender keeps a small pool of these segments and reuses one after all its readers have finished.
+*/
+struct segment_head_t {
+    enum : std::uint64_t {
+        conns_mask  = 0x00000000ffffffffull,
+        orphan_flag = 0x0000000100000000ull // the sender has gone, the last reader removes the segment
+    };
+
+    std::atomic<std::uint64_t> state_; // readers who haven't finished | orphan_flag
+
+    void *data() noexcept {
+        return reinterpret_cast<ipc::byte_t *>(this)
+             + ipc::make_align(alignof(std::max_align_t), sizeof(segment_head_t));
+    }
+};
+
+IPC_CONSTEXPR_ std::size_t calc_segment_size(std::size_t size) noexcept {
+    return ipc::make_align(segment_align, 
+           ipc::make_align(alignof(std::max_align_t), sizeof(segment_head_t)) + size);
+}
+
+/* A segment id holds the slot in the pool of the sender, and the generation of the segment in this slot. */
+IPC_CONSTEXPR_ ipc::storage_id_t make_segment_id(std::size_t slot, std::uint32_t gen) noexcept {
+    return segment_id_flag | static_cast<ipc::storage_id_t>(((gen & 0x3fffff) << 8) | (slot & 0xff));
+}
+
+constexpr bool is_segment_id(ipc::storage_id_t id) noexcept {
+    return (id >= 0) && ((id & segment_id_flag) != 0);
+}
+
+/*
+ * Keeps only the 'remain' readers of a segment.
+ * Returns true if this has removed the last reader of an orphan segment,
+ * then the caller takes over the shm reference left by the sender.
+*/
+bool sub_segment_rc(segment_head_t *head, ipc::circ::cc_t remain) noexcept {
+    auto &state = head->state_;
+    for (unsigned k = 0;;) {
+        auto cur = state.load(std::memory_order_acquire);
+        auto nxt = cur & (static_cast<std::uint64_t>(remain) | segment_head_t::orphan_flag);
+        bool last = ((cur & segment_head_t::conns_mask) != 0) && ((nxt & segment_head_t::conns_mask) == 0);
+        if (last) nxt &= ~static_cast<std::uint64_t>(segment_head_t::orphan_flag);
+        if (state.compare_exchange_weak(cur, nxt, std::memory_order_acq_rel)) {
+            return last && ((cur & segment_head_t::orphan_flag) != 0);
+        }
+        ipc::yield(k);
+    }
+}
+
+struct segment_t {
+    ipc::shm::handle shm_;
+    std::uint32_t    gen_ = 0;
+};
+
+/* The counters in 'stats_segment_t', in the same order as the fields of 'ipc::chan_stats'. */
+enum stat_id : std::size_t {
+    stat_msgs_sent,
+    stat_bytes_sent,
+    stat_msgs_recv,
+    stat_bytes_recv,
+    stat_fragment_sends,
+    stat_large_sends,
+    stat_force_pushes,
+    stat_wait_timeouts,
+    stat_storage_fallbacks,
+    stat_count
+};
+
+/*
+ * The counters of a channel, in a segment of their own ("ST_CONN__"),
+ * so that any process may read them without connecting to the channel.
+ * Each connection adds to the shard picked by its id, a reader sums all the shards up.
+*/
+struct stats_segment_t {
+    enum : std::size_t {
+        shard_count = 64,
+        chunk_words = (ipc::huge_msg_limit / ipc::large_msg_align + 2 + 63) / 64
+    };
+
+    struct alignas(ipc::cache_line_size) shard_t {
+        std::atomic<std::uint64_t> counters_[stat_count];
+    };
+
+    shard_t shards_[shard_count];
+
+    std::atomic<std::uint64_t> chunk_sizes_[chunk_words]; // bits of the chunk sizes (in large_msg_align) in use
+
+    void sum(std::uint64_t (&counters)[stat_count]) const noexcept {
+        for (auto &c : counters) c = 0;
+        for (auto const &shard : shards_) {
+            for (std::size_t i = 0; i < stat_count; ++i) {
+                counters[i] += shard.counters_[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+std::string stats_name(std::string const &prefix, std::string const &name) {
+    return ipc::make_prefix(prefix, "ST_CONN__", name);
+}
+
+/*
+ * The latency histograms of a channel ("LT_CONN__"), far larger than the counters,
+ * so they are only created once a sender traces the latency.
+*/
+struct latency_segment_t {
+    enum : std::size_t {
+        recv_max = sizeof(ipc::circ::cc_t) * 8
+    };
+
+    ipc::log_histogram latency_;               // of all the receivers
+    ipc::log_histogram recv_latency_[recv_max]; // by the connection index
+};
+
+std::string latency_name(std::string const &prefix, std::string const &name) {
+    return ipc::make_prefix(prefix, "LT_CONN__", name);
+}
+
+/*
+ * A waiter opened on its first use,
+ * so a connection which never waits or notifies on it won't create its storage.
+*/
+class lazy_waiter {
+    ipc::detail::waiter waiter_;
+    std::string         name_;
+    std::atomic<bool>   opened_ {false};
+    bool                quit_   = false; // quit_waiting is called before it is opened
+    std::mutex          lock_;
+
+public:
+    explicit lazy_waiter(std::string name)
+        : name_{std::move(name)} {}
+
+    bool opened() const noexcept {
+        return opened_.load(std::memory_order_acquire);
+    }
+
+    ipc::detail::waiter &get() {
+        if (!opened()) {
+            LIBIPC_UNUSED std::lock_guard<std::mutex> guard {lock_};
+            if (!opened_.load(std::memory_order_relaxed) && waiter_.open(name_.c_str())) {
+                if (quit_) waiter_.quit_waiting();
+                opened_.store(true, std::memory_order_release);
+            }
+        }
+        return waiter_;
+    }
+
+    /* opens it on caller-provided memory right away */
+    bool open(void *mem, bool init) noexcept {
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {lock_};
+        if (!waiter_.open(mem, init)) return false;
+        opened_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void clear() noexcept {
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {lock_};
+        if (opened_.exchange(false, std::memory_order_acq_rel)) {
+            waiter_.clear();
+        } else {
+            ipc::detail::waiter::clear_storage(name_.c_str());
+        }
+    }
+
+    void quit_waiting() {
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {lock_};
+        if (opened_.load(std::memory_order_relaxed)) {
+            waiter_.quit_waiting();
+        } else quit_ = true;
+    }
+};
+
+/* Tells the channels apart in the chunks shared by all of a prefix, the same in every process (FNV-1a). */
+std::uint64_t channel_key(std::string const &prefix, std::string const &name) noexcept {
+    std::uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](std::string const &s) {
+        for (char c : s) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ull;
+        }
+        h *= 1099511628211ull; // separates the prefix from the name
+    };
+    mix(prefix);
+    mix(name);
+    return h;
+}
+
 struct conn_info_head {
 
     std::string prefix_;
     std::string name_;
+    std::uint64_t key_; // of the channel, see 'channel_key'
     msg_id_t    cc_id_; // connection-info id
-    ipc::detail::waiter cc_waiter_, wt_waiter_, rd_waiter_;
-    ipc::shm::handle acc_h_;
+    std::atomic<msg_id_t> seq_; // message id sequence of this sender
+    cache_t     cache_;         // the message being reassembled
+    ipc::buff_t pending_;       // a received message that didn't fit into the caller's buffer
+    lazy_waiter cc_waiter_, wt_waiter_; // only used for waiting for receivers or free space
+    ipc::detail::waiter rd_waiter_;
+    std::array<segment_t, ipc::large_msg_cache> segments_; // dedicated segments of this sender
+
+    ipc::shm::handle stats_shm_;
+    std::atomic<stats_segment_t::shard_t *> stats_ {nullptr}; // the shard of this connection
+    std::atomic<bool> stats_failed_ {false}; // not retried on each message
+    ipc::shm::handle latency_shm_;
+    std::atomic<latency_segment_t *> latency_ {nullptr}; // mapped on its first use
+    std::mutex    stats_lock_; // maps either segment
+    bool          trace_      = false; // stamps the messages it sends
+    std::uint64_t stamp_      = 0;     // of the message being sent
+    std::uint64_t last_stamp_ = 0;     // of the message received last
+
+    ipc::backpressure policy_ = ipc::backpressure::disconnect_slow;
+    std::uint32_t sample_rate_ = 1;
+    std::uint32_t sample_tick_ = 0; // messages the laggards have skipped since the last one they got
 
     conn_info_head(char const * prefix, char const * name)
-        : prefix_{ipc::make_string(prefix)}
-        , name_  {ipc::make_string(name)}
-        , cc_id_ {} {}
+        : prefix_   {ipc::make_string(prefix)}
+        , name_     {ipc::make_string(name)}
+        , key_      {channel_key(prefix_, name_)}
+        , cc_id_    {}
+        , seq_      {0}
+        , cc_waiter_{ipc::make_prefix(prefix_, "CC_CONN__", name_)}
+        , wt_waiter_{ipc::make_prefix(prefix_, "WT_CONN__", name_)} {}
+
+    ipc::detail::waiter &cc_waiter() { return cc_waiter_.get(); }
+    ipc::detail::waiter &wt_waiter() { return wt_waiter_.get(); }
 
     void init() {
-        if (!cc_waiter_.valid()) cc_waiter_.open(ipc::make_prefix(prefix_, "CC_CONN__", name_).c_str());
-        if (!wt_waiter_.valid()) wt_waiter_.open(ipc::make_prefix(prefix_, "WT_CONN__", name_).c_str());
         if (!rd_waiter_.valid()) rd_waiter_.open(ipc::make_prefix(prefix_, "RD_CONN__", name_).c_str());
-        if (!acc_h_.valid()) acc_h_.acquire(ipc::make_prefix(prefix_, "AC_CONN__", name_).c_str(), sizeof(acc_t));
         if (cc_id_ != 0) {
             return;
         }
@@ -142,11 +410,124 @@ struct conn_info_head {
         }
     }
 
-    void clear() noexcept {
+    /**
+     * \brief Maps the counters on their first use, so a connection which never sends,
+     *        receives or reads them won't create the segment.
+     * \remarks The statistics are optional, a connection works without them.
+    */
+    stats_segment_t::shard_t *open_stats() noexcept {
+        LIBIPC_LOG();
+        auto *shard = stats_.load(std::memory_order_acquire);
+        if ((shard != nullptr) || stats_failed_.load(std::memory_order_relaxed)) return shard;
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {stats_lock_};
+        shard = stats_.load(std::memory_order_relaxed);
+        if (shard != nullptr) return shard;
+        auto name = stats_name(prefix_, name_);
+        if (!stats_shm_.acquire(name.c_str(), sizeof(stats_segment_t))) {
+            log.debug("[open_stats] fail shm.acquire: ", name);
+            stats_failed_.store(true, std::memory_order_relaxed);
+            return nullptr;
+        }
+        auto *seg = static_cast<stats_segment_t *>(stats_shm_.get());
+        shard = &(seg->shards_[cc_id_ % stats_segment_t::shard_count]);
+        stats_.store(shard, std::memory_order_release);
+        return shard;
+    }
+
+    void count(stat_id id, std::uint64_t n = 1) noexcept {
+        auto *shard = open_stats();
+        if (shard == nullptr) return;
+        shard->counters_[id].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    stats_segment_t *stats_segment() noexcept {
+        if (open_stats() == nullptr) return nullptr;
+        return static_cast<stats_segment_t *>(stats_shm_.get());
+    }
+
+    /* Maps the histograms, 'create' them unless only an existing segment is wanted. */
+    latency_segment_t *latency_segment(bool create) noexcept {
+        LIBIPC_LOG();
+        auto *seg = latency_.load(std::memory_order_acquire);
+        if (seg != nullptr) return seg;
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {stats_lock_};
+        if (!latency_shm_.valid()) {
+            auto name = latency_name(prefix_, name_);
+            if (!latency_shm_.acquire(name.c_str(), sizeof(latency_segment_t),
+                                      create ? ipc::shm::create | ipc::shm::open : ipc::shm::open)) {
+                if (create) log.debug("[latency_segment] fail shm.acquire: ", name);
+                return nullptr;
+            }
+        }
+        seg = static_cast<latency_segment_t *>(latency_shm_.get());
+        latency_.store(seg, std::memory_order_release);
+        return seg;
+    }
+
+    void reset_latency(std::size_t slot) noexcept {
+        auto *seg = latency_segment(false);
+        if (seg == nullptr) return;
+        seg->recv_latency_[slot % latency_segment_t::recv_max].reset();
+    }
+
+    /* Marks the chunk pool of this size, for inspecting it from outside. */
+    void use_chunk_size(std::size_t chunk_size) noexcept {
+        auto *seg = stats_segment();
+        if (seg == nullptr) return;
+        auto i   = chunk_size / ipc::large_msg_align;
+        auto bit = std::uint64_t(1) << (i % 64);
+        auto &w  = seg->chunk_sizes_[(i / 64) % stats_segment_t::chunk_words];
+        if ((w.load(std::memory_order_relaxed) & bit) == 0) {
+            w.fetch_or(bit, std::memory_order_relaxed);
+        }
+    }
+
+    /* Records the latency of a stamped message, 'slot' is the connection index of this receiver. */
+    void record_latency(std::uint64_t stamp, std::size_t slot) noexcept {
+        auto *seg = latency_segment(true);
+        if (seg == nullptr) return;
+        auto now = ipc::steady_now();
+        auto lat = (now > stamp) ? (now - stamp) : 0;
+        seg->latency_.record(lat);
+        seg->recv_latency_[slot % latency_segment_t::recv_max].record(lat);
+    }
+
+    void clear_waiters() noexcept {
         cc_waiter_.clear();
         wt_waiter_.clear();
         rd_waiter_.clear();
-        acc_h_.clear();
+    }
+
+    void clear() noexcept {
+        clear_waiters();
+        for (auto &seg : segments_) seg.shm_.clear();
+        stats_.store(nullptr, std::memory_order_relaxed);
+        stats_failed_.store(false, std::memory_order_relaxed);
+        stats_shm_.clear();
+        latency_.store(nullptr, std::memory_order_relaxed);
+        latency_shm_.clear();
+    }
+
+    /**
+     * \brief Releases the dedicated segments, 'alive' masks the readers still connected.
+     * \remarks A segment still being read is left to its last reader,
+     *          so the mapping of this process stays until the process exits.
+    */
+    void release_segments(ipc::circ::cc_t alive) noexcept {
+        for (auto &seg : segments_) {
+            if (!seg.shm_.valid()) continue;
+            auto *head = static_cast<segment_head_t *>(seg.shm_.get());
+            auto cur = head->state_.load(std::memory_order_acquire);
+            bool orphan = false;
+            while ((cur & alive) != 0) {
+                if (head->state_.compare_exchange_weak(cur, cur | segment_head_t::orphan_flag, std::memory_order_acq_rel)) {
+                    orphan = true;
+                    break;
+                }
+            }
+            if (orphan) seg.shm_.detach();
+            else seg.shm_.release();
+        }
     }
 
     static void clear_storage(char const * prefix, char const * name) noexcept {
@@ -155,7 +536,13 @@ struct conn_info_head {
         ipc::detail::waiter::clear_storage(ipc::make_prefix(p, "CC_CONN__", n).c_str());
         ipc::detail::waiter::clear_storage(ipc::make_prefix(p, "WT_CONN__", n).c_str());
         ipc::detail::waiter::clear_storage(ipc::make_prefix(p, "RD_CONN__", n).c_str());
-        ipc::shm::handle::clear_storage(ipc::make_prefix(p, "AC_CONN__", n).c_str());
+    }
+
+    static void clear_stats(char const * prefix, char const * name) noexcept {
+        auto p = ipc::make_string(prefix);
+        auto n = ipc::make_string(name);
+        ipc::shm::handle::clear_storage(stats_name  (p, n).c_str());
+        ipc::shm::handle::clear_storage(latency_name(p, n).c_str());
     }
 
     void quit_waiting() {
@@ -164,13 +551,8 @@ struct conn_info_head {
         rd_waiter_.quit_waiting();
     }
 
-    auto acc() {
-        return static_cast<acc_t*>(acc_h_.get());
-    }
-
-    auto& recv_cache() {
-        thread_local ipc::unordered_map<msg_id_t, cache_t> tls;
-        return tls;
+    msg_id_t next_msg_id() noexcept {
+        return seq_.fetch_add(1, std::memory_order_relaxed);
     }
 };
 
@@ -178,22 +560,25 @@ IPC_CONSTEXPR_ std::size_t align_chunk_size(std::size_t size) noexcept {
     return (((size - 1) / ipc::large_msg_align) + 1) * ipc::large_msg_align;
 }
 
-IPC_CONSTEXPR_ std::size_t calc_chunk_size(std::size_t size) noexcept {
-    return ipc::make_align(alignof(std::max_align_t), align_chunk_size(
-           ipc::make_align(alignof(std::max_align_t), sizeof(std::atomic<ipc::circ::cc_t>)) + size));
-}
-
 struct chunk_t {
+    std::atomic<ipc::circ::cc_t> conns_; // the readers yet to recycle it
+    std::uint64_t                chan_;  // the key of the channel it is held for
+
     std::atomic<ipc::circ::cc_t> &conns() noexcept {
-        return *reinterpret_cast<std::atomic<ipc::circ::cc_t> *>(this);
+        return conns_;
     }
 
     void *data() noexcept {
         return reinterpret_cast<ipc::byte_t *>(this)
-             + ipc::make_align(alignof(std::max_align_t), sizeof(std::atomic<ipc::circ::cc_t>));
+             + ipc::make_align(alignof(std::max_align_t), sizeof(chunk_t));
     }
 };
 
+IPC_CONSTEXPR_ std::size_t calc_chunk_size(std::size_t size) noexcept {
+    return ipc::make_align(alignof(std::max_align_t), align_chunk_size(
+           ipc::make_align(alignof(std::max_align_t), sizeof(chunk_t)) + size));
+}
+
 struct chunk_info_t {
     ipc::id_pool<> pool_;
     ipc::spin_lock lock_;
@@ -275,44 +660,197 @@ chunk_info_t *chunk_storage_info(conn_info_head *inf, std::size_t chunk_size) {
     return it->second->get_info(inf, chunk_size);
 }
 
-std::pair<ipc::storage_id_t, void*> acquire_storage(conn_info_head *inf, std::size_t size, ipc::circ::cc_t conns) {
+/*
+ * Gives back the chunks of the channel 'chan' held only by the readers which have gone,
+ * they would never recycle them. 'alive' masks the readers still connected.
+ * Called with the lock of the pool held, once all the chunks are in use.
+*/
+std::size_t reclaim_chunks(chunk_info_t *info, std::size_t chunk_size, std::uint64_t chan, ipc::circ::cc_t alive) noexcept {
+    std::size_t n = 0;
+    for (ipc::storage_id_t id = 0; id < static_cast<ipc::storage_id_t>(ipc::id_pool<>::max_count); ++id) {
+        auto chunk = info->at(chunk_size, id);
+        if (chunk->chan_ != chan) continue;
+        auto conns = chunk->conns().load(std::memory_order_acquire);
+        // 0: its last reader is giving it back right now
+        if ((conns == 0) || ((conns & alive) != 0)) continue;
+        // whoever clears the readers gives the chunk back, see 'sub_rc'
+        if (!chunk->conns().compare_exchange_strong(conns, 0, std::memory_order_acq_rel)) continue;
+        info->pool_.release(id);
+        ++n;
+    }
+    return n;
+}
+
+/* 'alive' masks the readers that could still recycle a chunk, see 'alive_conns'. */
+std::pair<ipc::storage_id_t, void*> acquire_chunk(conn_info_head *inf, std::size_t size, 
+                                                  ipc::circ::cc_t conns, ipc::circ::cc_t alive) {
+    LIBIPC_LOG();
     std::size_t chunk_size = calc_chunk_size(size);
     auto info = chunk_storage_info(inf, chunk_size);
-    if (info == nullptr) return {};
+    if (info == nullptr) return {storage_failed, nullptr};
+    if (inf != nullptr) inf->use_chunk_size(chunk_size);
 
     info->lock_.lock();
     info->pool_.prepare();
     // got an unique id
     auto id = info->pool_.acquire();
+    if ((id < 0) && (inf != nullptr)) {
+        auto n = reclaim_chunks(info, chunk_size, inf->key_, alive);
+        if (n != 0) {
+            log.debug("[acquire_chunk] reclaimed ", n, " chunks of the readers which have gone, chunk_size = ", chunk_size);
+            id = info->pool_.acquire();
+        }
+    }
+    auto chunk = info->at(chunk_size, id);
+    if (chunk != nullptr) {
+        // set under the lock, so a sender reclaiming the chunks never sees those of its last use
+        chunk->chan_ = (inf == nullptr) ? 0 : inf->key_;
+        chunk->conns().store(conns, std::memory_order_relaxed);
+    }
     info->lock_.unlock();
 
-    auto chunk = info->at(chunk_size, id);
-    if (chunk == nullptr) return {};
-    chunk->conns().store(conns, std::memory_order_relaxed);
+    if (chunk == nullptr) return {storage_exhausted, nullptr};
     return { id, chunk->data() };
 }
 
-void *find_storage(ipc::storage_id_t id, conn_info_head *inf, std::size_t size) {
+std::string segment_name(conn_info_head const *inf, msg_id_t cc_id, ipc::storage_id_t id) {
+    return ipc::make_prefix(inf->prefix_, "LARGE_MSG__", inf->name_, 
+                            "__", cc_id, 
+                            "__", (id & 0xff), "_", ((id >> 8) & 0x3fffff));
+}
+
+/* 'alive' masks the readers that could still hold a segment. */
+std::pair<ipc::storage_id_t, void*> acquire_segment(conn_info_head *inf, std::size_t size, 
+                                                    ipc::circ::cc_t conns, ipc::circ::cc_t alive) {
     LIBIPC_LOG();
+    std::size_t seg_size = calc_segment_size(size);
+    std::size_t slot = ipc::large_msg_cache;
+    for (std::size_t i = 0; i < ipc::large_msg_cache; ++i) {
+        auto &seg = inf->segments_[i];
+        if (!seg.shm_.valid()) {
+            if (slot == ipc::large_msg_cache) slot = i;
+            continue;
+        }
+        auto *head = static_cast<segment_head_t *>(seg.shm_.get());
+        if ((head->state_.load(std::memory_order_acquire) & alive) != 0) {
+            continue; // still being read
+        }
+        if (seg.shm_.size() >= seg_size) {
+            head->state_.store(conns, std::memory_order_relaxed);
+            return { make_segment_id(i, seg.gen_), head->data() };
+        }
+        // too small, could be replaced by a larger one
+        if (slot == ipc::large_msg_cache) slot = i;
+    }
+    if (slot == ipc::large_msg_cache) {
+        return {storage_exhausted, nullptr};
+    }
+    auto &seg = inf->segments_[slot];
+    if (seg.shm_.valid()) {
+        // A new generation has a new name, the readers may still map the old one.
+        seg.shm_.release();
+        ++seg.gen_;
+    }
+    auto id = make_segment_id(slot, seg.gen_);
+    auto name = segment_name(inf, inf->cc_id_, id);
+    if (!seg.shm_.acquire(name.c_str(), seg_size)) {
+        log.error("[acquire_segment] acquire failed: ", name, ", size = ", seg_size);
+        return {storage_failed, nullptr};
+    }
+    auto *head = static_cast<segment_head_t *>(seg.shm_.get());
+    head->state_.store(conns, std::memory_order_relaxed);
+    return { id, head->data() };
+}
+
+template <ipc::relat Rp, ipc::relat Rc>
+constexpr ipc::circ::cc_t alive_conns(ipc::wr<Rp, Rc, ipc::trans::unicast>, ipc::circ::cc_t /*conns*/) noexcept {
+    return ~static_cast<ipc::circ::cc_t>(0u);
+}
+
+template <ipc::relat Rp, ipc::relat Rc>
+constexpr ipc::circ::cc_t alive_conns(ipc::wr<Rp, Rc, ipc::trans::broadcast>, ipc::circ::cc_t conns) noexcept {
+    return conns;
+}
+
+/**
+ * \brief Gets a storage for the payload of a large message.
+ * 'fallback' is set if the chunks were all held by the receivers, and a segment was tried instead.
+ * \return storage_exhausted as the id if all the storages are held by the receivers now,
+ *         storage_failed if none could be mapped.
+*/
+template <typename Flag>
+std::pair<ipc::storage_id_t, void*> acquire_storage(conn_info_head *inf, std::size_t size, 
+                                                    ipc::circ::cc_t conns, ipc::circ::cc_t connected, bool &fallback) {
+    auto alive = alive_conns(Flag{}, connected);
+    fallback = false;
+    if (size <= ipc::huge_msg_limit) {
+        auto dat = acquire_chunk(inf, size, conns, alive);
+        if (dat.first != storage_exhausted) {
+            return dat;
+        }
+        // the chunks are all held by the receivers, try a segment of the sender
+        fallback = true;
+    }
+    return acquire_segment(inf, size, conns, alive);
+}
+
+/* 'seg' receives the mapping of a dedicated segment, which should be released by recycle_storage. */
+void *find_storage(ipc::storage_id_t id, conn_info_head *inf, msg_id_t cc_id, std::size_t size, ipc::shm::id_t *seg) {
+    LIBIPC_LOG();
+    *seg = nullptr;
     if (id < 0) {
         log.error("[find_storage] id is invalid: id = ", (long)id, ", size = ", size);
         return nullptr;
     }
+    if (is_segment_id(id)) {
+        auto name = segment_name(inf, cc_id, id);
+        auto shm  = ipc::shm::acquire(name.c_str(), calc_segment_size(size), ipc::shm::open);
+        if (shm == nullptr) {
+            log.error("[find_storage] segment is not found: ", name);
+            return nullptr;
+        }
+        auto *head = static_cast<segment_head_t *>(ipc::shm::get_mem(shm, nullptr));
+        if (head == nullptr) {
+            ipc::shm::release(shm);
+            return nullptr;
+        }
+        *seg = shm;
+        return head->data();
+    }
     std::size_t chunk_size = calc_chunk_size(size);
     auto info = chunk_storage_info(inf, chunk_size);
     if (info == nullptr) return nullptr;
     return info->at(chunk_size, id)->data();
 }
 
-void release_storage(ipc::storage_id_t id, conn_info_head *inf, std::size_t size) {
+/* Drops all the readers of a segment, 'shm' is released. */
+void release_segment(ipc::shm::id_t shm, ipc::circ::cc_t remain) {
+    auto *head = static_cast<segment_head_t *>(ipc::shm::get_mem(shm, nullptr));
+    if ((head != nullptr) && sub_segment_rc(head, remain)) {
+        // the sender has gone, remove the segment along with this mapping
+        ipc::shm::sub_ref(shm);
+    }
+    ipc::shm::release(shm);
+}
+
+void release_storage(ipc::storage_id_t id, conn_info_head *inf, msg_id_t cc_id, std::size_t size) {
     LIBIPC_LOG();
     if (id < 0) {
         log.error("[release_storage] id is invalid: id = ", (long)id, ", size = ", size);
         return;
     }
+    if (is_segment_id(id)) {
+        auto shm = ipc::shm::acquire(segment_name(inf, cc_id, id).c_str(), calc_segment_size(size), ipc::shm::open);
+        if (shm != nullptr) release_segment(shm, 0);
+        return;
+    }
     std::size_t chunk_size = calc_chunk_size(size);
     auto info = chunk_storage_info(inf, chunk_size);
     if (info == nullptr) return;
+    auto chunk = info->at(chunk_size, id);
+    if (chunk->conns().exchange(0, std::memory_order_acq_rel) == 0) {
+        return; // has been given back already
+    }
     info->lock_.lock();
     info->pool_.release(id);
     info->lock_.unlock();
@@ -330,6 +868,9 @@ bool sub_rc(ipc::wr<Rp, Rc, ipc::trans::broadcast>,
     auto last_conns = curr_conns & ~conn_id;
     for (unsigned k = 0;;) {
         auto chunk_conns  = conns.load(std::memory_order_acquire);
+        if (chunk_conns == 0) {
+            return false; // has been given back by someone else
+        }
         if (conns.compare_exchange_weak(chunk_conns, chunk_conns & last_conns, std::memory_order_release)) {
             return (chunk_conns & last_conns) == 0;
         }
@@ -337,13 +878,31 @@ bool sub_rc(ipc::wr<Rp, Rc, ipc::trans::broadcast>,
     }
 }
 
+template <ipc::relat Rp, ipc::relat Rc>
+constexpr ipc::circ::cc_t remain_conns(ipc::wr<Rp, Rc, ipc::trans::unicast>, 
+                                       ipc::circ::cc_t /*curr_conns*/, ipc::circ::cc_t /*conn_id*/) noexcept {
+    return 0;
+}
+
+template <ipc::relat Rp, ipc::relat Rc>
+constexpr ipc::circ::cc_t remain_conns(ipc::wr<Rp, Rc, ipc::trans::broadcast>, 
+                                       ipc::circ::cc_t curr_conns, ipc::circ::cc_t conn_id) noexcept {
+    return curr_conns & ~conn_id;
+}
+
 template <typename Flag>
-void recycle_storage(ipc::storage_id_t id, conn_info_head *inf, std::size_t size, ipc::circ::cc_t curr_conns, ipc::circ::cc_t conn_id) {
+void recycle_storage(ipc::storage_id_t id, conn_info_head *inf, std::size_t size, ipc::circ::cc_t curr_conns, ipc::circ::cc_t conn_id, 
+                     ipc::shm::id_t seg) {
     LIBIPC_LOG();
     if (id < 0) {
         log.error("[recycle_storage] id is invalid: id = ", (long)id, ", size = ", size);
         return;
     }
+    if (seg != nullptr) {
+        release_segment(seg, remain_conns(Flag{}, curr_conns, conn_id));
+        inf->wt_waiter().broadcast();
+        return;
+    }
     std::size_t chunk_size = calc_chunk_size(size);
     auto info = chunk_storage_info(inf, chunk_size);
     if (info == nullptr) return;
@@ -357,6 +916,8 @@ void recycle_storage(ipc::storage_id_t id, conn_info_head *inf, std::size_t size
     info->lock_.lock();
     info->pool_.release(id);
     info->lock_.unlock();
+    // a sender may be waiting for a free chunk
+    inf->wt_waiter().broadcast();
 }
 
 template <typename MsgT>
@@ -370,18 +931,27 @@ bool clear_message(conn_info_head *inf, void* p) {
             return true;
         }
         release_storage(*reinterpret_cast<ipc::storage_id_t*>(&msg->data_),
-                        inf, static_cast<std::size_t>(r_size));
+                        inf, msg->cc_id_, static_cast<std::size_t>(r_size));
     }
     return true;
 }
 
+inline ipc::detail::waiter &waiter_of(ipc::detail::waiter &w) noexcept {
+    return w;
+}
+
+inline ipc::detail::waiter &waiter_of(lazy_waiter &w) {
+    return w.get();
+}
+
+/* the waiter is only touched when spinning isn't enough */
 template <typename W, typename F>
 bool wait_for(W& waiter, F&& pred, std::uint64_t tm) {
     if (tm == 0) return !pred();
     for (unsigned k = 0; pred();) {
         bool ret = true;
         ipc::sleep(k, [&k, &ret, &waiter, &pred, tm] {
-            ret = waiter.wait_if(std::forward<F>(pred), tm);
+            ret = waiter_of(waiter).wait_if(std::forward<F>(pred), tm);
             k   = 0;
         });
         if (!ret) return false; // timeout or fail
@@ -390,49 +960,242 @@ bool wait_for(W& waiter, F&& pred, std::uint64_t tm) {
     return true;
 }
 
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+/*
+ * The head of the consolidated segment of a channel.
+ * The segment is laid out as: | channel_head_t | cc, wt, rd waiters | queue elements |
+*/
+struct channel_head_t {
+    enum : std::uint32_t {
+        magic_value   = 0x43504943, // "CIPC"
+        version_value = 5
+    };
+    enum : std::uint32_t {
+        state_empty,
+        state_initializing,
+        state_ready
+    };
+    enum : unsigned {
+        ready_timeout = 3000 // times of waiting for the initializing opener
+    };
+
+    std::atomic<std::uint32_t> state_;
+    std::uint32_t magic_;
+    std::uint32_t version_;
+    std::uint32_t waiter_size_;
+    std::uint64_t segment_size_;
+
+    static std::size_t waiters_offset() noexcept {
+        return ipc::make_align(alignof(std::max_align_t), sizeof(channel_head_t));
+    }
+
+    ipc::byte_t *waiter_at(std::size_t i) noexcept {
+        return reinterpret_cast<ipc::byte_t *>(this) + waiters_offset()
+             + i * ipc::detail::waiter::storage_size();
+    }
+
+    /* waits until the initializing opener is done, then checks the layout */
+    bool wait_ready(std::uint64_t segment_size) noexcept {
+        LIBIPC_LOG();
+        for (unsigned k = 0, n = 0; state_.load(std::memory_order_acquire) != state_ready; ++n) {
+            if (n >= ready_timeout) {
+                log.error("[channel_head_t] the channel segment is not initialized.");
+                return false;
+            }
+            ipc::sleep(k);
+        }
+        if ((magic_ != magic_value) || (version_ != version_value)) {
+            log.error("[channel_head_t] unknown channel segment, magic: ", magic_, ", version: ", version_);
+            return false;
+        }
+        if ((waiter_size_ != ipc::detail::waiter::storage_size()) || (segment_size_ != segment_size)) {
+            log.error("[channel_head_t] mismatched channel segment, size: ", segment_size_, ", expected: ", segment_size);
+            return false;
+        }
+        return true;
+    }
+};
+#endif
+
 template <typename Policy,
           std::size_t DataSize  = ipc::data_length,
           std::size_t AlignSize = (ipc::detail::min)(DataSize, alignof(std::max_align_t))>
 struct queue_generator {
 
     using queue_t = ipc::queue<msg_t<DataSize, AlignSize>, Policy>;
+    using elems_t = typename queue_t::elems_t;
 
     struct conn_info_t : conn_info_head {
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+        ipc::shm::handle chan_shm_; // the segment holding the queue and the waiters
+#endif
         queue_t que_;
 
         conn_info_t(char const * pref, char const * name)
             : conn_info_head{pref, name} { init(); }
 
+        ~conn_info_t() {
+            ipc::circ::cc_t alive = ~static_cast<ipc::circ::cc_t>(0u);
+            if (que_.valid() && ipc::relat_trait<typename Policy::flag_t>::is_broadcast) {
+                alive = que_.elems()->connections(std::memory_order_relaxed);
+            }
+            this->release_segments(alive);
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+            if (chan_shm_.valid() && (chan_shm_.ref() <= 1)) {
+                // The last one destroys the waiters living in the segment.
+                conn_info_head::clear_waiters();
+            }
+#endif
+        }
+
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+        static std::string segment_name(std::string const &prefix, std::string const &name) {
+            return ipc::make_prefix(prefix, "CH_CONN__", name, "__", DataSize, "__", AlignSize);
+        }
+
+        static std::size_t elems_offset() noexcept {
+            return ipc::make_align(alignof(elems_t), channel_head_t::waiters_offset()
+                                                   + 3 * ipc::detail::waiter::storage_size());
+        }
+
+        bool open_waiters(channel_head_t *head, bool init) noexcept {
+            return cc_waiter_.open(head->waiter_at(0), init)
+                && wt_waiter_.open(head->waiter_at(1), init)
+                && rd_waiter_.open(head->waiter_at(2), init);
+        }
+
+        /* opens the queue and the waiters from the consolidated segment */
+        bool open_segment() {
+            LIBIPC_LOG();
+            auto name = segment_name(prefix_, name_);
+            std::size_t size = elems_offset() + sizeof(elems_t);
+            if (!chan_shm_.acquire(name.c_str(), size)) {
+                log.error("[open_segment] fail shm.acquire: ", name);
+                return false;
+            }
+            auto *head = static_cast<channel_head_t *>(chan_shm_.get());
+            auto state = static_cast<std::uint32_t>(channel_head_t::state_empty);
+            if (head->state_.compare_exchange_strong(state, channel_head_t::state_initializing,
+                                                     std::memory_order_acq_rel)) {
+                head->magic_        = channel_head_t::magic_value;
+                head->version_      = channel_head_t::version_value;
+                head->waiter_size_  = static_cast<std::uint32_t>(ipc::detail::waiter::storage_size());
+                head->segment_size_ = size;
+                // Waiters that cannot live in the segment fall back to named ones in 'conn_info_head::init'.
+                open_waiters(head, true);
+                head->state_.store(channel_head_t::state_ready, std::memory_order_release);
+            } else if (head->wait_ready(size)) {
+                open_waiters(head, false);
+            } else {
+                chan_shm_.release();
+                return false;
+            }
+            auto *elems = reinterpret_cast<elems_t *>(static_cast<ipc::byte_t *>(chan_shm_.get()) + elems_offset());
+            return que_.open(elems);
+        }
+#endif
+
         void init() {
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+            if (!que_.valid()) open_segment();
+            conn_info_head::init();
+#else
             conn_info_head::init();
             if (!que_.valid()) {
-                que_.open(ipc::make_prefix(prefix_, 
-                          "QU_CONN__", 
-                          this->name_, 
-                          "__", DataSize, 
-                          "__", AlignSize).c_str());
+                que_.open(queue_name(prefix_, this->name_).c_str());
+            }
+#endif
+        }
+
+#if !defined(LIBIPC_CONSOLIDATED_SHM)
+        static std::string queue_name(std::string const &prefix, std::string const &name) {
+            return ipc::make_prefix(prefix, "QU_CONN__", name, "__", DataSize, "__", AlignSize);
+        }
+#endif
+
+        /* Maps the queue of an existing channel without connecting to it. */
+        static elems_t *open_elems(ipc::shm::handle &shm, std::string const &prefix, std::string const &name) {
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+            std::size_t size = elems_offset() + sizeof(elems_t);
+            if (!shm.acquire(segment_name(prefix, name).c_str(), size, ipc::shm::open)) {
+                return nullptr;
+            }
+            if (!static_cast<channel_head_t *>(shm.get())->wait_ready(size)) {
+                return nullptr;
+            }
+            return reinterpret_cast<elems_t *>(static_cast<ipc::byte_t *>(shm.get()) + elems_offset());
+#else
+            if (!shm.acquire(queue_name(prefix, name).c_str(), sizeof(elems_t), ipc::shm::open)) {
+                return nullptr;
             }
+            return static_cast<elems_t *>(shm.get());
+#endif
         }
 
         void clear() noexcept {
             que_.clear();
             conn_info_head::clear();
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+            chan_shm_.clear();
+#endif
         }
 
         static void clear_storage(char const * prefix, char const * name) noexcept {
+            conn_info_head::clear_stats(prefix, name);
+#if defined(LIBIPC_CONSOLIDATED_SHM)
+            ipc::shm::handle::clear_storage(segment_name(ipc::make_string(prefix), 
+                                                         ipc::make_string(name)).c_str());
+            if (ipc::detail::waiter::storage_size() != 0) {
+                return; // no named waiters
+            }
+#else
             queue_t::clear_storage(ipc::make_prefix(prefix, 
                                    "QU_CONN__", 
                                    name, 
                                    "__", DataSize, 
                                    "__", AlignSize).c_str());
+#endif
             conn_info_head::clear_storage(prefix, name);
         }
 
+        /* The connection index of this receiver. */
+        std::size_t recv_slot() const noexcept {
+            return ipc::relat_trait<typename Policy::flag_t>::is_broadcast ?
+                   ipc::circ::conn_index_of(que_.connected_id()) : 0;
+        }
+
+        /*
+         * Recycles the storages of the large messages left unread by this receiver,
+         * otherwise a receiver taking its connected id would hold them forever.
+        */
+        void drain_storages() {
+            if (!ipc::relat_trait<typename Policy::flag_t>::is_broadcast) {
+                return; // the messages are left to the other receivers
+            }
+            auto conns = que_.elems()->connections(std::memory_order_relaxed);
+            typename queue_t::value_t msg {};
+            for (std::size_t i = 0; (i < elems_t::elem_max) && que_.pop(msg); ++i) {
+                std::int32_t r_size = static_cast<std::int32_t>(ipc::data_length) + msg.remain_;
+                if (!msg.storage_ || (r_size <= 0)) continue;
+                auto id = *reinterpret_cast<ipc::storage_id_t*>(&msg.data_);
+                ipc::shm::id_t seg;
+                if (find_storage(id, this, msg.cc_id_, static_cast<std::size_t>(r_size), &seg) == nullptr) continue;
+                recycle_storage<typename Policy::flag_t>(id, this, static_cast<std::size_t>(r_size), 
+                                                         conns, que_.connected_id(), seg);
+            }
+        }
+
         void disconnect_receiver() {
+            if (que_.valid() && que_.connected()) {
+                // leaves the slot empty for the next receiver
+                this->reset_latency(recv_slot());
+                drain_storages();
+            }
             bool dis = que_.disconnect();
             this->quit_waiting();
             if (dis) {
-                this->recv_cache().clear();
+                this->cache_   = {};
+                this->pending_ = {};
             }
         }
     };
@@ -489,7 +1252,7 @@ static bool reconnect(ipc::handle_t * ph, bool start_to_recv) {
     if (start_to_recv) {
         que->shut_sending();
         if (que->connect()) { // wouldn't connect twice
-            info_of(*ph)->cc_waiter_.broadcast();
+            info_of(*ph)->cc_waiter().broadcast();
             return true;
         }
         return false;
@@ -523,8 +1286,94 @@ static bool wait_for_recv(ipc::handle_t h, std::size_t r_count, std::uint64_t tm
     }, tm);
 }
 
+template <typename P>
+static bool push_one(P& try_push, conn_info_t *inf, queue_t *que, msg_id_t msg_id,
+                     std::int32_t remain, void const * data, std::size_t size, bool head) {
+    return try_push([&] {
+        return que->push(
+            [](void*) { return true; },
+            inf->cc_id_, msg_id, remain, data, size, head, inf->stamp_);
+    }, [&] {
+        return que->force_push(
+            [inf](void* p) { return clear_message<typename queue_t::value_t>(inf, p); },
+            inf->cc_id_, msg_id, remain, data, size, head, inf->stamp_);
+    });
+}
+
+/* A single producer never interleaves its own message fragments. */
+template <typename P>
+static bool push_fragments(std::false_type, P& try_push, conn_info_t *inf, queue_t *que, msg_id_t msg_id,
+                           void const * data, std::size_t size) {
+    std::int32_t offset = 0;
+    for (std::int32_t i = 0; i < static_cast<std::int32_t>(size / ipc::data_length); ++i, offset += ipc::data_length) {
+        if (!push_one(try_push, inf, que, msg_id, 
+                      static_cast<std::int32_t>(size) - offset - static_cast<std::int32_t>(ipc::data_length),
+                      static_cast<ipc::byte_t const *>(data) + offset, ipc::data_length, offset == 0)) {
+            return false;
+        }
+    }
+    // if remain > 0, this is the last message fragment
+    std::int32_t remain = static_cast<std::int32_t>(size) - offset;
+    if (remain > 0) {
+        if (!push_one(try_push, inf, que, msg_id, 
+                      remain - static_cast<std::int32_t>(ipc::data_length),
+                      static_cast<ipc::byte_t const *>(data) + offset, 
+                      static_cast<std::size_t>(remain), offset == 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Multiple producers reserve all the fragments of a message at once, so they stay contiguous. */
+template <typename P>
+static bool push_fragments(std::true_type, P& try_push, conn_info_t *inf, queue_t *que, msg_id_t msg_id,
+                           void const * data, std::size_t size) {
+    LIBIPC_LOG();
+    std::size_t n = (size + ipc::data_length - 1) / ipc::data_length;
+    if (n > queue_t::elems_t::elem_max) {
+        log.error("fail: send, too many fragments to be reserved at once, msg_id: ", msg_id, ", size: ", size);
+        return false;
+    }
+    auto fragment = [&](std::size_t i, auto&& push) {
+        std::size_t offset = i * ipc::data_length;
+        return push(static_cast<std::int32_t>(size - offset) - static_cast<std::int32_t>(ipc::data_length),
+                    static_cast<ipc::byte_t const *>(data) + offset, 
+                    (ipc::detail::min)(size - offset, static_cast<std::size_t>(ipc::data_length)), i == 0);
+    };
+    return try_push([&] {
+        return que->push_n(n, [&](std::size_t i, void* p) {
+            fragment(i, [&](std::int32_t remain, void const * frag, std::size_t frag_size, bool head) {
+                ::new (p) typename queue_t::value_t(inf->cc_id_, msg_id, remain, frag, frag_size, head, inf->stamp_);
+            });
+        });
+    }, [&] {
+        return que->force_push_n(n, [&](std::size_t i, void* p) {
+            if (!clear_message<typename queue_t::value_t>(inf, p)) return;
+            fragment(i, [&](std::int32_t remain, void const * frag, std::size_t frag_size, bool head) {
+                ::new (p) typename queue_t::value_t(inf->cc_id_, msg_id, remain, frag, frag_size, head, inf->stamp_);
+            });
+        });
+    });
+}
+
+/*
+ * Under the 'sample' policy, the overrun receivers only get 1 of every few messages until they catch up.
+ * Returns the receivers in 'conns' the message should skip.
+*/
+static ipc::circ::cc_t sample_laggards(conn_info_t *inf, ipc::circ::cc_t conns) noexcept {
+    if (inf->policy_ != ipc::backpressure::sample) return 0;
+    auto lagging = inf->que_.elems()->lagging() & conns;
+    if (lagging == 0) return 0;
+    if (++inf->sample_tick_ >= inf->sample_rate_) {
+        inf->sample_tick_ = 0;
+        return 0;
+    }
+    return inf->que_.recipients(lagging);
+}
+
 template <typename F>
-static bool send(F&& gen_push, ipc::handle_t h, void const * data, std::size_t size) {
+static bool send(F&& gen_push, ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
     LIBIPC_LOG();
     if (data == nullptr || size == 0) {
         log.error("fail: send(", data, ", ", size, ")");
@@ -548,198 +1397,599 @@ static bool send(F&& gen_push, ipc::handle_t h, void const * data, std::size_t s
         log.error("fail: send, there is no receiver on this connection.");
         return false;
     }
-    // calc a new message id
     conn_info_t *inf = info_of(h);
-    auto acc = inf->acc();
-    if (acc == nullptr) {
-        log.error("fail: send, info_of(h)->acc() == nullptr");
+    auto skipped = sample_laggards(inf, conns);
+    if (skipped != 0) {
+        que->elems()->count_dropped(skipped);
+    }
+    que->mute(skipped);
+    LIBIPC_UNUSED auto guard = ipc::guard([que] { que->mute(0); });
+    if (que->recipients(conns) == 0) {
+        // no receiver subscribes to the topics of this message
+        return true;
+    }
+    // calc a new message id
+    if (inf->cc_id_ == 0) {
+        log.error("fail: send, info_of(h)->cc_id_ == 0");
         return false;
     }
-    auto msg_id   = acc->fetch_add(1, std::memory_order_relaxed);
-    auto try_push = std::forward<F>(gen_push)(inf, que, msg_id);
+    auto msg_id   = inf->next_msg_id();
+    auto try_push = std::forward<F>(gen_push)(msg_id);
+    // the latency includes waiting for free space
+    inf->stamp_ = inf->trace_ ? ipc::steady_now() : 0;
+    auto sent = [inf, size](bool ret) {
+        if (ret) {
+            inf->count(stat_msgs_sent);
+            inf->count(stat_bytes_sent, size);
+        }
+        return ret;
+    };
     if (size > ipc::large_msg_limit) {
-        auto   dat = acquire_storage(inf, size, conns);
+        // Wait for a free storage instead of sending a large message piece by piece.
+        std::pair<ipc::storage_id_t, void*> dat {storage_failed, nullptr};
+        bool fallback = false;
+        if (!wait_for(inf->wt_waiter_, [&] {
+                auto cc = que->elems()->connections(std::memory_order_relaxed);
+                dat = acquire_storage<flag_t>(inf, size, que->recipients(cc), cc, fallback);
+                return dat.first == storage_exhausted;
+            }, tm)) {
+            log.error("fail: send, no free storage for the large message. msg_id: ", msg_id, ", size: ", size);
+            if (tm != 0) inf->count(stat_wait_timeouts);
+            return false;
+        }
         void * buf = dat.second;
+        // counted once the wait has ended, not on each of its retries
+        if (fallback || (buf == nullptr)) {
+            inf->count(stat_storage_fallbacks);
+        }
         if (buf != nullptr) {
             std::memcpy(buf, data, size);
-            return try_push(static_cast<std::int32_t>(size) - 
-                            static_cast<std::int32_t>(ipc::data_length), &(dat.first), 0);
+            inf->count(stat_large_sends);
+            return sent(push_one(try_push, inf, que, msg_id, 
+                                 static_cast<std::int32_t>(size) - static_cast<std::int32_t>(ipc::data_length), 
+                                 &(dat.first), 0, true));
         }
-        // try using message fragment
-        //log.debug("fail: shm::handle for big message. msg_id: ", msg_id, ", size: ", size);
+        // the storage could not be mapped, try using message fragment
     }
     // push message fragment
-    std::int32_t offset = 0;
-    for (std::int32_t i = 0; i < static_cast<std::int32_t>(size / ipc::data_length); ++i, offset += ipc::data_length) {
-        if (!try_push(static_cast<std::int32_t>(size) - offset - static_cast<std::int32_t>(ipc::data_length),
-                      static_cast<ipc::byte_t const *>(data) + offset, ipc::data_length)) {
-            return false;
-        }
+    if (size > ipc::data_length) {
+        inf->count(stat_fragment_sends);
     }
-    // if remain > 0, this is the last message fragment
-    std::int32_t remain = static_cast<std::int32_t>(size) - offset;
-    if (remain > 0) {
-        if (!try_push(remain - static_cast<std::int32_t>(ipc::data_length),
-                      static_cast<ipc::byte_t const *>(data) + offset, 
-                      static_cast<std::size_t>(remain))) {
-            return false;
-        }
-    }
-    return true;
+    return sent(push_fragments(std::integral_constant<bool, ipc::relat_trait<flag_t>::is_multi_producer>{},
+                               try_push, inf, que, msg_id, data, size));
 }
 
 static bool send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
     LIBIPC_LOG();
-    return send([tm, &log](auto *info, auto *que, auto msg_id) {
-        return [tm, &log, info, que, msg_id](std::int32_t remain, void const * data, std::size_t size) {
-            if (!wait_for(info->wt_waiter_, [&] {
-                    return !que->push(
-                        [](void*) { return true; },
-                        info->cc_id_, msg_id, remain, data, size);
-                }, tm)) {
-                log.debug("force_push: msg_id = ", msg_id, ", remain = ", remain, ", size = ", size);
-                if (!que->force_push(
-                        [info](void* p) { return clear_message<typename queue_t::value_t>(info, p); },
-                        info->cc_id_, msg_id, remain, data, size)) {
+    auto info = info_of(h);
+    return send([tm, &log, info](auto msg_id) {
+        return [tm, &log, info, msg_id](auto&& push, auto&& force_push) {
+            auto que = &(info->que_);
+            switch (info->policy_) {
+            case ipc::backpressure::block:
+                // waits piece by piece, for the receivers may all be gone
+                while (!wait_for(info->wt_waiter_, [&] { return !push(); }, ipc::default_timeout)) {
+                    if (que->conn_count() == 0) return false;
+                }
+                break;
+            case ipc::backpressure::drop_newest:
+                if (!wait_for(info->wt_waiter_, [&] { return !push(); }, tm)) {
+                    log.debug("drop: msg_id = ", msg_id);
+                    if (tm != 0) info->count(stat_wait_timeouts);
+                    que->elems()->count_dropped(que->recipients(que->elems()->connections(std::memory_order_relaxed)));
                     return false;
                 }
+                break;
+            default:
+                // 'force_push' overwrites the laggards under 'overwrite_oldest' & 'sample',
+                // otherwise disconnects them
+                if (!wait_for(info->wt_waiter_, [&] { return !push(); }, tm)) {
+                    log.debug("force_push: msg_id = ", msg_id);
+                    if (tm != 0) info->count(stat_wait_timeouts);
+                    info->count(stat_force_pushes);
+                    if (!force_push()) {
+                        return false;
+                    }
+                }
+                break;
             }
             info->rd_waiter_.broadcast();
             return true;
         };
-    }, h, data, size);
+    }, h, data, size, tm);
 }
 
 static bool try_send(ipc::handle_t h, void const * data, std::size_t size, std::uint64_t tm) {
-    return send([tm](auto *info, auto *que, auto msg_id) {
-        return [tm, info, que, msg_id](std::int32_t remain, void const * data, std::size_t size) {
-            if (!wait_for(info->wt_waiter_, [&] {
-                    return !que->push(
-                        [](void*) { return true; },
-                        info->cc_id_, msg_id, remain, data, size);
-                }, tm)) {
+    auto info = info_of(h);
+    return send([tm, info](auto /*msg_id*/) {
+        return [tm, info](auto&& push, auto&& /*force_push*/) {
+            if (!wait_for(info->wt_waiter_, [&] { return !push(); }, tm)) {
+                if (tm != 0) info->count(stat_wait_timeouts);
                 return false;
             }
             info->rd_waiter_.broadcast();
             return true;
         };
-    }, h, data, size);
+    }, h, data, size, tm);
 }
 
-static ipc::buff_t recv(ipc::handle_t h, std::uint64_t tm) {
-    LIBIPC_LOG();
+/* Sends the message to the receivers subscribing to any of the topics only. */
+template <typename F>
+static bool publish(F&& do_send, ipc::handle_t h, std::uint64_t topics, void const * data, std::size_t size, std::uint64_t tm) {
     auto que = queue_of(h);
     if (que == nullptr) {
-        log.error("fail: recv, queue_of(h) == nullptr");
-        return {};
+        return std::forward<F>(do_send)(h, data, size, tm);
     }
-    if (!que->connected()) {
-        // hasn't connected yet, just return.
-        return {};
+    que->topics(topics);
+    LIBIPC_UNUSED auto guard = ipc::guard([que] { que->topics(0); });
+    return std::forward<F>(do_send)(h, data, size, tm);
+}
+
+static bool subscribe(ipc::handle_t h, std::uint64_t topics) {
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        return false;
+    }
+    que->subscribe(topics);
+    return true;
+}
+
+static bool backpressure(ipc::handle_t h, ipc::backpressure policy, std::uint32_t sample_rate) {
+    auto inf = info_of(h);
+    if (inf == nullptr) {
+        return false;
+    }
+    if (!ipc::relat_trait<flag_t>::is_broadcast &&
+        ((policy == ipc::backpressure::overwrite_oldest) || (policy == ipc::backpressure::sample))) {
+        // the only receiver couldn't skip any message
+        policy = ipc::backpressure::drop_newest;
+    }
+    inf->policy_      = policy;
+    inf->sample_rate_ = (ipc::detail::max)(sample_rate, 1u);
+    inf->sample_tick_ = 0;
+    inf->que_.overwrite((policy == ipc::backpressure::overwrite_oldest) ||
+                        (policy == ipc::backpressure::sample));
+    return true;
+}
+
+static std::size_t fill_recv_stats(typename queue_t::elems_t const *elems, latency_segment_t const *seg,
+                                   ipc::recv_stat * stats, std::size_t n) noexcept {
+    ipc::circ::progress_t progress[latency_segment_t::recv_max];
+    auto cursor = static_cast<ipc::circ::u2_t>(elems->cursor());
+    n = elems->progress(progress, (ipc::detail::min)(n, static_cast<std::size_t>(latency_segment_t::recv_max)), cursor);
+    auto now    = ipc::steady_now();
+    for (std::size_t i = 0; i < n; ++i) {
+        auto const &p = progress[i];
+        auto &st = stats[i];
+        st.id       = ipc::circ::conn_index_of(p.cc_id);
+        st.lag      = static_cast<std::uint32_t>(cursor - p.cursor);
+        st.lag_max  = p.lag_max;
+        st.capacity = static_cast<std::uint32_t>(queue_t::elems_t::elem_max);
+        st.idle_ns  = (now > p.last_pop) ? (now - p.last_pop) : 0;
+        st.losses   = {p.dropped, p.overwritten};
+        st.latency  = {};
+        if (seg != nullptr) {
+            st.latency = summarize(seg->recv_latency_[st.id % latency_segment_t::recv_max]);
+        }
+    }
+    return n;
+}
+
+static std::size_t recv_stats(ipc::handle_t h, ipc::recv_stat * stats, std::size_t n) noexcept {
+    auto que = queue_of(h);
+    if ((que == nullptr) || (que->elems() == nullptr) || (stats == nullptr)) {
+        return 0;
+    }
+    return fill_recv_stats(que->elems(), info_of(h)->latency_segment(false), stats, n);
+}
+
+static ipc::latency_stat summarize(ipc::log_histogram const &hist) noexcept {
+    static constexpr double qs[] = {0.5, 0.99, 0.999, 1.0};
+    std::uint64_t values[4] {};
+    ipc::latency_stat st {};
+    st.count   = hist.quantiles(qs, values, 4);
+    st.p50_ns  = values[0];
+    st.p99_ns  = values[1];
+    st.p999_ns = values[2];
+    st.max_ns  = values[3];
+    return st;
+}
+
+/* Without the histograms, nobody has traced the latency, it is left as zero. */
+static void fill_stats(stats_segment_t const *seg, latency_segment_t const *lat, ipc::chan_stats *st) noexcept {
+    std::uint64_t counters[stat_count];
+    seg->sum(counters);
+    st->msgs_sent         = counters[stat_msgs_sent];
+    st->bytes_sent        = counters[stat_bytes_sent];
+    st->msgs_recv         = counters[stat_msgs_recv];
+    st->bytes_recv        = counters[stat_bytes_recv];
+    st->fragment_sends    = counters[stat_fragment_sends];
+    st->large_sends       = counters[stat_large_sends];
+    st->force_pushes      = counters[stat_force_pushes];
+    st->wait_timeouts     = counters[stat_wait_timeouts];
+    st->storage_fallbacks = counters[stat_storage_fallbacks];
+    st->latency           = (lat == nullptr) ? ipc::latency_stat{} : summarize(lat->latency_);
+}
+
+static ipc::chan_stats stats(ipc::handle_t h) noexcept {
+    ipc::chan_stats st {};
+    auto inf = info_of(h);
+    auto *seg = (inf == nullptr) ? nullptr : inf->stats_segment();
+    if (seg != nullptr) {
+        fill_stats(seg, inf->latency_segment(false), &st);
+    }
+    return st;
+}
+
+static bool trace_latency(ipc::handle_t h, bool on) noexcept {
+    auto inf = info_of(h);
+    if (inf == nullptr) {
+        return false;
+    }
+    inf->trace_ = on;
+    if (on) inf->latency_segment(true); // for the receivers to record into
+    return true;
+}
+
+/* Maps the histograms of a channel for reading, if anybody has traced the latency. */
+static latency_segment_t const *open_latency(ipc::shm::handle &shm, std::string const &prefix, std::string const &name) noexcept {
+    if (!shm.acquire(latency_name(prefix, name).c_str(), sizeof(latency_segment_t), ipc::shm::open)) {
+        return nullptr;
+    }
+    return static_cast<latency_segment_t const *>(shm.get());
+}
+
+/* Maps the segments only for reading the counters, so it doesn't count as a connection. */
+static bool stats(ipc::prefix pref, char const * name, ipc::chan_stats *st) noexcept {
+    if (!ipc::is_valid_string(name) || (st == nullptr)) {
+        return false;
+    }
+    auto p = ipc::make_string(pref.str);
+    auto n = ipc::make_string(name);
+    ipc::shm::handle shm;
+    if (!shm.acquire(stats_name(p, n).c_str(), sizeof(stats_segment_t), ipc::shm::open)) {
+        return false;
+    }
+    ipc::shm::handle lt_shm;
+    fill_stats(static_cast<stats_segment_t const *>(shm.get()), open_latency(lt_shm, p, n), st);
+    return true;
+}
+
+template <ipc::relat Rp, ipc::relat Rc, typename E>
+static std::uint32_t occupancy(ipc::wr<Rp, Rc, ipc::trans::unicast>, E const *elems, ipc::chan_info const &) noexcept {
+    return static_cast<std::uint32_t>(elems->size());
+}
+
+/* A broadcast queue is as full as the slowest receiver makes it. */
+template <ipc::relat Rp, ipc::relat Rc, typename E>
+static std::uint32_t occupancy(ipc::wr<Rp, Rc, ipc::trans::broadcast>, E const *, ipc::chan_info const &info) noexcept {
+    std::uint32_t n = 0;
+    for (std::uint32_t i = 0; i < info.recv_count; ++i) {
+        n = (ipc::detail::max)(n, info.recvs[i].lag);
+    }
+    return n;
+}
+
+/* Maps the segments of the channel only for reading, so it doesn't count as a connection. */
+static bool inspect(ipc::prefix pref, char const * name, ipc::chan_info *info) noexcept {
+    if (!ipc::is_valid_string(name) || (info == nullptr)) {
+        return false;
+    }
+    auto p = ipc::make_string(pref.str);
+    auto n = ipc::make_string(name);
+    ipc::shm::handle que_shm;
+    auto *elems = conn_info_t::open_elems(que_shm, p, n);
+    if (elems == nullptr) {
+        return false;
+    }
+    ipc::shm::handle st_shm, lt_shm;
+    stats_segment_t const *seg = nullptr;
+    if (st_shm.acquire(stats_name(p, n).c_str(), sizeof(stats_segment_t), ipc::shm::open)) {
+        seg = static_cast<stats_segment_t const *>(st_shm.get());
+    }
+    auto *lat = open_latency(lt_shm, p, n);
+    *info = {};
+    info->capacity   = static_cast<std::uint32_t>(queue_t::elems_t::elem_max);
+    info->receivers  = elems->connections(std::memory_order_acquire);
+    info->recv_count = static_cast<std::uint32_t>(fill_recv_stats(elems, lat, info->recvs, 
+                                                  sizeof(info->recvs) / sizeof(info->recvs[0])));
+    info->occupancy  = occupancy(flag_t{}, elems, *info);
+    if (seg != nullptr) {
+        fill_stats(seg, lat, &(info->stats));
+    }
+    return true;
+}
+
+/* The chunk pools the senders of the channel have used, they are shared by the channels of the prefix. */
+static std::size_t chunk_stats(ipc::prefix pref, char const * name, ipc::chunk_stat *stats, std::size_t n) noexcept {
+    if (!ipc::is_valid_string(name) || (stats == nullptr)) {
+        return 0;
+    }
+    auto p = ipc::make_string(pref.str);
+    ipc::shm::handle st_shm;
+    if (!st_shm.acquire(stats_name(p, ipc::make_string(name)).c_str(), sizeof(stats_segment_t), ipc::shm::open)) {
+        return 0;
+    }
+    auto *seg = static_cast<stats_segment_t const *>(st_shm.get());
+    std::size_t k = 0;
+    for (std::size_t i = 0; (i < stats_segment_t::chunk_words * 64) && (k < n); ++i) {
+        if ((seg->chunk_sizes_[i / 64].load(std::memory_order_relaxed) & (std::uint64_t(1) << (i % 64))) == 0) {
+            continue;
+        }
+        std::size_t chunk_size = i * ipc::large_msg_align;
+        ipc::shm::handle shm;
+        if (!shm.acquire(ipc::make_prefix(p, "CHUNK_INFO__", chunk_size).c_str(),
+                         sizeof(chunk_info_t) + chunk_info_t::chunks_mem_size(chunk_size), ipc::shm::open)) {
+            continue; // the pool has gone with its last user
+        }
+        auto *info = static_cast<chunk_info_t const *>(shm.get());
+        auto &st = stats[k++];
+        st.chunk_size = static_cast<std::uint32_t>(chunk_size);
+        st.capacity   = static_cast<std::uint32_t>(ipc::id_pool<>::max_count);
+        st.in_use     = st.capacity - static_cast<std::uint32_t>(info->pool_.free_count());
+    }
+    return k;
+}
+
+static ipc::loss_stat losses(ipc::handle_t h) noexcept {
+    ipc::loss_stat st {};
+    auto que = queue_of(h);
+    if (que != nullptr) {
+        que->losses(st.dropped, st.overwritten);
+    }
+    return st;
+}
+
+/* Wraps a large message in place, the storage is recycled when the buffer is destroyed. */
+static ipc::buff_t storage_buff(conn_info_t *inf, ipc::storage_id_t buf_id, void *buf, std::size_t size, ipc::shm::id_t seg) {
+    struct recycle_t {
+        ipc::storage_id_t storage_id;
+        conn_info_t *     inf;
+        ipc::circ::cc_t   curr_conns;
+        ipc::circ::cc_t   conn_id;
+        ipc::shm::id_t    seg;
+    } r_info {
+        buf_id, 
+        inf, 
+        inf->que_.elems()->connections(std::memory_order_relaxed), 
+        inf->que_.connected_id(),
+        seg
+    };
+    // The recycle info is stored inside the buffer, no allocation is needed.
+    return ipc::buff_t{buf, size, [](void* p_info, std::size_t size) {
+        auto r_info = static_cast<recycle_t *>(p_info);
+        recycle_storage<flag_t>(r_info->storage_id, 
+                                r_info->inf, 
+                                size, 
+                                r_info->curr_conns, 
+                                r_info->conn_id,
+                                r_info->seg);
+    }, &r_info, sizeof(r_info)};
+}
+
+/* Copies the message out if it fits, otherwise keeps it pending for the next call. */
+static std::size_t deliver(conn_info_t *inf, ipc::buff_t buff, void *out, std::size_t out_size) {
+    std::size_t size = buff.size();
+    if (size <= out_size) {
+        std::memcpy(out, buff.data(), size);
+    } else {
+        inf->pending_ = std::move(buff);
     }
+    return size;
+}
+
+/* Pops the next message sent by the others, returns its size or 0 if failed. */
+static std::size_t pop_message(ipc::handle_t h, typename queue_t::value_t &msg, std::uint64_t tm) {
+    LIBIPC_LOG();
+    auto que = queue_of(h);
     conn_info_t *inf = info_of(h);
-    auto& rc = inf->recv_cache();
     for (;;) {
-        // pop a new message
-        typename queue_t::value_t msg {};
         if (!wait_for(inf->rd_waiter_, [que, &msg, &h] {
                 if (!que->connected()) {
                     reconnect(&h, true);
                 }
-                return !que->pop(msg);
+                if (que->pop(msg)) return false;
+                que->idle(); // has read everything
+                return true;
             }, tm)) {
             // pop failed, just return.
-            return {};
+            if (tm != 0) inf->count(stat_wait_timeouts);
+            return 0;
         }
-        inf->wt_waiter_.broadcast();
-        if ((inf->acc() != nullptr) && (msg.cc_id_ == inf->cc_id_)) {
+        inf->wt_waiter().broadcast();
+        que->track();
+        if ((inf->cc_id_ != 0) && (msg.cc_id_ == inf->cc_id_)) {
             continue; // ignore message to self
         }
+        inf->last_stamp_ = msg.stamp();
         // msg.remain_ may minus & abs(msg.remain_) < data_length
         std::int32_t r_size = static_cast<std::int32_t>(ipc::data_length) + msg.remain_;
         if (r_size <= 0) {
             log.error("fail: recv, r_size = ", (int)r_size);
+            return 0;
+        }
+        return static_cast<std::size_t>(r_size);
+    }
+}
+
+/*
+ * Starts reassembling a message with its first fragment.
+ * An unfinished message left in the cache is dropped.
+*/
+static void start_fragments(conn_info_t *inf, typename queue_t::value_t const &msg, ipc::buff_t &&buff) {
+    LIBIPC_LOG();
+    auto &cac = inf->cache_;
+    if (!cac.empty()) {
+        log.debug("recv: drop an incomplete message. msg_id: ", static_cast<msg_id_t>(cac.key_), 
+                  ", fill: ", cac.fill_, ", size: ", cac.buff_.size());
+    }
+    cac = cache_t{msg_key(msg.cc_id_, msg.id_), 0, std::move(buff)};
+    cac.append(&(msg.data_), ipc::data_length);
+}
+
+/*
+ * Appends a following fragment to the message in the cache.
+ * Returns the message if it is complete, otherwise an empty buffer.
+*/
+static ipc::buff_t append_fragment(conn_info_t *inf, typename queue_t::value_t const &msg, std::size_t msg_size) {
+    LIBIPC_LOG();
+    auto &cac = inf->cache_;
+    if (!cac.follows(msg_key(msg.cc_id_, msg.id_), msg_size)) {
+        log.debug("recv: drop a stray message fragment. msg_id: ", msg.id_, ", remain: ", msg.remain_);
+        return {};
+    }
+    cac.append(&(msg.data_), (ipc::detail::min)(msg_size, static_cast<std::size_t>(ipc::data_length)));
+    if (msg.remain_ > 0) {
+        return {};
+    }
+    // finish this message, take it from the cache
+    auto buff = std::move(cac.buff_);
+    cac = {};
+    return buff;
+}
+
+/*
+ * Pops the messages until one is complete, reassembling the fragmented ones.
+ * A fragmented message fitting in 'out_size' bytes is reassembled directly in 'out',
+ * then the returned buffer refers to 'out'.
+*/
+static ipc::buff_t next_message(ipc::handle_t h, std::uint64_t tm, void * out, std::size_t out_size) {
+    LIBIPC_LOG();
+    conn_info_t *inf = info_of(h);
+    // Before returning anything else, a message in caller memory must be moved into its own buffer.
+    auto &cac = inf->cache_;
+    auto detach = [&cac, out] {
+        if ((out != nullptr) && !cac.empty() && (cac.buff_.data() == out)) {
+            cac.buff_ = ipc::buff_t::copy_of(out, cac.buff_.size());
+        }
+    };
+    for (;;) {
+        // pop a new message
+        typename queue_t::value_t msg {};
+        std::size_t msg_size = pop_message(h, msg, tm);
+        if (msg_size == 0) {
+            detach();
             return {};
         }
-        std::size_t msg_size = static_cast<std::size_t>(r_size);
         // large message
         if (msg.storage_) {
             ipc::storage_id_t buf_id = *reinterpret_cast<ipc::storage_id_t*>(&msg.data_);
-            void* buf = find_storage(buf_id, inf, msg_size);
-            if (buf != nullptr) {
-                struct recycle_t {
-                    ipc::storage_id_t storage_id;
-                    conn_info_t *     inf;
-                    ipc::circ::cc_t   curr_conns;
-                    ipc::circ::cc_t   conn_id;
-                } *r_info = ipc::mem::$new<recycle_t>(recycle_t{
-                    buf_id, 
-                    inf, 
-                    que->elems()->connections(std::memory_order_relaxed), 
-                    que->connected_id()
-                });
-                if (r_info == nullptr) {
-                    log.error("fail: ipc::mem::$new<recycle_t>.");
-                    return ipc::buff_t{buf, msg_size}; // no recycle
-                } else {
-                    return ipc::buff_t{buf, msg_size, [](void* p_info, std::size_t size) {
-                        auto r_info = static_cast<recycle_t *>(p_info);
-                        LIBIPC_UNUSED auto finally = ipc::guard([r_info] {
-                            ipc::mem::$delete(r_info);
-                        });
-                        recycle_storage<flag_t>(r_info->storage_id, 
-                                                r_info->inf, 
-                                                size, 
-                                                r_info->curr_conns, 
-                                                r_info->conn_id);
-                    }, r_info};
-                }
-            } else {
+            ipc::shm::id_t seg;
+            void* buf = find_storage(buf_id, inf, msg.cc_id_, msg_size, &seg);
+            if (buf == nullptr) {
                 log.error("fail: shm::handle for large message. msg_id: ", msg.id_, ", buf_id: ", buf_id, ", size: ", msg_size);
                 continue;
             }
+            detach();
+            return storage_buff(inf, buf_id, buf, msg_size, seg);
         }
-        // find cache with msg.id_
-        auto cac_it = rc.find(msg.id_);
-        if (cac_it == rc.end()) {
+        if (msg.head_) {
+            detach();
             if (msg_size <= ipc::data_length) {
-                return make_cache(msg.data_, msg_size);
+                return ipc::buff_t::copy_of(&(msg.data_), msg_size);
             }
-            // gc
-            if (rc.size() > 1024) {
-                std::vector<msg_id_t> need_del;
-                for (auto const & pair : rc) {
-                    auto cmp = std::minmax(msg.id_, pair.first);
-                    if (cmp.second - cmp.first > 8192) {
-                        need_del.push_back(pair.first);
-                    }
-                }
-                for (auto id : need_del) rc.erase(id);
-            }
-            // cache the first message fragment
-            rc.emplace(msg.id_, cache_t { ipc::data_length, make_cache(msg.data_, msg_size) });
-        }
-        // has cached before this message
-        else {
-            auto& cac = cac_it->second;
-            // this is the last message fragment
-            if (msg.remain_ <= 0) {
-                cac.append(&(msg.data_), msg_size);
-                // finish this message, erase it from cache
-                auto buff = std::move(cac.buff_);
-                rc.erase(cac_it);
-                return buff;
+            // cache the first message fragment, in caller memory if it fits
+            if (msg_size <= out_size) {
+                start_fragments(inf, msg, ipc::buff_t{out, msg_size});
+            } else {
+                start_fragments(inf, msg, make_cache(msg.data_, msg_size));
             }
-            // there are remain datas after this message
-            cac.append(&(msg.data_), ipc::data_length);
+            continue;
+        }
+        auto buff = append_fragment(inf, msg, msg_size);
+        if (buff.empty()) {
+            continue;
         }
+        if (buff.data() != out) {
+            detach();
+        }
+        return buff;
+    }
+}
+
+static ipc::buff_t recv_message(ipc::handle_t h, std::uint64_t tm) {
+    LIBIPC_LOG();
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        log.error("fail: recv, queue_of(h) == nullptr");
+        return {};
+    }
+    conn_info_t *inf = info_of(h);
+    if (!inf->pending_.empty()) {
+        // left over by recv_into
+        return std::move(inf->pending_);
+    }
+    if (!que->connected()) {
+        // hasn't connected yet, just return.
+        return {};
+    }
+    return next_message(h, tm, nullptr, 0);
+}
+
+/* Counts a message handed over to the caller. */
+static void count_received(ipc::handle_t h, std::size_t size) noexcept {
+    if (size == 0) return;
+    auto inf = info_of(h);
+    inf->count(stat_msgs_recv);
+    inf->count(stat_bytes_recv, size);
+    if (inf->last_stamp_ != 0) {
+        inf->record_latency(inf->last_stamp_, inf->recv_slot());
     }
 }
 
+static ipc::buff_t recv(ipc::handle_t h, std::uint64_t tm) {
+    auto buff = recv_message(h, tm);
+    count_received(h, buff.size());
+    return buff;
+}
+
 static ipc::buff_t try_recv(ipc::handle_t h) {
     return recv(h, 0);
 }
 
+static std::size_t recv_message_into(ipc::handle_t h, void * out, std::size_t out_size, std::uint64_t tm) {
+    LIBIPC_LOG();
+    auto que = queue_of(h);
+    if (que == nullptr) {
+        log.error("fail: recv_into, queue_of(h) == nullptr");
+        return 0;
+    }
+    if (out == nullptr) {
+        out_size = 0;
+    }
+    conn_info_t *inf = info_of(h);
+    if (!inf->pending_.empty()) {
+        // the message didn't fit last time
+        return deliver(inf, std::move(inf->pending_), out, out_size);
+    }
+    if (!que->connected()) {
+        // hasn't connected yet, just return.
+        return 0;
+    }
+    auto buff = next_message(h, tm, out, out_size);
+    if (buff.empty()) {
+        return 0;
+    }
+    if (buff.data() == out) {
+        // reassembled in place
+        return buff.size();
+    }
+    return deliver(inf, std::move(buff), out, out_size);
+}
+
+static std::size_t recv_into(ipc::handle_t h, void * out, std::size_t out_size, std::uint64_t tm) {
+    auto size = recv_message_into(h, out, out_size, tm);
+    // a message kept pending is counted when it is delivered
+    if ((out != nullptr) && (size <= out_size)) {
+        count_received(h, size);
+    }
+    return size;
+}
+
+static std::size_t try_recv_into(ipc::handle_t h, void * out, std::size_t out_size) {
+    return recv_into(h, out, out_size, 0);
+}
+
 }; // detail_impl<Policy>
 
 template <typename Flag>
@@ -838,11 +2088,78 @@ bool chan_impl<Flag>::try_send(ipc::handle_t h, void const * data, std::size_t s
     return detail_impl<policy_t<Flag>>::try_send(h, data, size, tm);
 }
 
+template <typename Flag>
+bool chan_impl<Flag>::publish(ipc::handle_t h, std::uint64_t topics, void const * data, std::size_t size, std::uint64_t tm) {
+    using impl_t = detail_impl<policy_t<Flag>>;
+    return impl_t::publish([](auto&&... args) { return impl_t::send(args...); }, h, topics, data, size, tm);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::try_publish(ipc::handle_t h, std::uint64_t topics, void const * data, std::size_t size, std::uint64_t tm) {
+    using impl_t = detail_impl<policy_t<Flag>>;
+    return impl_t::publish([](auto&&... args) { return impl_t::try_send(args...); }, h, topics, data, size, tm);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::subscribe(ipc::handle_t h, std::uint64_t topics) {
+    return detail_impl<policy_t<Flag>>::subscribe(h, topics);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::backpressure(ipc::handle_t h, ipc::backpressure policy, std::uint32_t sample_rate) {
+    return detail_impl<policy_t<Flag>>::backpressure(h, policy, sample_rate);
+}
+
+template <typename Flag>
+loss_stat chan_impl<Flag>::losses(ipc::handle_t h) {
+    return detail_impl<policy_t<Flag>>::losses(h);
+}
+
+template <typename Flag>
+std::size_t chan_impl<Flag>::recv_stats(ipc::handle_t h, recv_stat * stats, std::size_t n) {
+    return detail_impl<policy_t<Flag>>::recv_stats(h, stats, n);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::stats(prefix pref, char const * name, chan_stats * st) {
+    return detail_impl<policy_t<Flag>>::stats(pref, name, st);
+}
+
+template <typename Flag>
+chan_stats chan_impl<Flag>::stats(ipc::handle_t h) {
+    return detail_impl<policy_t<Flag>>::stats(h);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::trace_latency(ipc::handle_t h, bool on) {
+    return detail_impl<policy_t<Flag>>::trace_latency(h, on);
+}
+
+template <typename Flag>
+bool chan_impl<Flag>::inspect(prefix pref, char const * name, chan_info * info) {
+    return detail_impl<policy_t<Flag>>::inspect(pref, name, info);
+}
+
+template <typename Flag>
+std::size_t chan_impl<Flag>::chunk_stats(prefix pref, char const * name, chunk_stat * stats, std::size_t n) {
+    return detail_impl<policy_t<Flag>>::chunk_stats(pref, name, stats, n);
+}
+
 template <typename Flag>
 buff_t chan_impl<Flag>::try_recv(ipc::handle_t h) {
     return detail_impl<policy_t<Flag>>::try_recv(h);
 }
 
+template <typename Flag>
+std::size_t chan_impl<Flag>::recv_into(ipc::handle_t h, void * buf, std::size_t size, std::uint64_t tm) {
+    return detail_impl<policy_t<Flag>>::recv_into(h, buf, size, tm);
+}
+
+template <typename Flag>
+std::size_t chan_impl<Flag>::try_recv_into(ipc::handle_t h, void * buf, std::size_t size) {
+    return detail_impl<policy_t<Flag>>::try_recv_into(h, buf, size);
+}
+
 template struct chan_impl<ipc::wr<relat::single, relat::single, trans::unicast  >>;
 // template struct chan_impl<ipc::wr<relat::single, relat::multi , trans::unicast  >>; // TBD
 // template struct chan_impl<ipc::wr<relat::multi , relat::multi , trans::unicast  >>; // TBD
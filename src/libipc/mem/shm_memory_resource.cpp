@@ -0,0 +1,245 @@
+
+#include <algorithm>
+
+#include "libipc/imp/log.h"
+#include "libipc/imp/aligned.h"
+#include "libipc/rw_lock.h"
+#include "libipc/mem/shm_memory_resource.h"
+#include "libipc/mem/verify_args.h"
+
+namespace ipc {
+namespace mem {
+namespace {
+
+constexpr std::uint32_t heap_magic = 0x48534D49; // "IMSH"
+
+enum : std::uint32_t {
+  state_empty,
+  state_initializing,
+  state_ready
+};
+
+enum : unsigned {
+  ready_timeout = 3000 // times of waiting for the initializing process
+};
+
+/// \brief Blocks are addressed in units of the smallest size class.
+constexpr std::uint64_t unit_shift = shm_heap::min_class_shift;
+constexpr std::uint64_t max_heap_size = (std::uint64_t(1) << 32) << unit_shift;
+static_assert(max_heap_size == (std::uint64_t(1) << shm_heap::max_class_shift),
+              "the largest size class should cover the whole heap");
+
+/// \brief A free list head is (tag << 32 | block unit), the tag defeats ABA.
+constexpr std::uint32_t unit_of(std::uint64_t head) noexcept {
+  return static_cast<std::uint32_t>(head);
+}
+
+constexpr std::uint64_t make_head(std::uint32_t unit, std::uint64_t old) noexcept {
+  return (((old >> 32) + 1) << 32) | unit;
+}
+
+constexpr std::size_t heap_head_size() noexcept {
+  return ipc::round_up<std::size_t>(sizeof(shm_heap), 64);
+}
+
+/// \brief Returns the shift of the size class for the request, or 0 if it is too large.
+std::size_t class_shift_of(std::size_t bytes, std::size_t alignment) noexcept {
+  std::uint64_t need = (std::max)(bytes, alignment);
+  std::size_t shift = shm_heap::min_class_shift;
+  while ((std::uint64_t(1) << shift) < need) {
+    if (++shift > shm_heap::max_class_shift) return 0;
+  }
+  return shift;
+}
+
+std::atomic<std::uint32_t> &next_of(void *block) noexcept {
+  return *static_cast<std::atomic<std::uint32_t> *>(block);
+}
+
+} // namespace
+
+shm_heap *shm_heap::make(void *mem, std::size_t size) noexcept {
+  LIBIPC_LOG();
+  if ((mem == nullptr) || (size < heap_head_size() + (std::size_t(1) << min_class_shift))) {
+    log.error("invalid memory for shm_heap, size = ", size);
+    return nullptr;
+  }
+  if (size > max_heap_size) {
+    log.error("the memory is too large for shm_heap, size = ", size);
+    return nullptr;
+  }
+  // The memory of a new segment is zero-filled, so the state can be read before construction.
+  auto *heap = static_cast<shm_heap *>(mem);
+  auto state = static_cast<std::uint32_t>(state_empty);
+  if (heap->state_.compare_exchange_strong(state, state_initializing, std::memory_order_acq_rel)) {
+    heap->magic_ = heap_magic;
+    heap->size_  = size;
+    heap->top_  .store(heap_head_size(), std::memory_order_relaxed);
+    heap->root_ .store(0, std::memory_order_relaxed);
+    for (auto &head : heap->free_) head.store(0, std::memory_order_relaxed);
+    heap->state_.store(state_ready, std::memory_order_release);
+    return heap;
+  }
+  for (unsigned k = 0, n = 0; heap->state_.load(std::memory_order_acquire) != state_ready; ++n) {
+    if (n >= ready_timeout) {
+      log.error("the shm_heap is not initialized.");
+      return nullptr;
+    }
+    ipc::sleep(k);
+  }
+  if (heap->magic_ != heap_magic) {
+    log.error("the memory doesn't hold a shm_heap, magic = ", heap->magic_);
+    return nullptr;
+  }
+  if (heap->size_ > size) {
+    log.error("the memory is smaller than the shm_heap, size = ", size, ", expected = ", heap->size_);
+    return nullptr;
+  }
+  return heap;
+}
+
+std::uint8_t *shm_heap::base() const noexcept {
+  return reinterpret_cast<std::uint8_t *>(const_cast<shm_heap *>(this));
+}
+
+void *shm_heap::allocate(std::size_t bytes, std::size_t alignment) noexcept {
+  LIBIPC_LOG();
+  if (!verify_args(bytes, alignment) || (alignment > max_alignment)) {
+    log.error("invalid bytes = ", bytes, ", alignment = ", alignment);
+    return nullptr;
+  }
+  std::size_t shift = class_shift_of(bytes, alignment);
+  if (shift == 0) {
+    log.error("too large for shm_heap, bytes = ", bytes, ", alignment = ", alignment);
+    return nullptr;
+  }
+  // Reuses a freed block of the class first.
+  auto &free_head = free_[shift - min_class_shift];
+  auto head = free_head.load(std::memory_order_acquire);
+  while (unit_of(head) != 0) {
+    void *block = base() + (std::uint64_t(unit_of(head)) << unit_shift);
+    // The block stays mapped, a stale next is rejected by the tag.
+    auto next = next_of(block).load(std::memory_order_relaxed);
+    if (free_head.compare_exchange_weak(head, make_head(next, head),
+                                        std::memory_order_acq_rel, std::memory_order_acquire)) {
+      return block;
+    }
+  }
+  // Cuts a new block from the tail, aligned to its size (at most max_alignment).
+  std::uint64_t block_size  = std::uint64_t(1) << shift;
+  std::uint64_t block_align = (std::min<std::uint64_t>)(block_size, max_alignment);
+  auto top = top_.load(std::memory_order_relaxed);
+  for (;;) {
+    auto off = ipc::round_up(top, block_align);
+    if (off + block_size > size_) {
+      return nullptr; // exhausted
+    }
+    if (top_.compare_exchange_weak(top, off + block_size, std::memory_order_relaxed)) {
+      return base() + off;
+    }
+  }
+}
+
+void shm_heap::deallocate(void *p, std::size_t bytes, std::size_t alignment) noexcept {
+  LIBIPC_LOG();
+  if (p == nullptr) return;
+  std::size_t shift = class_shift_of(bytes, alignment);
+  auto off = static_cast<std::uint64_t>(static_cast<std::uint8_t *>(p) - base());
+  if ((shift == 0) || (static_cast<std::uint8_t *>(p) < base()) || (off >= size_)) {
+    log.error("invalid block for shm_heap, bytes = ", bytes, ", alignment = ", alignment);
+    return;
+  }
+  auto &free_head = free_[shift - min_class_shift];
+  auto unit = static_cast<std::uint32_t>(off >> unit_shift);
+  auto head = free_head.load(std::memory_order_relaxed);
+  do {
+    next_of(p).store(unit_of(head), std::memory_order_relaxed);
+  } while (!free_head.compare_exchange_weak(head, make_head(unit, head),
+                                            std::memory_order_release, std::memory_order_relaxed));
+}
+
+void *shm_heap::root() const noexcept {
+  auto off = root_.load(std::memory_order_acquire);
+  return (off == 0) ? nullptr : base() + off;
+}
+
+bool shm_heap::set_root(void *p) noexcept {
+  if (p == nullptr) return false;
+  std::uint64_t none = 0;
+  return root_.compare_exchange_strong(none, static_cast<std::uint64_t>(static_cast<std::uint8_t *>(p) - base()),
+                                       std::memory_order_acq_rel);
+}
+
+std::size_t shm_heap::size() const noexcept {
+  return static_cast<std::size_t>(size_);
+}
+
+std::size_t shm_heap::used() const noexcept {
+  return static_cast<std::size_t>(top_.load(std::memory_order_relaxed));
+}
+
+shm_memory_resource::shm_memory_resource() noexcept
+  : heap_(nullptr) {}
+
+shm_memory_resource::shm_memory_resource(char const *name, std::size_t size) noexcept
+  : shm_memory_resource() {
+  open(name, size);
+}
+
+shm_memory_resource::~shm_memory_resource() noexcept {
+  close();
+}
+
+bool shm_memory_resource::valid() const noexcept {
+  return heap_ != nullptr;
+}
+
+bool shm_memory_resource::open(char const *name, std::size_t size) noexcept {
+  LIBIPC_LOG();
+  close();
+  if (!shm_.acquire(name, size)) {
+    log.error("failed: acquire the segment of shm_memory_resource: ", name);
+    return false;
+  }
+  // The mapping may be larger than requested, e.g. the reference counter is kept at its tail.
+  if ((heap_ = shm_heap::make(shm_.get(), (std::min)(size, shm_.size()))) == nullptr) {
+    shm_.release();
+    return false;
+  }
+  return true;
+}
+
+void shm_memory_resource::close() noexcept {
+  heap_ = nullptr;
+  shm_.release();
+}
+
+void shm_memory_resource::clear() noexcept {
+  heap_ = nullptr;
+  shm_.clear();
+}
+
+void shm_memory_resource::clear_storage(char const *name) noexcept {
+  ipc::shm::handle::clear_storage(name);
+}
+
+shm_heap *shm_memory_resource::heap() const noexcept {
+  return heap_;
+}
+
+char const *shm_memory_resource::name() const noexcept {
+  return shm_.name();
+}
+
+void *shm_memory_resource::allocate(std::size_t bytes, std::size_t alignment) noexcept {
+  if (heap_ == nullptr) return nullptr;
+  return heap_->allocate(bytes, alignment);
+}
+
+void shm_memory_resource::deallocate(void *p, std::size_t bytes, std::size_t alignment) noexcept {
+  if (heap_ == nullptr) return;
+  heap_->deallocate(p, bytes, alignment);
+}
+
+} // namespace mem
+} // namespace ipc
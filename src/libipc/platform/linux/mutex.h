@@ -94,11 +94,23 @@ public:
         }
         return true;
     }
+
+    /*
+     * Unlocks it if this thread holds it, before its memory goes away.
+     * A locked mutex stays on the robust list of the thread,
+     * the next lock of the thread would write into the unmapped memory.
+    */
+    void unlock_owned() noexcept {
+        if (!valid()) return;
+        static_cast<void>(a0_mtx_unlock(native())); // EPERM if not the owner
+    }
 };
 
 class mutex {
     robust_mutex *mutex_ = nullptr;
     std::atomic<std::int32_t> *ref_ = nullptr;
+    robust_mutex local_;    // the mutex opened on caller-provided memory
+    std::atomic<std::int32_t> local_ref_ {0};
 
     struct curr_prog {
         struct shm_data {
@@ -183,11 +195,33 @@ public:
         return true;
     }
 
+    bool open(void *mem, std::size_t size, bool init) noexcept {
+        close();
+        if (!local_.open(mem, size, init)) {
+            return false;
+        }
+        mutex_ = &local_;
+        ref_   = &local_ref_;
+        return true;
+    }
+
+    static constexpr std::size_t storage_size() noexcept {
+        return robust_mutex::storage_size();
+    }
+
     void close() noexcept {
-        if ((mutex_ != nullptr) && (ref_ != nullptr)) {
+        if (mutex_ == &local_) {
+            // The mutex opened on caller-provided memory belongs to the caller.
+            local_.close();
+        } else if ((mutex_ != nullptr) && (ref_ != nullptr)) {
             if (mutex_->name() != nullptr) {
                 release_mutex(mutex_->name(), [this] {
-                    return ref_->fetch_sub(1, std::memory_order_relaxed) <= 1;
+                    if (ref_->fetch_sub(1, std::memory_order_relaxed) > 1) {
+                        return false;
+                    }
+                    // The last one in this process unmaps it.
+                    mutex_->unlock_owned();
+                    return true;
                 });
             } else mutex_->close();
         }
@@ -196,9 +230,13 @@ public:
     }
 
     void clear() noexcept {
-        if (mutex_ != nullptr) {
+        if (mutex_ == &local_) {
+            local_.unlock_owned();
+            local_.clear();
+        } else if (mutex_ != nullptr) {
             if (mutex_->name() != nullptr) {
                 release_mutex(mutex_->name(), [this] {
+                    mutex_->unlock_owned();
                     mutex_->clear();
                     return true;
                 });
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 #include "libipc/imp/log.h"
 #include "libipc/shm.h"
 
@@ -59,6 +61,21 @@ public:
         return true;
     }
 
+    /* opens the object on caller-provided memory, 'init' is true for the one initializing it */
+    bool open(void *mem, std::size_t size, bool init) noexcept {
+        close();
+        if ((mem == nullptr) || (size < storage_size())) {
+            return false;
+        }
+        h_ = static_cast<sync_t *>(mem);
+        if (init) *h_ = A0_EMPTY;
+        return true;
+    }
+
+    static constexpr std::size_t storage_size() noexcept {
+        return sizeof(sync_t);
+    }
+
     void close() noexcept {
         shm_.release();
         h_ = nullptr;
@@ -29,6 +29,27 @@ class condition {
         return static_cast<pthread_cond_t *>(shm_.get());
     }
 
+    static bool init_cond(pthread_cond_t *cond) noexcept {
+        LIBIPC_LOG();
+        int eno;
+        pthread_condattr_t cond_attr;
+        if ((eno = ::pthread_condattr_init(&cond_attr)) != 0) {
+            log.error("fail pthread_condattr_init[", eno, "]");
+            return false;
+        }
+        LIBIPC_UNUSED auto guard_cond_attr = guard([&cond_attr] { ::pthread_condattr_destroy(&cond_attr); });
+        if ((eno = ::pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED)) != 0) {
+            log.error("fail pthread_condattr_setpshared[", eno, "]");
+            return false;
+        }
+        *cond = PTHREAD_COND_INITIALIZER;
+        if ((eno = ::pthread_cond_init(cond, &cond_attr)) != 0) {
+            log.error("fail pthread_cond_init[", eno, "]");
+            return false;
+        }
+        return true;
+    }
+
 public:
     condition() = default;
     ~condition() = default;
@@ -48,7 +69,6 @@ public:
     }
 
     bool open(char const *name) noexcept {
-        LIBIPC_LOG();
         close();
         if ((cond_ = acquire_cond(name)) == nullptr) {
             return false;
@@ -58,30 +78,35 @@ public:
         }
         ::pthread_cond_destroy(cond_);
         auto finally = ipc::guard([this] { close(); }); // close when failed
-        // init condition
-        int eno;
-        pthread_condattr_t cond_attr;
-        if ((eno = ::pthread_condattr_init(&cond_attr)) != 0) {
-            log.error("fail pthread_condattr_init[", eno, "]");
+        if (!init_cond(cond_)) {
             return false;
         }
-        LIBIPC_UNUSED auto guard_cond_attr = guard([&cond_attr] { ::pthread_condattr_destroy(&cond_attr); });
-        if ((eno = ::pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED)) != 0) {
-            log.error("fail pthread_condattr_setpshared[", eno, "]");
+        finally.dismiss();
+        return valid();
+    }
+
+    bool open(void *mem, std::size_t size, bool init) noexcept {
+        close();
+        if ((mem == nullptr) || (size < storage_size())) {
             return false;
         }
-        *cond_ = PTHREAD_COND_INITIALIZER;
-        if ((eno = ::pthread_cond_init(cond_, &cond_attr)) != 0) {
-            log.error("fail pthread_cond_init[", eno, "]");
+        cond_ = static_cast<pthread_cond_t *>(mem);
+        if (init && !init_cond(cond_)) {
+            cond_ = nullptr;
             return false;
         }
-        finally.dismiss();
         return valid();
     }
 
+    static constexpr std::size_t storage_size() noexcept {
+        return sizeof(pthread_cond_t);
+    }
+
+
     void close() noexcept {
         LIBIPC_LOG();
-        if ((shm_.ref() <= 1) && cond_ != nullptr) {
+        // The condition opened on caller-provided memory belongs to the caller.
+        if (shm_.valid() && (shm_.ref() <= 1) && cond_ != nullptr) {
             int eno;
             if ((eno = ::pthread_cond_destroy(cond_)) != 0) {
                 log.error("fail pthread_cond_destroy[", eno, "]");
@@ -93,7 +118,7 @@ public:
 
     void clear() noexcept {
         LIBIPC_LOG();
-        if ((shm_.ref() <= 1) && cond_ != nullptr) {
+        if ((!shm_.valid() || (shm_.ref() <= 1)) && cond_ != nullptr) {
             int eno;
             if ((eno = ::pthread_cond_destroy(cond_)) != 0) {
                 log.error("fail pthread_cond_destroy[", eno, "]");
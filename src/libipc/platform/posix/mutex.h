@@ -89,6 +89,31 @@ class mutex {
         return tmp;
     }
 
+    static bool init_mutex(pthread_mutex_t *mutex) noexcept {
+        LIBIPC_LOG();
+        int eno;
+        pthread_mutexattr_t mutex_attr;
+        if ((eno = ::pthread_mutexattr_init(&mutex_attr)) != 0) {
+            log.error("fail pthread_mutexattr_init[", eno, "]");
+            return false;
+        }
+        LIBIPC_UNUSED auto guard_mutex_attr = guard([&mutex_attr] { ::pthread_mutexattr_destroy(&mutex_attr); });
+        if ((eno = ::pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED)) != 0) {
+            log.error("fail pthread_mutexattr_setpshared[", eno, "]");
+            return false;
+        }
+        if ((eno = ::pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST)) != 0) {
+            log.error("fail pthread_mutexattr_setrobust[", eno, "]");
+            return false;
+        }
+        *mutex = PTHREAD_MUTEX_INITIALIZER;
+        if ((eno = ::pthread_mutex_init(mutex, &mutex_attr)) != 0) {
+            log.error("fail pthread_mutex_init[", eno, "]");
+            return false;
+        }
+        return true;
+    }
+
 public:
     mutex() = default;
     ~mutex() = default;
@@ -108,12 +133,11 @@ public:
     }
 
     bool valid() const noexcept {
-        return (shm_ != nullptr) && (ref_ != nullptr) && (mutex_ != nullptr)
+        return (mutex_ != nullptr)
             && (std::memcmp(&zero_mem(), mutex_, sizeof(pthread_mutex_t)) != 0);
     }
 
     bool open(char const *name) noexcept {
-        LIBIPC_LOG();
         close();
         if ((mutex_ = acquire_mutex(name)) == nullptr) {
             return false;
@@ -124,31 +148,31 @@ public:
         }
         ::pthread_mutex_destroy(mutex_);
         auto finally = ipc::guard([this] { close(); }); // close when failed
-        // init mutex
-        int eno;
-        pthread_mutexattr_t mutex_attr;
-        if ((eno = ::pthread_mutexattr_init(&mutex_attr)) != 0) {
-            log.error("fail pthread_mutexattr_init[", eno, "]");
+        if (!init_mutex(mutex_)) {
             return false;
         }
-        LIBIPC_UNUSED auto guard_mutex_attr = guard([&mutex_attr] { ::pthread_mutexattr_destroy(&mutex_attr); });
-        if ((eno = ::pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED)) != 0) {
-            log.error("fail pthread_mutexattr_setpshared[", eno, "]");
-            return false;
-        }
-        if ((eno = ::pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST)) != 0) {
-            log.error("fail pthread_mutexattr_setrobust[", eno, "]");
+        finally.dismiss();
+        return valid();
+    }
+
+    bool open(void *mem, std::size_t size, bool init) noexcept {
+        close();
+        if ((mem == nullptr) || (size < storage_size())) {
             return false;
         }
-        *mutex_ = PTHREAD_MUTEX_INITIALIZER;
-        if ((eno = ::pthread_mutex_init(mutex_, &mutex_attr)) != 0) {
-            log.error("fail pthread_mutex_init[", eno, "]");
+        mutex_ = static_cast<pthread_mutex_t *>(mem);
+        if (init && !init_mutex(mutex_)) {
+            mutex_ = nullptr;
             return false;
         }
-        finally.dismiss();
         return valid();
     }
 
+    static constexpr std::size_t storage_size() noexcept {
+        return sizeof(pthread_mutex_t);
+    }
+
+
     void close() noexcept {
         LIBIPC_LOG();
         if ((ref_ != nullptr) && (shm_ != nullptr) && (mutex_ != nullptr)) {
@@ -175,6 +199,7 @@ public:
                 });
             } else shm_->release();
         }
+        // The mutex opened on caller-provided memory belongs to the caller.
         shm_   = nullptr;
         ref_   = nullptr;
         mutex_ = nullptr;
@@ -182,7 +207,10 @@ public:
 
     void clear() noexcept {
         LIBIPC_LOG();
-        if ((shm_ != nullptr) && (mutex_ != nullptr)) {
+        if ((shm_ == nullptr) && (mutex_ != nullptr)) {
+            ::pthread_mutex_unlock(mutex_);
+            ::pthread_mutex_destroy(mutex_);
+        } else if ((shm_ != nullptr) && (mutex_ != nullptr)) {
             if (shm_->name() != nullptr) {
                 release_mutex(shm_->name(), [this, &log] {
                     // Unlock before destroying, same reasoning as in close()
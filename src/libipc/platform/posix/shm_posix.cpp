@@ -29,6 +29,8 @@ struct id_info_t {
     void*       mem_  = nullptr;
     std::size_t size_ = 0;
     std::string name_;
+    dev_t       dev_  = 0; // identify the object mapped, see 'is_current'
+    ino_t       ino_  = 0;
 };
 
 constexpr std::size_t calc_size(std::size_t size) {
@@ -135,12 +137,12 @@ void * get_mem(id_t id, std::size_t * size) {
         log.error("fail get_mem: invalid id (fd = -1)");
         return nullptr;
     }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        log.error("fail fstat[", errno, "]: ", ii->name_, ", size = ", ii->size_);
+        return nullptr;
+    }
     if (ii->size_ == 0) {
-        struct stat st;
-        if (::fstat(fd, &st) != 0) {
-            log.error("fail fstat[", errno, "]: ", ii->name_, ", size = ", ii->size_);
-            return nullptr;
-        }
         ii->size_ = static_cast<std::size_t>(st.st_size);
         if ((ii->size_ <= sizeof(info_t)) || (ii->size_ % sizeof(info_t))) {
             log.error("fail get_mem: ", ii->name_, ", invalid size = ", ii->size_);
@@ -162,6 +164,8 @@ void * get_mem(id_t id, std::size_t * size) {
     ::close(fd);
     ii->fd_  = -1;
     ii->mem_ = mem;
+    ii->dev_ = st.st_dev;
+    ii->ino_ = st.st_ino;
     if (size != nullptr) *size = ii->size_;
     acc_of(mem, ii->size_).fetch_add(1, std::memory_order_release);
     return mem;
@@ -192,6 +196,24 @@ std::int32_t release(id_t id) noexcept {
     return ret;
 }
 
+bool is_current(id_t id) noexcept {
+    if (id == nullptr) {
+        return false;
+    }
+    auto ii = static_cast<id_info_t*>(id);
+    if (ii->mem_ == nullptr || ii->name_.empty()) {
+        return false;
+    }
+    int fd = ::shm_open(ii->name_.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        return false; // removed
+    }
+    struct stat st;
+    bool same = (::fstat(fd, &st) == 0) && (st.st_dev == ii->dev_) && (st.st_ino == ii->ino_);
+    ::close(fd);
+    return same;
+}
+
 void remove(id_t id) noexcept {
     LIBIPC_LOG();
     if (id == nullptr) {
@@ -64,6 +64,16 @@ public:
         return valid();
     }
 
+    /* a condition of Windows is built on named kernel objects, it cannot live in caller-provided memory */
+    bool open(void * /*mem*/, std::size_t /*size*/, bool /*init*/) noexcept {
+        close();
+        return false;
+    }
+
+    static constexpr std::size_t storage_size() noexcept {
+        return 0;
+    }
+
     void close() noexcept {
         if (!valid()) return;
         sem_.close();
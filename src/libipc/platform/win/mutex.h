@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <system_error>
 
 #if defined(__MINGW32__)
@@ -46,6 +47,16 @@ public:
         return true;
     }
 
+    /* a mutex object of Windows cannot live in caller-provided memory */
+    bool open(void * /*mem*/, std::size_t /*size*/, bool /*init*/) noexcept {
+        close();
+        return false;
+    }
+
+    static constexpr std::size_t storage_size() noexcept {
+        return 0;
+    }
+
     void close() noexcept {
         if (!valid()) return;
         ::CloseHandle(h_);
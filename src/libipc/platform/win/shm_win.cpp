@@ -169,6 +169,14 @@ std::int32_t release(id_t id) noexcept {
     return ret;
 }
 
+bool is_current(id_t id) noexcept {
+    // A named file mapping object goes away with its last handle, the name can't refer to another one before.
+    if (id == nullptr) {
+        return false;
+    }
+    return static_cast<id_info_t*>(id)->mem_ != nullptr;
+}
+
 void remove(id_t id) noexcept {
     LIBIPC_LOG();
     if (id == nullptr) {
@@ -13,6 +13,15 @@
 #include "libipc/imp/log.h"
 #include "libipc/utility/utility.h"
 
+/**
+ * Called each time a loop below retries, after a failed CAS or on an element busy with another thread,
+ * with the operation retrying: push, push_n, force_push or pop.
+ * Nothing by default, the microbenchmarks define it to count the retries.
+*/
+#if !defined(LIBIPC_PROD_CONS_RETRY)
+#   define LIBIPC_PROD_CONS_RETRY(op)
+#endif
+
 namespace ipc {
 
 ////////////////////////////////////////////////////////////////
@@ -37,6 +46,11 @@ struct prod_cons_impl<wr<relat::single, relat::single, trans::unicast>> {
         return 0;
     }
 
+    /* The elements not read yet. */
+    circ::u2_t size() const noexcept {
+        return static_cast<circ::u2_t>(wt_.load(std::memory_order_acquire) - rd_.load(std::memory_order_acquire));
+    }
+
     template <typename W, typename F, typename E>
     bool push(W* /*wrapper*/, F&& f, E* elems) {
         auto cur_wt = circ::index_of(wt_.load(std::memory_order_relaxed));
@@ -97,6 +111,7 @@ struct prod_cons_impl<wr<relat::single, relat::multi , trans::unicast>>
                 std::forward<R>(out)(true);
                 return true;
             }
+            LIBIPC_PROD_CONS_RETRY(pop);
             ipc::yield(k);
         }
     }
@@ -128,6 +143,7 @@ struct prod_cons_impl<wr<relat::multi , relat::multi, trans::unicast>>
             if (ct_.compare_exchange_weak(cur_ct, nxt_ct, std::memory_order_acq_rel)) {
                 break;
             }
+            LIBIPC_PROD_CONS_RETRY(push);
             ipc::yield(k);
         }
         auto* el = elems + circ::index_of(cur_ct);
@@ -186,6 +202,7 @@ struct prod_cons_impl<wr<relat::multi , relat::multi, trans::unicast>>
                     std::forward<R>(out)(true);
                     return true;
                 }
+                LIBIPC_PROD_CONS_RETRY(pop);
                 ipc::yield(k);
             }
         }
@@ -206,8 +223,13 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
     struct elem_t {
         std::aligned_storage_t<DataSize, AlignSize> data_ {};
         std::atomic<rc_t> rc_ { 0 }; // read-counter
+        std::atomic<rc_t> to_ { 0 }; // (write index << 32) | receivers the element is addressed to
     };
 
+    constexpr static rc_t make_to(circ::u2_t wt, circ::cc_t to) noexcept {
+        return (static_cast<rc_t>(wt) << 32) | static_cast<rc_t>(to);
+    }
+
     alignas(cache_line_size) std::atomic<circ::u2_t> wt_;   // write index
     alignas(cache_line_size) rc_t epoch_ { 0 };             // only one writer
 
@@ -218,6 +240,7 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
     template <typename W, typename F, typename E>
     bool push(W* wrapper, F&& f, E* elems) {
         E* el;
+        circ::cc_t to, lag;
         for (unsigned k = 0;;) {
             circ::cc_t cc = wrapper->elems()->connections(std::memory_order_relaxed);
             if (cc == 0) return false; // no reader
@@ -225,18 +248,28 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
             // check all consumers have finished reading this element
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
             circ::cc_t rem_cc = cur_rc & ep_mask;
-            if ((cc & rem_cc) && ((cur_rc & ~ep_mask) == epoch_)) {
+            if ((lag = cc & rem_cc) && ((cur_rc & ~ep_mask) == epoch_)) {
                 return false; // has not finished yet
             }
-            // consider rem_cc to be 0 here
+            // Left unread since before the last 'force_push', the laggards lose it.
+            if (lag) el->to_.store(0, std::memory_order_relaxed);
+            to = wrapper->recipients(cc);
             if (el->rc_.compare_exchange_weak(
-                        cur_rc, epoch_ | static_cast<rc_t>(cc), std::memory_order_release)) {
+                        cur_rc, epoch_ | static_cast<rc_t>(to), std::memory_order_release)) {
                 break;
             }
+            LIBIPC_PROD_CONS_RETRY(push);
             ipc::yield(k);
         }
+        if (lag) {
+            // only counted while overwriting, otherwise the ids may have been reused by new receivers
+            if (wrapper->overwriting()) wrapper->elems()->overrun(lag);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
         std::forward<F>(f)(&(el->data_));
-        wt_.fetch_add(1, std::memory_order_release);
+        auto wt = wt_.load(std::memory_order_relaxed);
+        el->to_.store(make_to(wt, to), std::memory_order_release);
+        wt_.store(wt + 1, std::memory_order_release);
         return true;
     }
 
@@ -244,6 +277,7 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
     bool force_push(W* wrapper, F&& f, E* elems) {
         LIBIPC_LOG();
         E* el;
+        circ::cc_t to, lag;
         epoch_ += ep_incr;
         for (unsigned k = 0;;) {
             circ::cc_t cc = wrapper->elems()->connections(std::memory_order_relaxed);
@@ -252,30 +286,72 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
             // check all consumers have finished reading this element
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
             circ::cc_t rem_cc = cur_rc & ep_mask;
-            if (cc & rem_cc) {
+            lag = cc & rem_cc;
+            if (lag && wrapper->overwriting()) {
+                // The laggards would skip the element, the ones reading it would see the stamp changed.
+                el->to_.store(0, std::memory_order_relaxed);
+            }
+            else if (lag) {
                 log.debug("force_push: k = ", k, ", cc = ", cc, ", rem_cc = ", rem_cc);
                 cc = wrapper->elems()->disconnect_receiver(rem_cc); // disconnect all invalid readers
                 if (cc == 0) return false; // no reader
+                lag = 0;
             }
             // just compare & exchange
+            to = wrapper->recipients(cc);
             if (el->rc_.compare_exchange_weak(
-                        cur_rc, epoch_ | static_cast<rc_t>(cc), std::memory_order_release)) {
+                        cur_rc, epoch_ | static_cast<rc_t>(to), std::memory_order_release)) {
                 break;
             }
+            LIBIPC_PROD_CONS_RETRY(force_push);
             ipc::yield(k);
         }
+        if (lag) {
+            wrapper->elems()->overrun(lag);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
         std::forward<F>(f)(&(el->data_));
-        wt_.fetch_add(1, std::memory_order_release);
+        auto wt = wt_.load(std::memory_order_relaxed);
+        el->to_.store(make_to(wt, to), std::memory_order_release);
+        wt_.store(wt + 1, std::memory_order_release);
         return true;
     }
 
     template <typename W, typename F, typename R, typename E>
     bool pop(W* wrapper, circ::u2_t& cur, F&& f, R&& out, E* elems) {
-        if (cur == cursor()) return false; // acquire
-        auto* el = elems + circ::index_of(cur++);
-        std::forward<F>(f)(&(el->data_));
+        E* el;
+        rc_t stamp;
+        for (;;) {
+            if (cur == cursor()) return false; // acquire
+            el = elems + circ::index_of(cur);
+            // Skips the elements not addressed to this receiver, the writer doesn't wait for it on them.
+            // An element overwritten by a later round couldn't have been addressed to it either.
+            auto to = el->to_.load(std::memory_order_acquire);
+            if ((to != make_to(cur, static_cast<circ::cc_t>(to))) ||
+               !(static_cast<circ::cc_t>(to) & wrapper->connected_id())) {
+                ++cur;
+                continue;
+            }
+            ++cur;
+            std::forward<F>(f)(&(el->data_));
+            // The element may have been overwritten meanwhile by a 'force_push' not waiting for this receiver.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (el->to_.load(std::memory_order_relaxed) == to) {
+                stamp = to;
+                break;
+            }
+        }
         for (unsigned k = 0;;) {
+            /*
+             * The writer clears the stamp before claiming the read counter with a release CAS,
+             * so once this acquire load sees the claim, the stamp below is seen cleared too.
+            */
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
+            if (el->to_.load(std::memory_order_relaxed) != stamp) {
+                // taken over after being read, the read counter belongs to the new one
+                std::forward<R>(out)(false);
+                return true;
+            }
             if ((cur_rc & ep_mask) == 0) {
                 std::forward<R>(out)(true);
                 return true;
@@ -285,6 +361,7 @@ struct prod_cons_impl<wr<relat::single, relat::multi, trans::broadcast>> {
                 std::forward<R>(out)((nxt_rc & ep_mask) == 0);
                 return true;
             }
+            LIBIPC_PROD_CONS_RETRY(pop);
             ipc::yield(k);
         }
     }
@@ -309,6 +386,7 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
         std::aligned_storage_t<DataSize, AlignSize> data_ {};
         std::atomic<rc_t  > rc_   { 0 }; // read-counter
         std::atomic<flag_t> f_ct_ { 0 }; // commit flag
+        std::atomic<circ::cc_t> to_ { 0 }; // receivers the element is addressed to
     };
 
     alignas(cache_line_size) std::atomic<circ::u2_t> ct_;   // commit index
@@ -326,10 +404,60 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
         return inc_rc(rc) & ~rc_mask;
     }
 
-    template <typename W, typename F, typename E>
-    bool push(W* wrapper, F&& f, E* elems) {
+    /*
+     * Whether the element at 'cur' has been passed by the writers without this receiver:
+     * either it has been committed for a later round, or freed for one.
+    */
+    constexpr static bool passed(flag_t fl, circ::u2_t cur) noexcept {
+        return (fl != 0) && (static_cast<circ::u2_t>(
+                   static_cast<circ::u2_t>((fl >> 32) == 0xffffffffu ? ~fl : fl) - cur) - 1u < 0x7fffffffu);
+    }
+
+    /* Commits the element, or frees it at once if it isn't addressed to anyone. */
+    template <typename E, std::size_t N>
+    static void commit(E* el, circ::u2_t cur_ct, circ::cc_t to) noexcept {
+        el->to_.store(to, std::memory_order_release);
+        if (to == 0) {
+            el->f_ct_.store(cur_ct + N, std::memory_order_release);
+        } else {
+            el->f_ct_.store(~static_cast<flag_t>(cur_ct), std::memory_order_release);
+        }
+    }
+
+    /*
+     * Takes over an element before some receivers have read it, they would skip it from now on,
+     * and the ones reading it would see the flag changed.
+     * The fence orders the flag before the following claim of the read counter & the data:
+     * a reader seeing either of them (through an acquire load or fence) sees the flag changed as well.
+    */
+    template <typename E, std::size_t N>
+    static void take_over(E* el, circ::u2_t cur_ct) noexcept {
+        auto fl = ~static_cast<flag_t>(static_cast<circ::u2_t>(cur_ct - N));
+        el->f_ct_.compare_exchange_strong(fl, cur_ct, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /* Whether the element at 'cur' could be claimed by the writers of 'epoch' for the receivers in 'cc'. */
+    template <typename E>
+    static bool available(E* el, circ::u2_t cur, rc_t cur_rc, circ::cc_t cc, rc_t epoch) noexcept {
+        circ::cc_t rem_cc = cur_rc & rc_mask;
+        if ((cc & rem_cc) && ((cur_rc & ~ep_mask) == epoch)) {
+            return false; // has not finished yet
+        }
+        else if (!rem_cc) {
+            auto cur_fl = el->f_ct_.load(std::memory_order_acquire);
+            if ((cur_fl != cur) && cur_fl) {
+                return false; // full
+            }
+        }
+        return true;
+    }
+
+    template <typename W, typename F, typename E, std::size_t N>
+    bool push(W* wrapper, F&& f, E(& elems)[N]) {
         E* el;
         circ::u2_t cur_ct;
+        circ::cc_t to, lag;
         rc_t epoch = epoch_.load(std::memory_order_acquire);
         for (unsigned k = 0;;) {
             circ::cc_t cc = wrapper->elems()->connections(std::memory_order_relaxed);
@@ -338,7 +466,7 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
             // check all consumers have finished reading this element
             auto cur_rc = el->rc_.load(std::memory_order_relaxed);
             circ::cc_t rem_cc = cur_rc & rc_mask;
-            if ((cc & rem_cc) && ((cur_rc & ~ep_mask) == epoch)) {
+            if ((lag = cc & rem_cc) && ((cur_rc & ~ep_mask) == epoch)) {
                 return false; // has not finished yet
             }
             else if (!rem_cc) {
@@ -347,27 +475,151 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
                     return false; // full
                 }
             }
-            // consider rem_cc to be 0 here
+            // Left unread since before the last 'force_push', the laggards lose it.
+            if (lag) take_over<E, N>(el, cur_ct);
+            to = wrapper->recipients(cc);
             if (el->rc_.compare_exchange_weak(
-                        cur_rc, inc_mask(epoch | (cur_rc & ep_mask)) | static_cast<rc_t>(cc), std::memory_order_relaxed) &&
+                        cur_rc, inc_mask(epoch | (cur_rc & ep_mask)) | static_cast<rc_t>(to), std::memory_order_relaxed) &&
                 epoch_.compare_exchange_weak(epoch, epoch, std::memory_order_acq_rel)) {
                 break;
             }
+            LIBIPC_PROD_CONS_RETRY(push);
             ipc::yield(k);
         }
         // only one thread/process would touch here at one time
         ct_.store(cur_ct + 1, std::memory_order_release);
+        // only counted while overwriting, otherwise the ids may have been reused by new receivers
+        if (lag && wrapper->overwriting()) wrapper->elems()->overrun(lag);
         std::forward<F>(f)(&(el->data_));
         // set flag & try update wt
-        el->f_ct_.store(~static_cast<flag_t>(cur_ct), std::memory_order_release);
+        commit<E, N>(el, cur_ct, to);
         return true;
     }
 
-    template <typename W, typename F, typename E>
-    bool force_push(W* wrapper, F&& f, E* elems) {
+    /*
+     * Claims the elements following the first one of 'push_n' or 'force_push_n', which has been claimed at 'cur_ct',
+     * then fills & commits all of them. Nothing but the readers would touch them until 'ct_' moves.
+    */
+    template <typename W, typename F, typename E, std::size_t N>
+    void commit_n(W* wrapper, circ::u2_t cur_ct, std::size_t n, circ::cc_t cc, circ::cc_t to, circ::cc_t lag,
+                  rc_t epoch, F&& f, E(& elems)[N]) {
+        bool overwriting = wrapper->overwriting();
+        if (lag && overwriting) wrapper->elems()->overrun(lag);
+        for (std::size_t i = 1; i < n; ++i) {
+            auto cur = static_cast<circ::u2_t>(cur_ct + i);
+            auto* nx = elems + circ::index_of(cur);
+            auto cur_rc = nx->rc_.load(std::memory_order_relaxed);
+            circ::cc_t nx_lag;
+            do {
+                if ((nx_lag = cc & static_cast<circ::cc_t>(cur_rc & rc_mask)) != 0) take_over<E, N>(nx, cur);
+            } while (!nx->rc_.compare_exchange_weak(
+                        cur_rc, inc_mask(epoch | (cur_rc & ep_mask)) | static_cast<rc_t>(to), std::memory_order_relaxed));
+            if (nx_lag && overwriting) wrapper->elems()->overrun(nx_lag);
+        }
+        // only one thread/process would touch here at one time
+        ct_.store(static_cast<circ::u2_t>(cur_ct + n), std::memory_order_release);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto cur = static_cast<circ::u2_t>(cur_ct + i);
+            auto* el = elems + circ::index_of(cur);
+            f(i, &(el->data_));
+            commit<E, N>(el, cur, to);
+        }
+    }
+
+
+    /**
+     * \brief Claims 'n' consecutive elements at once, so that no other producer could interleave with them.
+     * 'f(i, p)' fills the i-th element.
+     * \return false if any of the elements is not available, then nothing has been claimed.
+    */
+    template <typename W, typename F, typename E, std::size_t N>
+    bool push_n(W* wrapper, std::size_t n, F&& f, E(& elems)[N]) {
+        if ((n == 0) || (n > N)) return false;
+        E* el;
+        circ::u2_t cur_ct;
+        circ::cc_t cc, to, lag;
+        rc_t epoch = epoch_.load(std::memory_order_acquire);
+        for (unsigned k = 0;;) {
+            cc = wrapper->elems()->connections(std::memory_order_relaxed);
+            if (cc == 0) return false; // no reader
+            el = elems + circ::index_of(cur_ct = ct_.load(std::memory_order_relaxed));
+            auto cur_rc = el->rc_.load(std::memory_order_relaxed);
+            if (!available(el, cur_ct, cur_rc, cc, epoch)) return false;
+            // Other producers wait on the first element until 'ct_' moves, and the readers only free elements,
+            // so the following ones are checked ahead, and nothing needs to be rolled back after the claim.
+            for (std::size_t i = 1; i < n; ++i) {
+                auto cur = static_cast<circ::u2_t>(cur_ct + i);
+                auto* nx = elems + circ::index_of(cur);
+                if (!available(nx, cur, nx->rc_.load(std::memory_order_relaxed), cc, epoch)) return false;
+            }
+            if ((lag = cc & static_cast<circ::cc_t>(cur_rc & rc_mask)) != 0) take_over<E, N>(el, cur_ct);
+            to = wrapper->recipients(cc);
+            if (el->rc_.compare_exchange_weak(
+                        cur_rc, inc_mask(epoch | (cur_rc & ep_mask)) | static_cast<rc_t>(to), std::memory_order_relaxed) &&
+                epoch_.compare_exchange_weak(epoch, epoch, std::memory_order_acq_rel)) {
+                break;
+            }
+            LIBIPC_PROD_CONS_RETRY(push_n);
+            ipc::yield(k);
+        }
+        commit_n(wrapper, cur_ct, n, cc, to, lag, epoch, std::forward<F>(f), elems);
+        return true;
+    }
+
+    /**
+     * \brief Claims 'n' consecutive elements at once like 'push_n', whether the receivers have read them or not.
+     * The laggards would be taken over under the overwriting policies, otherwise disconnected like 'force_push'.
+    */
+    template <typename W, typename F, typename E, std::size_t N>
+    bool force_push_n(W* wrapper, std::size_t n, F&& f, E(& elems)[N]) {
+        LIBIPC_LOG();
+        if ((n == 0) || (n > N)) return false;
+        E* el;
+        circ::u2_t cur_ct;
+        circ::cc_t cc, to, lag;
+        rc_t epoch = epoch_.fetch_add(ep_incr, std::memory_order_release) + ep_incr;
+        for (unsigned k = 0;;) {
+            cc = wrapper->elems()->connections(std::memory_order_relaxed);
+            if (cc == 0) return false; // no reader
+            el = elems + circ::index_of(cur_ct = ct_.load(std::memory_order_relaxed));
+            if (!wrapper->overwriting()) {
+                circ::cc_t rem_cc = 0;
+                for (std::size_t i = 0; i < n; ++i) {
+                    rem_cc |= elems[circ::index_of(static_cast<circ::u2_t>(cur_ct + i))].rc_.load(std::memory_order_acquire) & rc_mask;
+                }
+                if (cc & rem_cc) {
+                    log.debug("force_push_n: k = ", k, ", cc = ", cc, ", rem_cc = ", rem_cc);
+                    cc = wrapper->elems()->disconnect_receiver(cc & rem_cc); // disconnect all invalid readers
+                    if (cc == 0) return false; // no reader
+                }
+            }
+            auto cur_rc = el->rc_.load(std::memory_order_acquire);
+            if ((lag = cc & static_cast<circ::cc_t>(cur_rc & rc_mask)) != 0) take_over<E, N>(el, cur_ct);
+            // just compare & exchange
+            to = wrapper->recipients(cc);
+            if (el->rc_.compare_exchange_weak(
+                        cur_rc, inc_mask(epoch | (cur_rc & ep_mask)) | static_cast<rc_t>(to), std::memory_order_relaxed)) {
+                if (epoch == epoch_.load(std::memory_order_acquire)) {
+                    break;
+                }
+                else if (push_n(wrapper, n, f, elems)) {
+                    return true;
+                }
+                epoch = epoch_.fetch_add(ep_incr, std::memory_order_release) + ep_incr;
+            }
+            LIBIPC_PROD_CONS_RETRY(force_push);
+            ipc::yield(k);
+        }
+        commit_n(wrapper, cur_ct, n, cc, to, lag, epoch, std::forward<F>(f), elems);
+        return true;
+    }
+
+    template <typename W, typename F, typename E, std::size_t N>
+    bool force_push(W* wrapper, F&& f, E(& elems)[N]) {
         LIBIPC_LOG();
         E* el;
         circ::u2_t cur_ct;
+        circ::cc_t to, lag;
         rc_t epoch = epoch_.fetch_add(ep_incr, std::memory_order_release) + ep_incr;
         for (unsigned k = 0;;) {
             circ::cc_t cc = wrapper->elems()->connections(std::memory_order_relaxed);
@@ -376,14 +628,20 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
             // check all consumers have finished reading this element
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
             circ::cc_t rem_cc = cur_rc & rc_mask;
-            if (cc & rem_cc) {
+            lag = cc & rem_cc;
+            if (lag && wrapper->overwriting()) {
+                take_over<E, N>(el, cur_ct);
+            }
+            else if (lag) {
                 log.debug("force_push: k = ", k, ", cc = ", cc, ", rem_cc = ", rem_cc);
                 cc = wrapper->elems()->disconnect_receiver(rem_cc); // disconnect all invalid readers
                 if (cc == 0) return false; // no reader
+                lag = 0;
             }
             // just compare & exchange
+            to = wrapper->recipients(cc);
             if (el->rc_.compare_exchange_weak(
-                        cur_rc, inc_mask(epoch | (cur_rc & ep_mask)) | static_cast<rc_t>(cc), std::memory_order_relaxed)) {
+                        cur_rc, inc_mask(epoch | (cur_rc & ep_mask)) | static_cast<rc_t>(to), std::memory_order_relaxed)) {
                 if (epoch == epoch_.load(std::memory_order_acquire)) {
                     break;
                 }
@@ -392,27 +650,52 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
                 }
                 epoch = epoch_.fetch_add(ep_incr, std::memory_order_release) + ep_incr;
             }
+            LIBIPC_PROD_CONS_RETRY(force_push);
             ipc::yield(k);
         }
         // only one thread/process would touch here at one time
         ct_.store(cur_ct + 1, std::memory_order_release);
+        if (lag) wrapper->elems()->overrun(lag);
         std::forward<F>(f)(&(el->data_));
         // set flag & try update wt
-        el->f_ct_.store(~static_cast<flag_t>(cur_ct), std::memory_order_release);
+        commit<E, N>(el, cur_ct, to);
         return true;
     }
 
     template <typename W, typename F, typename R, typename E, std::size_t N>
     bool pop(W* wrapper, circ::u2_t& cur, F&& f, R&& out, E(& elems)[N]) {
-        auto* el = elems + circ::index_of(cur);
-        auto cur_fl = el->f_ct_.load(std::memory_order_acquire);
-        if (cur_fl != ~static_cast<flag_t>(cur)) {
-            return false; // empty
+        E* el;
+        flag_t cur_fl;
+        for (;;) {
+            el = elems + circ::index_of(cur);
+            cur_fl = el->f_ct_.load(std::memory_order_acquire);
+            if (cur_fl != ~static_cast<flag_t>(cur)) {
+                if (!passed(cur_fl, cur)) return false; // empty
+                ++cur; // passed without this receiver
+                continue;
+            }
+            // Skips the elements not addressed to this receiver, the writers don't wait for it on them.
+            // If the element is being reused, the flag has changed, and it wasn't addressed to it either.
+            if (!(el->to_.load(std::memory_order_acquire) & wrapper->connected_id()) ||
+                (el->f_ct_.load(std::memory_order_relaxed) != cur_fl)) {
+                ++cur;
+                continue;
+            }
+            ++cur;
+            std::forward<F>(f)(&(el->data_));
+            // The element may have been taken over meanwhile by a writer not waiting for this receiver.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (el->f_ct_.load(std::memory_order_relaxed) == cur_fl) break;
         }
-        ++cur;
-        std::forward<F>(f)(&(el->data_));
+        bool flagged = false; // has set the flag as the last reader
         for (unsigned k = 0;;) {
+            // A claim seen by the acquire load is preceded by the fence of 'take_over', so is the flag below.
             auto cur_rc = el->rc_.load(std::memory_order_acquire);
+            if (!flagged && (el->f_ct_.load(std::memory_order_relaxed) != cur_fl)) {
+                // taken over after being read, the read counter belongs to the new one
+                std::forward<R>(out)(false);
+                return true;
+            }
             if ((cur_rc & rc_mask) == 0) {
                 std::forward<R>(out)(true);
                 el->f_ct_.store(cur + N - 1, std::memory_order_release);
@@ -422,11 +705,13 @@ struct prod_cons_impl<wr<relat::multi, relat::multi, trans::broadcast>> {
             bool last_one = false;
             if ((last_one = (nxt_rc & rc_mask) == 0)) {
                 el->f_ct_.store(cur + N - 1, std::memory_order_release);
+                flagged = true;
             }
             if (el->rc_.compare_exchange_weak(cur_rc, nxt_rc, std::memory_order_release)) {
                 std::forward<R>(out)(last_one);
                 return true;
             }
+            LIBIPC_PROD_CONS_RETRY(pop);
             ipc::yield(k);
         }
     }
@@ -10,6 +10,7 @@
 #include <chrono>
 #include <string>
 #include <cassert>  // assert
+#include <cstring>
 
 #include "libipc/def.h"
 #include "libipc/shm.h"
@@ -17,7 +18,9 @@
 
 #include "libipc/imp/log.h"
 #include "libipc/platform/detail.h"
+#include "libipc/utility/utility.h"
 #include "libipc/circ/elem_def.h"
+#include "libipc/circ/record_array.h"
 #include "libipc/mem/resource.h"
 
 namespace ipc {
@@ -26,6 +29,7 @@ namespace detail {
 class queue_conn {
 protected:
     circ::cc_t connected_ = 0;
+    std::uint64_t subscribed_ = 0; // topics of the receiver, kept across reconnections
     shm::handle elems_h_;
 
     template <typename Elems>
@@ -81,9 +85,19 @@ public:
         // if it's already connected, just return
         if (connected(elems)) return {connected(elems), false, 0};
         connected_ = elems->connect_receiver();
+        elems->subscribe(connected_, subscribed_);
         return {connected(elems), true, elems->cursor()};
     }
 
+    /* Sets the topics of the messages this receiver wants, 0 for all. */
+    template <typename Elems>
+    void subscribe(Elems* elems, std::uint64_t topics) noexcept {
+        subscribed_ = topics;
+        if ((elems != nullptr) && connected(elems)) {
+            elems->subscribe(connected_, topics);
+        }
+    }
+
     template <typename Elems>
     bool disconnect(Elems* elems) noexcept {
         if (elems == nullptr) return false;
@@ -106,6 +120,12 @@ protected:
     elems_t * elems_ = nullptr;
     decltype(std::declval<elems_t>().cursor()) cursor_ = 0;
     bool sender_flag_ = false;
+    std::uint64_t topics_ = 0; // topics of the messages being pushed, 0 for all receivers
+    circ::cc_t muted_ = 0;     // receivers the messages being pushed skip
+    bool overwrite_ = false;   // whether 'force_push' overwrites the unread elements of the laggards
+    unsigned untracked_ = 0;   // pops whose time hasn't been reported yet, see 'track'
+
+    enum : unsigned { track_interval = 16 }; // pops between two reads of the clock
 
 public:
     using base_t::base_t;
@@ -133,6 +153,14 @@ public:
         return elems_ != nullptr;
     }
 
+    /* opens the elements placed in a segment managed by the caller */
+    bool open(elems_t * elems) noexcept {
+        base_t::close();
+        if (elems != nullptr) elems->init();
+        elems_ = elems;
+        return elems_ != nullptr;
+    }
+
     void clear() noexcept {
         base_t::clear();
         elems_ = nullptr;
@@ -160,6 +188,8 @@ public:
         auto tp = base_t::connect(elems_);
         if (std::get<0>(tp) && std::get<1>(tp)) {
             cursor_ = std::get<2>(tp);
+            untracked_ = 1;
+            idle();
             return true;
         }
         return std::get<0>(tp);
@@ -173,6 +203,75 @@ public:
         return (elems_ == nullptr) ? static_cast<std::size_t>(invalid_value) : elems_->conn_count();
     }
 
+    void subscribe(std::uint64_t topics) noexcept {
+        base_t::subscribe(elems_, topics);
+    }
+
+    /* The following pushes only address the receivers subscribing to any of the topics. */
+    void topics(std::uint64_t topics) noexcept {
+        topics_ = topics;
+    }
+
+    /* The following pushes skip the receivers in 'cc'. */
+    void mute(circ::cc_t cc) noexcept {
+        muted_ = cc;
+    }
+
+    /* Picks the receivers in 'cc' the pushing message should be addressed to. */
+    circ::cc_t recipients(circ::cc_t cc) const noexcept {
+        return ((elems_ == nullptr) ? cc : elems_->recipients(cc, topics_)) & ~muted_;
+    }
+
+    /*
+     * If true, 'force_push' overwrites the elements the laggards haven't read,
+     * instead of disconnecting them (broadcast only).
+    */
+    void overwrite(bool ow) noexcept {
+        overwrite_ = ow;
+    }
+
+    bool overwriting() const noexcept {
+        return overwrite_;
+    }
+
+    /*
+     * Reports the progress of this receiver after it has popped.
+     * The time of its pops is reported every few pops, and by 'idle' once it has read everything.
+    */
+    void track() noexcept {
+        if ((elems_ == nullptr) || (connected_ == 0)) return;
+        std::uint64_t now = 0;
+        if (++untracked_ >= track_interval) {
+            untracked_ = 0;
+            now = ipc::steady_now();
+        }
+        elems_->track(connected_, static_cast<circ::u2_t>(cursor_), now);
+        if ((elems_->lagging() & connected_) && (elems_->cursor() == cursor_)) {
+            elems_->caught_up(connected_);
+        }
+    }
+
+    /* Reports the time of the pops not reported yet, before waiting for more. */
+    void idle() noexcept {
+        if ((elems_ == nullptr) || (connected_ == 0) || (untracked_ == 0)) return;
+        untracked_ = 0;
+        elems_->track(connected_, static_cast<circ::u2_t>(cursor_), ipc::steady_now());
+    }
+
+    /* Fills the progress of the connected receivers, returns the number of them. */
+    std::size_t progress(circ::progress_t *out, std::size_t n) const noexcept {
+        return (elems_ == nullptr) ? 0 : elems_->progress(out, n, static_cast<circ::u2_t>(elems_->cursor()));
+    }
+
+    /* The messages this receiver has lost under the backpressure policies of the senders. */
+    void losses(std::uint64_t &dropped, std::uint64_t &overwritten) const noexcept {
+        if (elems_ == nullptr) {
+            dropped = overwritten = 0;
+            return;
+        }
+        elems_->losses(connected_, dropped, overwritten);
+    }
+
     bool valid() const noexcept {
         return elems_ != nullptr;
     }
@@ -189,6 +288,13 @@ public:
         });
     }
 
+    /* 'f(i, p)' would be called to construct the i-th element in place. */
+    template <typename F>
+    bool push_n(std::size_t n, F&& f) {
+        if (elems_ == nullptr) return false;
+        return elems_->push_n(this, n, std::forward<F>(f));
+    }
+
     template <typename T, typename F, typename... P>
     bool force_push(F&& prep, P&&... params) {
         if (elems_ == nullptr) return false;
@@ -197,6 +303,13 @@ public:
         });
     }
 
+    /* Like 'push_n', but whether the receivers have read the elements or not, see 'force_push'. */
+    template <typename F>
+    bool force_push_n(std::size_t n, F&& f) {
+        if (elems_ == nullptr) return false;
+        return elems_->force_push_n(this, n, std::forward<F>(f));
+    }
+
     template <typename T, typename F>
     bool pop(T& item, F&& out) {
         if (elems_ == nullptr) {
@@ -229,6 +342,9 @@ public:
         return base_t::template force_push<T>(std::forward<P>(params)...);
     }
 
+    using base_t::push_n;
+    using base_t::force_push_n;
+
     bool pop(T& item) {
         return base_t::pop(item, [](bool) {});
     }
@@ -239,4 +355,41 @@ public:
     }
 };
 
+/**
+ * \class record_queue
+ * \brief A queue of variable-length records, each message takes exactly one record.
+*/
+template <typename Flag, std::size_t RingSize = circ::record_ring_default>
+class record_queue final : public detail::queue_base<circ::record_array<Flag, RingSize>> {
+    using base_t = detail::queue_base<circ::record_array<Flag, RingSize>>;
+
+public:
+    enum : std::size_t {
+        max_payload = base_t::elems_t::max_payload
+    };
+
+    using base_t::base_t;
+
+    /* 'f' would be called with a pointer to 'size' bytes of writable record storage. */
+    template <typename F>
+    bool push(std::size_t size, F&& f) {
+        if (this->elems_ == nullptr) return false;
+        return this->elems_->push(this, size, std::forward<F>(f));
+    }
+
+    bool push(void const * data, std::size_t size) {
+        if ((data == nullptr) && (size != 0)) return false;
+        return this->push(size, [data, size](void* p) {
+            if (size != 0) std::memcpy(p, data, size);
+        });
+    }
+
+    /* 'f' would be called with the payload pointer & size of the popped record. */
+    template <typename F>
+    bool pop(F&& f) {
+        if (this->elems_ == nullptr) return false;
+        return this->elems_->pop(this, &(this->cursor_), std::forward<F>(f));
+    }
+};
+
 } // namespace ipc
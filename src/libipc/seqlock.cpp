@@ -0,0 +1,148 @@
+#include <string>
+#include <atomic>
+
+#include "libipc/seqlock.h"
+#include "libipc/shm.h"
+#include "libipc/waiter.h"
+
+#include "libipc/utility/pimpl.h"
+#include "libipc/imp/log.h"
+#include "libipc/imp/aligned.h"
+#include "libipc/mem/resource.h"
+
+namespace ipc {
+namespace detail {
+namespace {
+
+/* Placed at the head of the segment, zero-filled memory is a valid empty head. */
+struct snapshot_head_t {
+    std::atomic<std::uint64_t> data_size_; // 0 until the first opener records it
+    std::atomic<std::uint32_t> waiting_;   // readers blocking in 'wait_if'
+    std::atomic<bool>          waiter_;    // the waiter has been created by someone
+};
+
+std::string segment_name(char const * name) {
+    return ipc::make_prefix(ipc::make_string(name), "SN_CONN__");
+}
+
+std::string waiter_name(char const * name) {
+    return ipc::make_prefix(ipc::make_string(name), "SN_WAIT__");
+}
+
+} // namespace
+
+class snapshot_chan_base::snapshot_chan_ : public ipc::pimpl<snapshot_chan_> {
+public:
+    ipc::shm::handle     shm_;
+    ipc::detail::waiter  waiter_; // opened on the first wait or notification
+    snapshot_head_t *    head_ = nullptr;
+    void *               data_ = nullptr;
+    std::string          name_;
+
+    bool open_waiter() noexcept {
+        if (waiter_.valid()) return true;
+        head_->waiter_.store(true, std::memory_order_relaxed);
+        return waiter_.open(waiter_name(name_.c_str()).c_str());
+    }
+};
+
+snapshot_chan_base::snapshot_chan_base()
+    : p_(p_->make()) {
+}
+
+snapshot_chan_base::~snapshot_chan_base() {
+    close();
+    p_->clear();
+}
+
+bool snapshot_chan_base::valid() const noexcept {
+    return impl(p_)->head_ != nullptr;
+}
+
+char const * snapshot_chan_base::name() const noexcept {
+    return impl(p_)->name_.c_str();
+}
+
+bool snapshot_chan_base::open(char const * name, std::size_t data_size, std::size_t data_align) noexcept {
+    LIBIPC_LOG();
+    close();
+    if (!ipc::is_valid_string(name)) {
+        log.error("fail open snapshot_chan: name is empty");
+        return false;
+    }
+    auto data_off = ipc::round_up(sizeof(snapshot_head_t), data_align);
+    if (!impl(p_)->shm_.acquire(segment_name(name).c_str(), data_off + data_size)) {
+        log.error("fail acquire the segment of snapshot_chan: ", name);
+        return false;
+    }
+    auto *head = static_cast<snapshot_head_t *>(impl(p_)->shm_.get());
+    std::uint64_t expected = 0;
+    if (!head->data_size_.compare_exchange_strong(expected, data_size, std::memory_order_acq_rel)
+     && (expected != data_size)) {
+        log.error("the snapshot_chan holds another type: ", name,
+                  ", size = ", expected, ", expected = ", data_size);
+        impl(p_)->shm_.release();
+        return false;
+    }
+    impl(p_)->head_ = head;
+    impl(p_)->data_ = reinterpret_cast<ipc::byte *>(head) + data_off;
+    impl(p_)->name_ = name;
+    return true;
+}
+
+void snapshot_chan_base::close() noexcept {
+    impl(p_)->waiter_.close();
+    impl(p_)->shm_.release();
+    impl(p_)->head_ = nullptr;
+    impl(p_)->data_ = nullptr;
+    impl(p_)->name_.clear();
+}
+
+void snapshot_chan_base::clear() noexcept {
+    if (impl(p_)->name_.empty()) return;
+    if (impl(p_)->waiter_.valid()) {
+        impl(p_)->waiter_.clear();
+    }
+    else if (impl(p_)->head_->waiter_.load(std::memory_order_relaxed)) {
+        detail::waiter::clear_storage(waiter_name(impl(p_)->name_.c_str()).c_str());
+    }
+    impl(p_)->shm_.clear();
+    close();
+}
+
+void snapshot_chan_base::clear_storage(char const * name) noexcept {
+    detail::waiter::clear_storage(waiter_name(name).c_str());
+    ipc::shm::handle::clear_storage(segment_name(name).c_str());
+}
+
+void * snapshot_chan_base::data() const noexcept {
+    return impl(p_)->data_;
+}
+
+void snapshot_chan_base::notify() noexcept {
+    auto *head = impl(p_)->head_;
+    if (head == nullptr) return;
+    // Pairs with the increment in 'wait_if': either the reader sees the new sequence,
+    // or the writer sees the reader.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (head->waiting_.load(std::memory_order_relaxed) == 0) return;
+    if (!impl(p_)->open_waiter()) return;
+    impl(p_)->waiter_.broadcast();
+}
+
+bool snapshot_chan_base::wait_if(bool (*pred)(void const *), void const * ctx, std::uint64_t tm) noexcept {
+    LIBIPC_LOG();
+    auto *head = impl(p_)->head_;
+    if (head == nullptr) return false;
+    if (!impl(p_)->open_waiter()) {
+        log.error("fail open the waiter of snapshot_chan: ", impl(p_)->name_);
+        return false;
+    }
+    head->waiting_.fetch_add(1, std::memory_order_seq_cst);
+    bool ret = impl(p_)->waiter_.wait_if([pred, ctx] { return pred(ctx); }, tm);
+    head->waiting_.fetch_sub(1, std::memory_order_release);
+    return ret;
+}
+
+} // namespace detail
+} // namespace ipc
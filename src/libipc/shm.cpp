@@ -1,23 +1,92 @@
 
 #include <string>
 #include <utility>
+#include <mutex>
 
 #include "libipc/shm.h"
 
 #include "libipc/utility/pimpl.h"
 #include "libipc/imp/log.h"
 #include "libipc/mem/resource.h"
+#include "libipc/mem/new.h"
 
 namespace ipc {
 namespace shm {
+namespace {
+
+/* A mapping shared by the handles of this process with the same name. */
+struct mapping_t {
+    shm::id_t    id_;
+    void*        mem_;
+    std::size_t  size_;
+    std::int32_t refs_;   // handles of this process
+    bool         cached_; // still could be found by name
+};
+
+/**
+ * \brief The process-wide mapping cache.
+ * \remarks Handles opening the same name share one mapping,
+ *          so the reference count of the segment only counts each process once.
+*/
+class mapping_cache {
+    std::mutex lock_;
+    ipc::unordered_map<std::string, mapping_t *> maps_;
+
+public:
+    static mapping_cache &instance() {
+        static auto *cache = new mapping_cache; // no delete
+        return *cache;
+    }
+
+    std::mutex &lock() noexcept { return lock_; }
+
+    mapping_t *find(std::string const &name) {
+        auto it = maps_.find(name);
+        return (it == maps_.end()) ? nullptr : it->second;
+    }
+
+    mapping_t *insert(std::string const &name, shm::id_t id, void *mem, std::size_t size) {
+        if (find(name) != nullptr) return nullptr;
+        auto *m = mem::$new<mapping_t>(mapping_t{id, mem, size, 1, true});
+        maps_.emplace(name, m);
+        return m;
+    }
+
+    void evict(std::string const &name) {
+        auto it = maps_.find(name);
+        if (it == maps_.end()) return;
+        it->second->cached_ = false;
+        maps_.erase(it);
+    }
+
+    /* Returns the id of the mapping if this is the last handle of it. */
+    shm::id_t remove_ref(std::string const &name, mapping_t *m) {
+        if (--(m->refs_) > 0) return nullptr;
+        if (m->cached_) maps_.erase(name);
+        auto id = m->id_;
+        mem::$delete(m);
+        return id;
+    }
+};
+
+} // namespace
 
 class handle::handle_ : public pimpl<handle_> {
 public:
-    shm::id_t id_ = nullptr;
-    void*     m_  = nullptr;
+    shm::id_t  id_  = nullptr;
+    void*      m_   = nullptr;
+    mapping_t* map_ = nullptr; // null if the mapping is not shared through the cache
 
     std::string n_;
     std::size_t s_ = 0;
+
+    void reset() noexcept {
+        id_  = nullptr;
+        m_   = nullptr;
+        map_ = nullptr;
+        s_   = 0;
+        n_.clear();
+    }
 };
 
 handle::handle()
@@ -61,7 +130,11 @@ char const * handle::name() const noexcept {
 }
 
 std::int32_t handle::ref() const noexcept {
-    return shm::get_ref(impl(p_)->id_);
+    // The other handles of this process count as they would have their own mappings.
+    auto &cache = mapping_cache::instance();
+    LIBIPC_UNUSED std::lock_guard<std::mutex> guard {cache.lock()};
+    auto *m = impl(p_)->map_;
+    return shm::get_ref(impl(p_)->id_) + ((m == nullptr) ? 0 : (m->refs_ - 1));
 }
 
 void handle::sub_ref() noexcept {
@@ -79,6 +152,30 @@ bool handle::acquire(char const * name, std::size_t size, unsigned mode) {
         return false;
     }
     release();
+    auto &cache = mapping_cache::instance();
+    LIBIPC_UNUSED std::lock_guard<std::mutex> guard {cache.lock()};
+    auto *m = cache.find(name);
+    if ((m != nullptr) && !shm::is_current(m->id_)) {
+        // The name has been removed, and maybe created again, the handles holding the old one keep it.
+        cache.evict(name);
+        m = nullptr;
+    }
+    if (m != nullptr) {
+        if (mode == create) {
+            // It exists already.
+            return false;
+        }
+        if ((mode == open) || (size <= m->size_)) {
+            ++(m->refs_);
+            impl(p_)->id_  = m->id_;
+            impl(p_)->m_   = m->mem_;
+            impl(p_)->map_ = m;
+            impl(p_)->n_   = name;
+            impl(p_)->s_   = m->size_;
+            return true;
+        }
+        // The size doesn't match, bypass the cache.
+    }
     const auto id = shm::acquire(name, size, mode);
     if (!id) {
         return false;
@@ -86,23 +183,66 @@ bool handle::acquire(char const * name, std::size_t size, unsigned mode) {
     impl(p_)->id_ = id;
     impl(p_)->n_  = name;
     impl(p_)->m_  = shm::get_mem(impl(p_)->id_, &(impl(p_)->s_));
+    if (valid()) {
+        impl(p_)->map_ = cache.insert(impl(p_)->n_, impl(p_)->id_, impl(p_)->m_, impl(p_)->s_);
+    }
     return valid();
 }
 
 std::int32_t handle::release() {
     if (impl(p_)->id_ == nullptr) return -1;
+    auto *m = impl(p_)->map_;
+    if (m != nullptr) {
+        auto &cache = mapping_cache::instance();
+        std::unique_lock<std::mutex> guard {cache.lock()};
+        auto id = cache.remove_ref(impl(p_)->n_, m);
+        if (id == nullptr) {
+            // Other handles of this process are still using the mapping.
+            auto ret = shm::get_ref(impl(p_)->id_) + m->refs_;
+            impl(p_)->reset();
+            return ret;
+        }
+        impl(p_)->reset();
+        return shm::release(id);
+    }
     return shm::release(detach());
 }
 
 void handle::clear() noexcept {
     if (impl(p_)->id_ == nullptr) return;
-    shm::remove(detach());
+    auto *m = impl(p_)->map_;
+    if (m == nullptr) {
+        // The id is of its own.
+        shm::remove(detach());
+        return;
+    }
+    auto name = std::move(impl(p_)->n_);
+    shm::id_t id;
+    {
+        auto &cache = mapping_cache::instance();
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {cache.lock()};
+        cache.evict(name);
+        id = cache.remove_ref(name, m);
+    }
+    impl(p_)->reset();
+    if (id != nullptr) {
+        // the last handle of the mapping in this process
+        shm::remove(id);
+    } else {
+        // the other handles keep the mapping until they release it
+        shm::remove(name.c_str());
+    }
 }
 
 void handle::clear_storage(char const * name) noexcept {
     if (name == nullptr) {
         return;
     }
+    {
+        auto &cache = mapping_cache::instance();
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {cache.lock()};
+        cache.evict(name);
+    }
     shm::remove(name);
 }
 
@@ -119,10 +259,20 @@ void handle::attach(id_t id) {
 
 id_t handle::detach() {
     auto old = impl(p_)->id_;
-    impl(p_)->id_ = nullptr;
-    impl(p_)->m_  = nullptr;
-    impl(p_)->s_  = 0;
-    impl(p_)->n_.clear();
+    auto *m  = impl(p_)->map_;
+    if (m != nullptr) {
+        auto &cache = mapping_cache::instance();
+        LIBIPC_UNUSED std::lock_guard<std::mutex> guard {cache.lock()};
+        if (cache.remove_ref(impl(p_)->n_, m) == nullptr) {
+            // The mapping is shared with other handles, hand out a mapping of its own.
+            old = shm::acquire(impl(p_)->n_.c_str(), impl(p_)->s_, shm::open);
+            if ((old != nullptr) && (shm::get_mem(old, nullptr) == nullptr)) {
+                shm::release(old);
+                old = nullptr;
+            }
+        }
+    }
+    impl(p_)->reset();
     return old;
 }
 
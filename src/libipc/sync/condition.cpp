@@ -58,6 +58,14 @@ bool condition::open(char const *name) noexcept {
     return impl(p_)->cond_.open(name);
 }
 
+bool condition::open(void *mem, std::size_t size, bool init) noexcept {
+    return impl(p_)->cond_.open(mem, size, init);
+}
+
+std::size_t condition::storage_size() noexcept {
+    return ipc::detail::sync::condition::storage_size();
+}
+
 void condition::close() noexcept {
     impl(p_)->cond_.close();
 }
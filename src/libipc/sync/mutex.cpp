@@ -58,6 +58,14 @@ bool mutex::open(char const *name) noexcept {
     return impl(p_)->lock_.open(name);
 }
 
+bool mutex::open(void *mem, std::size_t size, bool init) noexcept {
+    return impl(p_)->lock_.open(mem, size, init);
+}
+
+std::size_t mutex::storage_size() noexcept {
+    return ipc::detail::sync::mutex::storage_size();
+}
+
 void mutex::close() noexcept {
     impl(p_)->lock_.close();
 }
@@ -73,6 +73,14 @@ public:
         return cursor_ == max_count;
     }
 
+    /* The ids not acquired yet, it may be inexact while someone else is acquiring or releasing. */
+    std::size_t free_count() const {
+        if (!prepared_) return max_count;
+        std::size_t n = 0;
+        for (std::size_t id = cursor_; (id < max_count) && (n < max_count); id = next_[id]) ++n;
+        return n;
+    }
+
     storage_id_t acquire() {
         if (empty()) return -1;
         storage_id_t id = cursor_;
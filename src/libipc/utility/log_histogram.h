@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ipc {
+
+/**
+ * \brief A histogram with log-scaled buckets, in the manner of HdrHistogram.
+ * \remarks Values below 'sub_count' have a bucket each, then every power of 2 is split into
+ *          'sub_count' buckets, so a bucket is at most 1/16 as wide as its values.
+ *          Zero-filled memory is an empty histogram, so it can be placed in shared memory,
+ *          and any number of processes may record into it.
+*/
+class log_histogram {
+public:
+    enum : std::size_t {
+        sub_bits     = 4,
+        sub_count    = std::size_t(1) << sub_bits,
+        max_bits     = 40, // values from 2^max_bits on go to the last bucket
+        bucket_count = (max_bits - sub_bits + 1) * sub_count
+    };
+
+private:
+    std::atomic<std::uint64_t> buckets_[bucket_count];
+
+    static unsigned msb(std::uint64_t v) noexcept {
+#if defined(__GNUC__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(v));
+#else
+        unsigned n = 0;
+        while (v >>= 1) ++n;
+        return n;
+#endif
+    }
+
+public:
+    static std::size_t index_of(std::uint64_t v) noexcept {
+        if (v < sub_count) return static_cast<std::size_t>(v);
+        unsigned e = msb(v);
+        if (e >= max_bits) return bucket_count - 1;
+        return (e - sub_bits + 1) * sub_count + static_cast<std::size_t>((v >> (e - sub_bits)) & (sub_count - 1));
+    }
+
+    /* The highest value of the bucket. */
+    static std::uint64_t highest_of(std::size_t i) noexcept {
+        if (i < sub_count) return i;
+        unsigned shift = static_cast<unsigned>(i / sub_count) - 1;
+        std::uint64_t low = static_cast<std::uint64_t>(sub_count + (i % sub_count)) << shift;
+        return low + (std::uint64_t(1) << shift) - 1;
+    }
+
+    std::uint64_t count(std::size_t i) const noexcept {
+        return buckets_[i].load(std::memory_order_relaxed);
+    }
+
+    void record(std::uint64_t v) noexcept {
+        buckets_[index_of(v)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /* Only safe while nobody is recording. */
+    void reset() noexcept {
+        for (auto &b : buckets_) b.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Gets the values at the quantiles 'qs' (0 ~ 1, ascending).
+     * \return The number of the recorded values, 'values' is untouched if it is 0.
+    */
+    std::uint64_t quantiles(double const *qs, std::uint64_t *values, std::size_t n) const noexcept {
+        std::uint64_t counts[bucket_count];
+        std::uint64_t total = 0;
+        for (std::size_t i = 0; i < bucket_count; ++i) {
+            total += (counts[i] = buckets_[i].load(std::memory_order_relaxed));
+        }
+        if (total == 0) return 0;
+        std::size_t i = 0;
+        std::uint64_t seen = counts[0];
+        for (std::size_t k = 0; k < n; ++k) {
+            // the nearest rank, ceil(q * total)
+            double r  = qs[k] * static_cast<double>(total);
+            auto rank = static_cast<std::uint64_t>(r);
+            if ((static_cast<double>(rank) < r) || (rank < 1)) ++rank;
+            if (rank > total) rank = total;
+            while (seen < rank) seen += counts[++i];
+            values[k] = highest_of(i);
+        }
+        return total;
+    }
+};
+
+} // namespace ipc
@@ -2,6 +2,8 @@
 
 #include <utility>      // std::forward, std::integer_sequence
 #include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint64_t
+#include <chrono>       // std::chrono::steady_clock
 #include <new>          // std::hardware_destructive_interference_size
 #include <type_traits>  // std::is_trivially_copyable
 
@@ -49,4 +51,10 @@ IPC_CONSTEXPR_ std::size_t make_align(std::size_t align, std::size_t size) {
     return (size + align - 1) & ~(align - 1);
 }
 
+// Nanoseconds of the monotonic clock, comparable between the processes of a machine.
+inline std::uint64_t steady_now() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
 } // namespace ipc
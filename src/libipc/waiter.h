@@ -4,11 +4,13 @@
 #include <string>
 #include <mutex>
 #include <atomic>
+#include <cstddef>
 
 #include "libipc/def.h"
 #include "libipc/mutex.h"
 #include "libipc/condition.h"
 #include "libipc/platform/detail.h"
+#include "libipc/utility/utility.h"
 
 namespace ipc {
 namespace detail {
@@ -18,6 +20,10 @@ class waiter {
     ipc::sync::mutex     lock_;
     std::atomic<bool>    quit_ {false};
 
+    static std::size_t cond_size() noexcept {
+        return ipc::make_align(alignof(std::max_align_t), ipc::sync::condition::storage_size());
+    }
+
 public:
     static void init();
 
@@ -46,6 +52,27 @@ public:
         return valid();
     }
 
+    /**
+     * \brief Opens the waiter on caller-provided shared memory of 'storage_size()' bytes.
+     * \param init true for the only opener which initializes the memory.
+    */
+    bool open(void *mem, bool init) noexcept {
+        quit_.store(false, std::memory_order_relaxed);
+        auto *p = static_cast<ipc::byte_t *>(mem);
+        if (!cond_.open(p, cond_size(), init)) {
+            return false;
+        }
+        if (!lock_.open(p + cond_size(), storage_size() - cond_size(), init)) {
+            cond_.close();
+            return false;
+        }
+        return valid();
+    }
+
+    static std::size_t storage_size() noexcept {
+        return cond_size() + ipc::make_align(alignof(std::max_align_t), ipc::sync::mutex::storage_size());
+    }
+
     void close() noexcept {
         cond_.close();
         lock_.close();
@@ -0,0 +1,179 @@
+#include "../archive/test.h"
+
+#include <vector>
+#include <thread>
+#include <memory>
+#include <cstdint>
+
+#include "libipc/queue.h"
+#include "libipc/policy.h"
+
+namespace {
+
+using channel_flag_t = ipc::wr<ipc::relat::multi, ipc::relat::multi, ipc::trans::broadcast>;
+
+struct frag_t {
+  std::uint32_t msg_;
+  std::uint32_t idx_;
+  std::uint32_t cnt_;
+
+  frag_t() = default;
+  frag_t(std::uint32_t msg, std::uint32_t idx, std::uint32_t cnt)
+    : msg_(msg), idx_(idx), cnt_(cnt) {}
+};
+
+using policy_t = ipc::policy::choose<ipc::circ::elem_array, channel_flag_t>;
+using queue_t  = ipc::queue<frag_t, policy_t>;
+using elems_t  = queue_t::elems_t;
+
+bool push_frags(queue_t &que, std::uint32_t msg, std::uint32_t cnt) {
+  return que.push_n(cnt, [msg, cnt](std::size_t i, void *p) {
+    ::new (p) frag_t {msg, static_cast<std::uint32_t>(i), cnt};
+  });
+}
+
+bool push_one(queue_t &que, std::uint32_t msg) {
+  return que.push([](void *) { return true; }, msg, 0u, 1u);
+}
+
+} // namespace
+
+TEST(prod_cons, push_n) {
+  std::unique_ptr<elems_t> el {new elems_t};
+  queue_t sender {el.get()}, reader {el.get()};
+  EXPECT_FALSE(push_frags(sender, 1, 3)); // no reader
+  ASSERT_TRUE(reader.connect());
+  ASSERT_TRUE(push_frags(sender, 1, 3));
+  ASSERT_TRUE(push_one(sender, 2));
+  frag_t f {};
+  for (std::uint32_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(reader.pop(f));
+    EXPECT_EQ(f.msg_, 1u);
+    EXPECT_EQ(f.idx_, i);
+  }
+  ASSERT_TRUE(reader.pop(f));
+  EXPECT_EQ(f.msg_, 2u);
+  EXPECT_FALSE(reader.pop(f));
+  EXPECT_FALSE(push_frags(sender, 3, 0));
+  EXPECT_FALSE(push_frags(sender, 3, elems_t::elem_max + 1));
+}
+
+TEST(prod_cons, push_n_full) {
+  std::unique_ptr<elems_t> el {new elems_t};
+  queue_t sender {el.get()}, reader {el.get()};
+  ASSERT_TRUE(reader.connect());
+  std::uint32_t n = 0;
+  while (push_one(sender, n)) ++n;
+  ASSERT_GT(n, 3u);
+  frag_t f {};
+  for (int i = 0; i < 3; ++i) ASSERT_TRUE(reader.pop(f));
+  // Nothing is claimed if the elements are not all available.
+  EXPECT_FALSE(push_frags(sender, 100, 4));
+  ASSERT_TRUE(push_frags(sender, 100, 3));
+  for (std::uint32_t i = 3; i < n; ++i) {
+    ASSERT_TRUE(reader.pop(f));
+    EXPECT_EQ(f.msg_, i);
+  }
+  for (std::uint32_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(reader.pop(f));
+    EXPECT_EQ(f.msg_, 100u);
+    EXPECT_EQ(f.idx_, i);
+  }
+  EXPECT_FALSE(reader.pop(f));
+  EXPECT_TRUE(push_one(sender, 0));
+}
+
+TEST(prod_cons, push_n_contiguous) {
+  constexpr std::uint32_t producers = 4;
+  constexpr std::uint32_t loops     = 5000;
+  std::unique_ptr<elems_t> el {new elems_t};
+  queue_t reader {el.get()};
+  ASSERT_TRUE(reader.connect());
+
+  std::vector<std::thread> threads;
+  for (std::uint32_t p = 0; p < producers; ++p) {
+    threads.emplace_back([&el, p] {
+      queue_t que {el.get()};
+      for (std::uint32_t i = 0; i < loops;) {
+        if (push_frags(que, p * loops + i, 1 + (i % 8))) ++i;
+        else std::this_thread::yield();
+      }
+    });
+  }
+  std::uint32_t next[producers] {};
+  for (std::uint32_t n = 0; n < producers * loops;) {
+    frag_t f {};
+    if (!reader.pop(f)) {
+      std::this_thread::yield();
+      continue;
+    }
+    // The fragments of a message must not be interleaved with others.
+    ASSERT_EQ(f.idx_, 0u);
+    std::uint32_t p = f.msg_ / loops, i = f.msg_ % loops;
+    ASSERT_LT(p, producers);
+    ASSERT_EQ(i, next[p]++);
+    ASSERT_EQ(f.cnt_, 1 + (i % 8));
+    for (std::uint32_t k = 1; k < f.cnt_;) {
+      frag_t g {};
+      if (!reader.pop(g)) {
+        std::this_thread::yield();
+        continue;
+      }
+      ASSERT_EQ(g.msg_, f.msg_);
+      ASSERT_EQ(g.idx_, k++);
+    }
+    ++n;
+  }
+  for (auto &t : threads) t.join();
+}
+
+TEST(prod_cons, force_push_n) {
+  std::unique_ptr<elems_t> el {new elems_t};
+  queue_t sender {el.get()}, slow {el.get()}, reader {el.get()};
+  ASSERT_TRUE(slow.connect());
+  ASSERT_TRUE(reader.connect());
+  std::uint32_t n = 0;
+  while (push_one(sender, n)) ++n;
+  frag_t f {};
+  for (std::uint32_t i = 0; i < n; ++i) ASSERT_TRUE(reader.pop(f));
+  EXPECT_FALSE(push_frags(sender, 100, 3));
+  // The slow receiver holding the elements is disconnected.
+  ASSERT_TRUE(sender.force_push_n(3, [](std::size_t i, void *p) {
+    ::new (p) frag_t {100, static_cast<std::uint32_t>(i), 3};
+  }));
+  EXPECT_FALSE(slow.connected());
+  for (std::uint32_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(reader.pop(f));
+    EXPECT_EQ(f.msg_, 100u);
+    EXPECT_EQ(f.idx_, i);
+  }
+  EXPECT_FALSE(reader.pop(f));
+}
+
+TEST(prod_cons, force_push_n_overwriting) {
+  std::unique_ptr<elems_t> el {new elems_t};
+  queue_t sender {el.get()}, reader {el.get()};
+  ASSERT_TRUE(reader.connect());
+  sender.overwrite(true);
+  std::uint32_t n = 0;
+  while (push_one(sender, n)) ++n;
+  ASSERT_TRUE(sender.force_push_n(3, [](std::size_t i, void *p) {
+    ::new (p) frag_t {100, static_cast<std::uint32_t>(i), 3};
+  }));
+  EXPECT_TRUE(reader.connected());
+  // The 3 oldest messages are lost, the fragments follow the others.
+  frag_t f {};
+  for (std::uint32_t i = 3; i < n; ++i) {
+    ASSERT_TRUE(reader.pop(f));
+    EXPECT_EQ(f.msg_, i);
+  }
+  for (std::uint32_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(reader.pop(f));
+    EXPECT_EQ(f.msg_, 100u);
+    EXPECT_EQ(f.idx_, i);
+  }
+  EXPECT_FALSE(reader.pop(f));
+  std::uint64_t dropped = 0, overwritten = 0;
+  reader.losses(dropped, overwritten);
+  EXPECT_EQ(overwritten, 3u);
+}
@@ -0,0 +1,213 @@
+#include "../archive/test.h"
+
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+
+#include "libipc/queue.h"
+#include "libipc/circ/record_array.h"
+
+namespace {
+
+using route_flag_t   = ipc::wr<ipc::relat::single, ipc::relat::multi, ipc::trans::broadcast>;
+using channel_flag_t = ipc::wr<ipc::relat::multi , ipc::relat::multi, ipc::trans::broadcast>;
+using unicast_flag_t = ipc::wr<ipc::relat::single, ipc::relat::single, ipc::trans::unicast>;
+
+template <typename Flag, std::size_t RingSize = 4096>
+using queue_t = ipc::record_queue<Flag, RingSize>;
+
+template <typename Flag, std::size_t RingSize = 4096>
+using elems_t = ipc::circ::record_array<Flag, RingSize>;
+
+std::vector<std::uint8_t> make_record(std::size_t size, std::uint8_t seed) {
+  std::vector<std::uint8_t> v(size);
+  for (std::size_t i = 0; i < size; ++i) v[i] = static_cast<std::uint8_t>(seed + i);
+  return v;
+}
+
+template <typename Q>
+bool pop_record(Q &que, std::vector<std::uint8_t> &out) {
+  return que.pop([&out](void const *p, std::size_t size) {
+    auto b = static_cast<std::uint8_t const *>(p);
+    out.assign(b, b + size);
+  });
+}
+
+} // namespace
+
+TEST(record_array, layout) {
+  using ra_t = elems_t<route_flag_t>;
+  EXPECT_EQ(ra_t::ring_size, 4096u);
+  EXPECT_EQ(ra_t::max_payload, 4096u / 2 - ra_t::head_size);
+  EXPECT_EQ(ra_t::conn_max, 32u);
+  EXPECT_EQ(elems_t<unicast_flag_t>::conn_max, 1u);
+}
+
+TEST(record_array, push_pop) {
+  std::unique_ptr<elems_t<route_flag_t>> ra {new elems_t<route_flag_t>};
+  queue_t<route_flag_t> que {ra.get()};
+  EXPECT_FALSE(que.push("x", 1)); // no reader
+  ASSERT_TRUE(que.connect());
+  ASSERT_TRUE(que.empty());
+
+  auto rec = make_record(1000, 7);
+  ASSERT_TRUE(que.push(rec.data(), rec.size()));
+  EXPECT_FALSE(que.empty());
+
+  std::vector<std::uint8_t> out;
+  ASSERT_TRUE(pop_record(que, out));
+  EXPECT_EQ(out, rec);
+  EXPECT_FALSE(pop_record(que, out));
+  EXPECT_TRUE(que.empty());
+}
+
+TEST(record_array, max_payload) {
+  using ra_t = elems_t<route_flag_t>;
+  std::unique_ptr<ra_t> ra {new ra_t};
+  queue_t<route_flag_t> que {ra.get()};
+  ASSERT_TRUE(que.connect());
+  std::vector<std::uint8_t> big(ra_t::max_payload + 1);
+  EXPECT_FALSE(que.push(big.data(), big.size()));
+  EXPECT_TRUE (que.push(big.data(), big.size() - 1));
+  EXPECT_TRUE (que.push(nullptr, 0));
+}
+
+TEST(record_array, wrap_with_padding) {
+  std::unique_ptr<elems_t<route_flag_t>> ra {new elems_t<route_flag_t>};
+  queue_t<route_flag_t> que {ra.get()};
+  ASSERT_TRUE(que.connect());
+  // Odd sizes make records straddle the end of the ring, forcing padding records.
+  for (int i = 0; i < 200; ++i) {
+    auto rec = make_record(static_cast<std::size_t>(37 + (i * 113) % 1500), static_cast<std::uint8_t>(i));
+    ASSERT_TRUE(que.push(rec.data(), rec.size())) << i;
+    std::vector<std::uint8_t> out;
+    ASSERT_TRUE(pop_record(que, out)) << i;
+    ASSERT_EQ(out, rec) << i;
+  }
+}
+
+TEST(record_array, full) {
+  std::unique_ptr<elems_t<route_flag_t>> ra {new elems_t<route_flag_t>};
+  queue_t<route_flag_t> que {ra.get()};
+  ASSERT_TRUE(que.connect());
+  auto rec = make_record(100, 1);
+  int n = 0;
+  while (que.push(rec.data(), rec.size())) ++n;
+  EXPECT_GT(n, 0);
+  EXPECT_LE(n * 100, 4096);
+  std::vector<std::uint8_t> out;
+  ASSERT_TRUE(pop_record(que, out));
+  EXPECT_TRUE(que.push(rec.data(), rec.size()));
+  for (int i = 0; i < n; ++i) {
+    ASSERT_TRUE(pop_record(que, out));
+    EXPECT_EQ(out, rec);
+  }
+  EXPECT_FALSE(pop_record(que, out));
+}
+
+TEST(record_array, broadcast) {
+  std::unique_ptr<elems_t<route_flag_t>> ra {new elems_t<route_flag_t>};
+  queue_t<route_flag_t> sender {ra.get()}, r1 {ra.get()}, r2 {ra.get()};
+  ASSERT_TRUE(r1.connect());
+  ASSERT_TRUE(r2.connect());
+  EXPECT_EQ(sender.conn_count(), 2u);
+  for (int i = 0; i < 10; ++i) {
+    auto rec = make_record(static_cast<std::size_t>(i * 10 + 1), static_cast<std::uint8_t>(i));
+    ASSERT_TRUE(sender.push(rec.data(), rec.size()));
+  }
+  for (auto *r : {&r1, &r2}) {
+    for (int i = 0; i < 10; ++i) {
+      std::vector<std::uint8_t> out;
+      ASSERT_TRUE(pop_record(*r, out));
+      EXPECT_EQ(out, make_record(static_cast<std::size_t>(i * 10 + 1), static_cast<std::uint8_t>(i)));
+    }
+  }
+  // A slow reader holds back the sender until it catches up.
+  r1.disconnect();
+  auto rec = make_record(500, 3);
+  while (sender.push(rec.data(), rec.size())) ;
+  std::vector<std::uint8_t> out;
+  ASSERT_TRUE(pop_record(r2, out));
+  EXPECT_TRUE(sender.push(rec.data(), rec.size()));
+}
+
+TEST(record_array, reader_set_up_before_published) {
+  ipc::circ::conn_head<route_flag_t> head;
+  ipc::circ::cc_t seen = ~0u;
+  auto cc_id = head.connect([&head, &seen](ipc::circ::cc_t id) {
+    seen = head.connections() & id;
+  });
+  EXPECT_NE(cc_id, 0u);
+  EXPECT_EQ(seen, 0u); // the senders don't see it yet
+  EXPECT_EQ(head.connections(), cc_id);
+}
+
+TEST(record_array, unicast) {
+  std::unique_ptr<elems_t<unicast_flag_t>> ra {new elems_t<unicast_flag_t>};
+  queue_t<unicast_flag_t> sender {ra.get()}, reader {ra.get()}, other {ra.get()};
+  ASSERT_TRUE(sender.ready_sending());
+  ASSERT_TRUE(sender.push("hello", 6)); // buffered without reader
+  ASSERT_TRUE(reader.connect());
+  EXPECT_FALSE(other.connect()); // single consumer
+  std::vector<std::uint8_t> out;
+  ASSERT_TRUE(pop_record(reader, out));
+  EXPECT_STREQ(reinterpret_cast<char const *>(out.data()), "hello");
+  reader.disconnect();
+  ASSERT_TRUE(other.connect());
+  EXPECT_FALSE(pop_record(other, out));
+}
+
+TEST(record_array, multi_producer) {
+  constexpr int producers = 4;
+  constexpr int loops     = 5000;
+  std::unique_ptr<elems_t<channel_flag_t, 16384>> ra {new elems_t<channel_flag_t, 16384>};
+  queue_t<channel_flag_t, 16384> reader {ra.get()};
+  ASSERT_TRUE(reader.connect());
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&ra, p] {
+      queue_t<channel_flag_t, 16384> que {ra.get()};
+      for (std::uint32_t i = 0; i < loops;) {
+        std::uint32_t rec[16] {static_cast<std::uint32_t>(p), i};
+        if (que.push(rec, sizeof(std::uint32_t) * (2 + i % 14))) ++i;
+        else std::this_thread::yield();
+      }
+    });
+  }
+  std::uint32_t next[producers] {};
+  for (int n = 0; n < producers * loops;) {
+    std::vector<std::uint8_t> out;
+    if (!pop_record(reader, out)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_GE(out.size(), sizeof(std::uint32_t) * 2);
+    std::uint32_t p, i;
+    std::memcpy(&p, out.data(), sizeof(p));
+    std::memcpy(&i, out.data() + sizeof(p), sizeof(i));
+    ASSERT_LT(p, static_cast<std::uint32_t>(producers));
+    ASSERT_EQ(out.size(), sizeof(std::uint32_t) * (2 + i % 14));
+    ASSERT_EQ(i, next[p]++);
+    ++n;
+  }
+  for (auto &t : threads) t.join();
+}
+
+TEST(record_array, shm) {
+  char const *name = "test-record-array-shm";
+  queue_t<route_flag_t>::clear_storage(name);
+  queue_t<route_flag_t> sender {name}, reader {name};
+  ASSERT_TRUE(sender.valid());
+  ASSERT_TRUE(reader.valid());
+  ASSERT_TRUE(reader.connect());
+  ASSERT_TRUE(sender.ready_sending());
+  auto rec = make_record(1234, 9);
+  ASSERT_TRUE(sender.push(rec.data(), rec.size()));
+  std::vector<std::uint8_t> out;
+  ASSERT_TRUE(pop_record(reader, out));
+  EXPECT_EQ(out, rec);
+  reader.disconnect();
+  sender.clear();
+}
@@ -0,0 +1,81 @@
+
+#include "../archive/test.h"
+
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "libipc/mem/offset_ptr.h"
+
+namespace {
+
+struct base_t { int a; };
+struct derived_t : base_t { int b; };
+
+} // namespace
+
+TEST(offset_ptr, construct) {
+  ipc::mem::offset_ptr<int> p1;
+  EXPECT_FALSE(p1);
+  EXPECT_EQ(p1.get(), nullptr);
+  EXPECT_TRUE(p1 == nullptr);
+
+  int i = 123;
+  ipc::mem::offset_ptr<int> p2 {&i};
+  EXPECT_TRUE(p2);
+  EXPECT_EQ(p2.get(), &i);
+  EXPECT_EQ(*p2, 123);
+
+  ipc::mem::offset_ptr<int> p3 {p2};
+  EXPECT_EQ(p3.get(), &i);
+  p3 = nullptr;
+  EXPECT_EQ(p3.get(), nullptr);
+  p3 = p2;
+  EXPECT_EQ(p3, p2);
+
+  derived_t d {};
+  ipc::mem::offset_ptr<derived_t> pd {&d};
+  ipc::mem::offset_ptr<base_t> pb {pd};
+  EXPECT_EQ(pb.get(), static_cast<base_t *>(&d));
+  ipc::mem::offset_ptr<void> pv {pd};
+  EXPECT_EQ(static_cast<ipc::mem::offset_ptr<derived_t>>(pv).get(), &d);
+}
+
+TEST(offset_ptr, arithmetic) {
+  int arr[4] {1, 2, 3, 4};
+  ipc::mem::offset_ptr<int> p {arr};
+  EXPECT_EQ(p[2], 3);
+  EXPECT_EQ(*(p + 1), 2);
+  ++p;
+  EXPECT_EQ(*p, 2);
+  p += 2;
+  EXPECT_EQ(*p, 4);
+  EXPECT_EQ(p - ipc::mem::offset_ptr<int>{arr}, 3);
+  EXPECT_TRUE(ipc::mem::offset_ptr<int>{arr} < p);
+  EXPECT_EQ((p--).get(), arr + 3);
+  EXPECT_EQ(p.get(), arr + 2);
+}
+
+TEST(offset_ptr, relocatable) {
+  // An offset_ptr pointing into the same block stays valid after the block is moved.
+  struct node_t {
+    int value;
+    ipc::mem::offset_ptr<int> ptr;
+  };
+  alignas(node_t) unsigned char buf1[sizeof(node_t)];
+  alignas(node_t) unsigned char buf2[sizeof(node_t)];
+  auto *n1 = ::new (buf1) node_t{42, nullptr};
+  n1->ptr = &n1->value;
+  std::memcpy(buf2, buf1, sizeof(node_t));
+  auto *n2 = reinterpret_cast<node_t *>(buf2);
+  EXPECT_EQ(n2->ptr.get(), &n2->value);
+  EXPECT_EQ(*n2->ptr, 42);
+}
+
+TEST(offset_ptr, pointer_traits) {
+  using ptr_t = ipc::mem::offset_ptr<int>;
+  EXPECT_TRUE((std::is_same<std::pointer_traits<ptr_t>::element_type, int>::value));
+  EXPECT_TRUE((std::is_same<std::pointer_traits<ptr_t>::rebind<char>, ipc::mem::offset_ptr<char>>::value));
+  int i = 0;
+  EXPECT_EQ(std::pointer_traits<ptr_t>::pointer_to(i).get(), &i);
+}
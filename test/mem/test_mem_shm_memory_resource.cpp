@@ -0,0 +1,197 @@
+
+#include "../archive/test.h"
+
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+#include <string>
+
+#include "libipc/shm.h"
+#include "libipc/mem/shm_memory_resource.h"
+#include "libipc/mem/shm_allocator.h"
+
+namespace {
+
+std::string unique_name(char const *prefix) {
+  static int counter = 0;
+  return std::string(prefix) + "_shm_mr_" + std::to_string(++counter);
+}
+
+/// \brief Maps the segment again, so the heap is seen at another address.
+struct second_mapping {
+  ipc::shm::id_t id_;
+  void *mem_;
+  std::size_t size_;
+
+  explicit second_mapping(char const *name)
+    : id_(ipc::shm::acquire(name, 0, ipc::shm::open)), mem_(nullptr), size_(0) {
+    if (id_ != nullptr) mem_ = ipc::shm::get_mem(id_, &size_);
+  }
+
+  ~second_mapping() {
+    if (id_ != nullptr) ipc::shm::release(id_);
+  }
+};
+
+} // namespace
+
+TEST(shm_memory_resource, construct) {
+  ipc::mem::shm_memory_resource invalid;
+  EXPECT_FALSE(invalid.valid());
+  EXPECT_EQ(invalid.allocate(8), nullptr);
+
+  auto name = unique_name("construct");
+  ipc::mem::shm_memory_resource mr {name.c_str(), 64 * 1024};
+  ASSERT_TRUE(mr.valid());
+  EXPECT_EQ(mr.heap()->size(), 64 * 1024);
+  EXPECT_EQ(mr.heap()->root(), nullptr);
+  mr.clear();
+  EXPECT_FALSE(mr.valid());
+
+  // Too small to hold the heap.
+  EXPECT_FALSE(ipc::mem::shm_memory_resource(unique_name("small").c_str(), 16).valid());
+}
+
+TEST(shm_memory_resource, allocate) {
+  auto name = unique_name("allocate");
+  ipc::mem::shm_memory_resource mr {name.c_str(), 64 * 1024};
+  ASSERT_TRUE(mr.valid());
+
+  EXPECT_EQ(mr.allocate(0), nullptr);
+  EXPECT_EQ(mr.allocate(8, 3), nullptr);
+  EXPECT_EQ(mr.allocate(8, 8192), nullptr);
+  EXPECT_EQ(mr.allocate(2 * 1024 * 1024), nullptr);
+
+  for (std::size_t align : {1, 2, 8, 16, 64, 256, 4096}) {
+    void *p = mr.allocate(24, align);
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(reinterpret_cast<std::size_t>(p) % align, 0u);
+    mr.deallocate(p, 24, align);
+  }
+
+  // A freed block is reused by the same size class.
+  void *p1 = mr.allocate(100);
+  ASSERT_NE(p1, nullptr);
+  std::memset(p1, 0xcc, 100);
+  mr.deallocate(p1, 100);
+  EXPECT_EQ(mr.allocate(120), p1);
+
+  // The segment is exhausted eventually.
+  std::size_t count = 0;
+  while (mr.allocate(1024) != nullptr) ++count;
+  EXPECT_GT(count, 0u);
+  EXPECT_LT(count, 64u);
+  EXPECT_LE(mr.heap()->used(), mr.heap()->size());
+  mr.clear();
+}
+
+TEST(shm_memory_resource, large_block) {
+  auto name = unique_name("large");
+  ipc::mem::shm_memory_resource mr {name.c_str(), 8 * 1024 * 1024};
+  ASSERT_TRUE(mr.valid());
+
+  // Larger than 1 MB, cut from the tail like any other block.
+  void *p = mr.allocate(3 * 1024 * 1024);
+  ASSERT_NE(p, nullptr);
+  std::memset(p, 0xcc, 3 * 1024 * 1024);
+  EXPECT_EQ(mr.allocate(4 * 1024 * 1024), nullptr);
+  mr.deallocate(p, 3 * 1024 * 1024);
+  EXPECT_EQ(mr.allocate(4 * 1024 * 1024), p);
+
+  // The containers see an exhausted heap as std::bad_alloc, rather than a null pointer.
+  using vector_t = std::vector<char, ipc::mem::shm_allocator<char>>;
+  vector_t vec {ipc::mem::shm_allocator<char>{mr}};
+  EXPECT_THROW(vec.reserve(8 * 1024 * 1024), std::bad_alloc);
+  EXPECT_TRUE(vec.empty());
+  mr.clear();
+}
+
+TEST(shm_memory_resource, root) {
+  auto name = unique_name("root");
+  ipc::mem::shm_memory_resource mr {name.c_str(), 64 * 1024};
+  ASSERT_TRUE(mr.valid());
+  void *p = mr.allocate(64);
+  EXPECT_FALSE(mr.heap()->set_root(nullptr));
+  EXPECT_TRUE(mr.heap()->set_root(p));
+  EXPECT_FALSE(mr.heap()->set_root(p));
+  EXPECT_EQ(mr.heap()->root(), p);
+
+  {
+    second_mapping other {name.c_str()};
+    ASSERT_NE(other.mem_, nullptr);
+    ASSERT_NE(other.mem_, mr.heap());
+    auto *heap = ipc::mem::shm_heap::make(other.mem_, other.size_);
+    ASSERT_NE(heap, nullptr);
+    EXPECT_EQ(static_cast<char *>(heap->root()) - reinterpret_cast<char *>(heap),
+              static_cast<char *>(p) - reinterpret_cast<char *>(mr.heap()));
+  }
+  mr.clear();
+}
+
+TEST(shm_memory_resource, shared_vector) {
+  using vector_t = std::vector<int, ipc::mem::shm_allocator<int>>;
+  auto name = unique_name("vector");
+  ipc::mem::shm_memory_resource mr {name.c_str(), 1024 * 1024};
+  ASSERT_TRUE(mr.valid());
+
+  // Places the vector itself in the segment.
+  auto *vec = ::new (mr.allocate(sizeof(vector_t), alignof(vector_t))) vector_t(ipc::mem::shm_allocator<int>{mr});
+  for (int i = 0; i < 1000; ++i) vec->push_back(i);
+  ASSERT_TRUE(mr.heap()->set_root(vec));
+
+  // Uses it through another mapping at another address.
+  {
+    second_mapping other {name.c_str()};
+    ASSERT_NE(other.mem_, nullptr);
+    auto *heap = ipc::mem::shm_heap::make(other.mem_, other.size_);
+    ASSERT_NE(heap, nullptr);
+    auto *vec2 = static_cast<vector_t *>(heap->root());
+    ASSERT_NE(vec2, vec);
+    ASSERT_EQ(vec2->size(), 1000u);
+    for (int i = 0; i < 1000; ++i) ASSERT_EQ((*vec2)[i], i);
+    EXPECT_EQ(vec2->get_allocator().heap(), heap);
+    for (int i = 1000; i < 2000; ++i) vec2->push_back(i);
+  }
+
+  ASSERT_EQ(vec->size(), 2000u);
+  for (int i = 0; i < 2000; ++i) ASSERT_EQ((*vec)[i], i);
+  vec->~vector_t();
+  mr.clear();
+}
+
+TEST(shm_memory_resource, multi_thread) {
+  auto name = unique_name("threads");
+  ipc::mem::shm_memory_resource mr {name.c_str(), 4 * 1024 * 1024};
+  ASSERT_TRUE(mr.valid());
+  constexpr int threads = 4;
+  constexpr int loops   = 10000;
+  std::vector<std::thread> ts;
+  std::vector<std::set<void *>> kept(threads);
+  for (int t = 0; t < threads; ++t) {
+    ts.emplace_back([&, t] {
+      std::vector<void *> held;
+      for (int i = 0; i < loops; ++i) {
+        std::size_t sz = 16u << (i % 4);
+        auto *p = static_cast<unsigned char *>(mr.allocate(sz));
+        ASSERT_NE(p, nullptr);
+        std::memset(p, t, sz);
+        held.push_back(p);
+        if (held.size() > 8) {
+          auto *q = static_cast<unsigned char *>(held.front());
+          std::size_t qsz = 16u << ((i - 8) % 4);
+          for (std::size_t k = 0; k < qsz; ++k) ASSERT_EQ(q[k], t);
+          mr.deallocate(q, qsz);
+          held.erase(held.begin());
+        }
+      }
+      kept[t].insert(held.begin(), held.end());
+    });
+  }
+  for (auto &t : ts) t.join();
+  std::set<void *> all;
+  for (auto &k : kept) {
+    for (void *p : k) EXPECT_TRUE(all.insert(p).second);
+  }
+  mr.clear();
+}
@@ -382,3 +382,77 @@ TEST_F(BufferTest, SelfAssignment) {
   EXPECT_EQ(buf.data(), original_ptr);
   EXPECT_EQ(buf.size(), original_size);
 }
+
+// Test copy_of with a small payload (stored inline)
+TEST_F(BufferTest, CopyOfSmall) {
+  const char text[] = "inline payload";
+  buffer buf1 = buffer::copy_of(text, sizeof(text));
+  EXPECT_EQ(buf1.size(), sizeof(text));
+  EXPECT_NE(buf1.data(), static_cast<const void*>(text));
+  EXPECT_STREQ(buf1.get<const char*>(), text);
+
+  // The inline payload moves with the buffer
+  buffer buf2(std::move(buf1));
+  EXPECT_TRUE(buf1.empty());
+  EXPECT_STREQ(buf2.get<const char*>(), text);
+
+  buffer buf3 = buffer::copy_of("other", 6);
+  buf2.swap(buf3);
+  EXPECT_STREQ(buf2.get<const char*>(), "other");
+  EXPECT_STREQ(buf3.get<const char*>(), text);
+}
+
+// Test copy_of with a payload larger than the inline storage
+TEST_F(BufferTest, CopyOfLarge) {
+  std::vector<char> data(buffer::small_size * 4, 'L');
+  buffer buf = buffer::copy_of(data.data(), data.size());
+  EXPECT_EQ(buf.size(), data.size());
+  EXPECT_NE(buf.data(), static_cast<const void*>(data.data()));
+  EXPECT_EQ(std::memcmp(buf.data(), data.data(), data.size()), 0);
+  EXPECT_TRUE(buffer::copy_of(nullptr, 10).empty());
+}
+
+namespace {
+
+struct ContextTracker {
+  static int count;
+  static int last_value;
+  static void destructor(void* ctx, std::size_t) {
+      ++count;
+      last_value = *static_cast<int*>(ctx);
+  }
+};
+int ContextTracker::count = 0;
+int ContextTracker::last_value = 0;
+
+} // anonymous namespace
+
+// Test destructor context stored inside the buffer
+TEST_F(BufferTest, InlineContext) {
+  ContextTracker::count = 0;
+  char data[8] = "ctx";
+  {
+      int ctx = 42;
+      buffer buf1(data, sizeof(data), ContextTracker::destructor, &ctx, sizeof(ctx));
+      ctx = 0; // the buffer keeps its own copy
+      EXPECT_EQ(buf1.data(), data);
+      buffer buf2(std::move(buf1));
+      EXPECT_EQ(ContextTracker::count, 0);
+      EXPECT_EQ(buf2.data(), data);
+  }
+  EXPECT_EQ(ContextTracker::count, 1);
+  EXPECT_EQ(ContextTracker::last_value, 42);
+}
+
+// Test destructor context larger than the inline storage
+TEST_F(BufferTest, LargeContext) {
+  ContextTracker::count = 0;
+  char data[8] = "ctx";
+  {
+      int ctx[buffer::small_size] = {7};
+      buffer buf(data, sizeof(data), ContextTracker::destructor, ctx, sizeof(ctx));
+      ctx[0] = 0;
+  }
+  EXPECT_EQ(ContextTracker::count, 1);
+  EXPECT_EQ(ContextTracker::last_value, 7);
+}
@@ -16,6 +16,7 @@
 #include <chrono>
 #include <atomic>
 #include <vector>
+#include <cstddef>
 #include "libipc/condition.h"
 #include "libipc/mutex.h"
 #include "libipc/def.h"
@@ -548,3 +549,43 @@ TEST_F(ConditionTest, AfterClear) {
   EXPECT_FALSE(cv.broadcast(mtx));
   mtx.unlock();
 }
+
+// Test a condition opened on caller-provided memory
+TEST_F(ConditionTest, OpenOnMemory) {
+  if ((condition::storage_size() == 0) || (mutex::storage_size() == 0)) {
+      GTEST_SKIP() << "in-place condition is not supported";
+  }
+  alignas(std::max_align_t) char cv_mem[256] {};
+  alignas(std::max_align_t) char mtx_mem[256] {};
+  
+  condition cv1, cv2;
+  mutex mtx1, mtx2;
+  ASSERT_TRUE(cv1.open(cv_mem, sizeof(cv_mem), true));
+  ASSERT_TRUE(cv2.open(cv_mem, sizeof(cv_mem), false));
+  ASSERT_TRUE(mtx1.open(mtx_mem, sizeof(mtx_mem), true));
+  ASSERT_TRUE(mtx2.open(mtx_mem, sizeof(mtx_mem), false));
+  
+  bool ready = false;
+  std::atomic<bool> woken {false};
+  std::thread waiter([&] {
+      mtx2.lock();
+      while (!ready) {
+          if (!cv2.wait(mtx2, 1000)) break;
+      }
+      woken = ready;
+      mtx2.unlock();
+  });
+  
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  mtx1.lock();
+  ready = true;
+  cv1.notify(mtx1);
+  mtx1.unlock();
+  waiter.join();
+  EXPECT_TRUE(woken.load());
+  
+  cv2.close();
+  cv1.clear();
+  mtx2.close();
+  mtx1.clear();
+}
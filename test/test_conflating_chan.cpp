@@ -0,0 +1,200 @@
+/**
+ * @file test_conflating_chan.cpp
+ * @brief Unit tests for ipc::conflating_chan
+ *
+ * This test suite covers:
+ * - Sending and receiving keyed values
+ * - Conflation of unread values of the same key
+ * - New readers and readers overrun by the change log catching up with the latest state
+ * - Blocking receive with timeout, and concurrent senders
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libipc/conflating_chan.h"
+
+using namespace ipc;
+
+namespace {
+
+std::string generate_unique_name(const char* prefix) {
+  static int counter = 0;
+  return std::string(prefix) + "_conflating_" + std::to_string(++counter);
+}
+
+template <typename Key, typename T>
+std::map<Key, T> drain(conflating_chan<Key, T> &chan) {
+  std::map<Key, T> got;
+  Key k;
+  T v;
+  while (chan.try_recv(k, v)) {
+    EXPECT_EQ(got.count(k), 0u); // at most one pending entry per key
+    got[k] = v;
+  }
+  return got;
+}
+
+} // anonymous namespace
+
+class ConflatingChanTest : public ::testing::Test {
+protected:
+  void TearDown() override {
+  }
+};
+
+TEST_F(ConflatingChanTest, Connect) {
+  std::string name = generate_unique_name("connect");
+  conflating_chan<int, int> chan;
+  EXPECT_FALSE(chan.valid());
+  EXPECT_FALSE(chan.send(1, 1));
+  EXPECT_FALSE(chan.connect(nullptr, 16));
+  EXPECT_FALSE(chan.connect("", 16));
+
+  ASSERT_TRUE(chan.connect(name.c_str(), 100));
+  EXPECT_TRUE(chan.valid());
+  EXPECT_EQ(chan.capacity(), 128u);
+  EXPECT_STREQ(chan.name(), name.c_str());
+
+  int k, v;
+  EXPECT_FALSE(chan.try_recv(k, v));
+  chan.clear();
+  EXPECT_FALSE(chan.valid());
+}
+
+TEST_F(ConflatingChanTest, Conflate) {
+  std::string name = generate_unique_name("conflate");
+  conflating_chan<int, int> sender   {name.c_str(), 64};
+  conflating_chan<int, int> receiver {name.c_str(), 64};
+  ASSERT_TRUE(sender.valid());
+  ASSERT_TRUE(receiver.valid());
+
+  for (int round = 0; round < 10; ++round) {
+    for (int key = 0; key < 5; ++key) {
+      ASSERT_TRUE(sender.send(key, round * 100 + key));
+    }
+  }
+  auto got = drain(receiver);
+  ASSERT_EQ(got.size(), 5u);
+  for (int key = 0; key < 5; ++key) {
+    EXPECT_EQ(got[key], 900 + key);
+  }
+
+  // Only the changed keys are delivered afterwards.
+  ASSERT_TRUE(sender.send(3, 1));
+  ASSERT_TRUE(sender.send(3, 2));
+  got = drain(receiver);
+  ASSERT_EQ(got.size(), 1u);
+  EXPECT_EQ(got[3], 2);
+
+  receiver.disconnect();
+  sender.clear();
+}
+
+TEST_F(ConflatingChanTest, LateReaderAndOverrun) {
+  std::string name = generate_unique_name("overrun");
+  conflating_chan<std::uint64_t, std::uint64_t> sender {name.c_str(), 16};
+  conflating_chan<std::uint64_t, std::uint64_t> early  {name.c_str(), 16};
+  ASSERT_TRUE(sender.valid());
+  ASSERT_TRUE(early.valid());
+  std::uint64_t k, v;
+  EXPECT_FALSE(early.try_recv(k, v));
+
+  // Overruns the change log many times.
+  for (std::uint64_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(sender.send(i % 10, i));
+  }
+
+  // A reader connecting later gets the latest state as well.
+  conflating_chan<std::uint64_t, std::uint64_t> late {name.c_str(), 16};
+  for (auto *r : {&early, &late}) {
+    auto got = drain(*r);
+    ASSERT_EQ(got.size(), 10u);
+    for (std::uint64_t key = 0; key < 10; ++key) {
+      EXPECT_EQ(got[key], 990 + key);
+    }
+  }
+
+  // The map is full of other keys.
+  for (std::uint64_t i = 10; i < 16; ++i) {
+    ASSERT_TRUE(sender.send(i, i));
+  }
+  EXPECT_FALSE(sender.send(100, 100));
+  early.disconnect();
+  late.disconnect();
+  sender.clear();
+}
+
+TEST_F(ConflatingChanTest, RecvTimeout) {
+  std::string name = generate_unique_name("timeout");
+  conflating_chan<int, int> chan {name.c_str(), 16};
+  ASSERT_TRUE(chan.valid());
+  int k, v;
+  EXPECT_FALSE(chan.recv(k, v, 50));
+  ASSERT_TRUE(chan.send(7, 70));
+  ASSERT_TRUE(chan.recv(k, v, 50));
+  EXPECT_EQ(k, 7);
+  EXPECT_EQ(v, 70);
+  chan.clear();
+}
+
+TEST_F(ConflatingChanTest, RecvTimeoutWhileEntryUnwritten) {
+  std::string name = generate_unique_name("stall");
+  conflating_chan<int, int> chan {name.c_str(), 16};
+  ASSERT_TRUE(chan.valid());
+  int k, v;
+  EXPECT_FALSE(chan.try_recv(k, v));
+
+  // Moves the tail of the change log without writing the entry, like a writer stopped in the middle.
+  detail::snapshot_chan_base log;
+  ASSERT_TRUE(log.open((name + "__IPC_SHM__LV_LOG__").c_str(),
+                       sizeof(std::uint64_t) * 17, alignof(std::uint64_t)));
+  static_cast<std::atomic<std::uint64_t> *>(log.data())->fetch_add(1);
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(chan.recv(k, v, 50));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+  log.close();
+  chan.clear();
+}
+
+TEST_F(ConflatingChanTest, SlowReaderCatchesUp) {
+  std::string name = generate_unique_name("slow_reader");
+  constexpr int key_count = 32;
+  constexpr int sender_count = 2;
+  constexpr int loops = 5000;
+
+  conflating_chan<int, int> receiver {name.c_str(), key_count};
+  ASSERT_TRUE(receiver.valid());
+
+  std::vector<std::thread> senders;
+  for (int s = 0; s < sender_count; ++s) {
+    senders.emplace_back([&, s] {
+      conflating_chan<int, int> chan {name.c_str(), key_count};
+      for (int i = 0; i < loops; ++i) {
+        chan.send((i * sender_count + s) % key_count, i);
+      }
+    });
+  }
+
+  // A slow reader, the senders never wait for it.
+  std::map<int, int> latest;
+  int k, v;
+  for (int i = 0; i < 100; ++i) {
+    if (receiver.recv(k, v, 10)) latest[k] = v;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  for (auto &t : senders) t.join();
+
+  while (receiver.try_recv(k, v)) latest[k] = v;
+  ASSERT_EQ(latest.size(), std::size_t(key_count));
+  for (auto &kv : latest) {
+    EXPECT_GE(kv.second, loops - key_count);
+  }
+  receiver.clear();
+}
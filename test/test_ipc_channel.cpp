@@ -59,6 +59,11 @@ std::string generate_unique_ipc_name(const char* prefix) {
   return std::string(prefix) + "_ipc_" + std::to_string(++counter);
 }
 
+// A prefix of its own gives a channel chunk pools no other channel holds chunks of
+std::string generate_unique_prefix(const char* prefix) {
+  return std::string(prefix) + "_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
 // Helper to create a test buffer with data
 buffer make_test_buffer(const std::string& data) {
   char* mem = new char[data.size() + 1];
@@ -76,6 +81,273 @@ bool check_buffer_content(const buffer& buf, const std::string& expected) {
   return std::strcmp(static_cast<const char*>(buf.data()), expected.c_str()) == 0;
 }
 
+// Helper to check the topic filters of the receivers, on both route and channel
+template <typename Chan>
+void check_publish_subscribe(std::string const & name) {
+  Chan sender_ch(name.c_str(), sender);
+  Chan all_ch   (name.c_str(), receiver); // no filter
+  Chan one_ch   (name.c_str(), receiver);
+  Chan two_ch   (name.c_str(), receiver);
+  ASSERT_TRUE(one_ch.subscribe(ipc::topic(1)));
+  ASSERT_TRUE(two_ch.subscribe(ipc::topic(2)));
+  
+  // The subscriber of topic 2 never reads, but it doesn't block the sender.
+  for (int i = 0; i < 1000; ++i) {
+      std::string msg = "one_" + std::to_string(i);
+      ASSERT_TRUE(sender_ch.try_publish(ipc::topic(1), msg.c_str(), msg.size() + 1, 0)) << i;
+      EXPECT_TRUE(check_buffer_content(all_ch.try_recv(), msg));
+      EXPECT_TRUE(check_buffer_content(one_ch.try_recv(), msg));
+  }
+  EXPECT_TRUE(two_ch.try_recv().empty());
+  
+  ASSERT_TRUE(sender_ch.publish(ipc::topic(2), std::string("two")));
+  ASSERT_TRUE(sender_ch.publish(ipc::topic(1) | ipc::topic(2), std::string("both")));
+  EXPECT_TRUE(check_buffer_content(two_ch.try_recv(), "two"));
+  EXPECT_TRUE(check_buffer_content(two_ch.try_recv(), "both"));
+  EXPECT_TRUE(check_buffer_content(one_ch.try_recv(), "both"));
+  EXPECT_TRUE(check_buffer_content(all_ch.try_recv(), "two"));
+  EXPECT_TRUE(check_buffer_content(all_ch.try_recv(), "both"));
+  
+  // A large message goes through the same filter.
+  std::string large(ipc::large_msg_limit * 2, 'x');
+  ASSERT_TRUE(sender_ch.publish(ipc::topic(2), large));
+  EXPECT_TRUE(check_buffer_content(two_ch.try_recv(), large));
+  EXPECT_TRUE(check_buffer_content(all_ch.try_recv(), large));
+  EXPECT_TRUE(one_ch.try_recv().empty());
+  
+  // Messages sent without topics reach everyone.
+  ASSERT_TRUE(sender_ch.send(std::string("plain")));
+  for (auto *ch : {&all_ch, &one_ch, &two_ch}) {
+      EXPECT_TRUE(check_buffer_content(ch->try_recv(), "plain"));
+  }
+  
+  // Nobody else subscribes to topic 3, except the unfiltered receiver.
+  all_ch.disconnect();
+  EXPECT_TRUE(sender_ch.publish(ipc::topic(3), std::string("nobody")));
+  EXPECT_TRUE(one_ch.try_recv().empty());
+  EXPECT_TRUE(two_ch.try_recv().empty());
+}
+
+// Helper to check the backpressure policies against a receiver which never reads
+template <typename Chan>
+void check_backpressure(std::string const & name, ipc::backpressure policy) {
+  const int count = 600; // more than a lap of the queue
+  Chan sender_ch(name.c_str(), sender);
+  Chan fast_ch  (name.c_str(), receiver);
+  Chan slow_ch  (name.c_str(), receiver);
+  ASSERT_TRUE(sender_ch.backpressure(policy, 4));
+  
+  int sent = 0;
+  for (int i = 0; i < count; ++i) {
+      if (sender_ch.send(&i, sizeof(i), 0)) ++sent;
+      buffer buf = fast_ch.try_recv();
+      if (buf.empty()) continue;
+      ASSERT_EQ(buf.size(), sizeof(i));
+      EXPECT_EQ(*static_cast<int const *>(buf.data()), i);
+  }
+  EXPECT_EQ(slow_ch.recv_count(), 2u); // still connected
+  EXPECT_EQ(fast_ch.losses().overwritten, 0u);
+  
+  int received = 0, last = -1;
+  for (buffer buf; !(buf = slow_ch.try_recv()).empty(); ++received) {
+      int v = *static_cast<int const *>(buf.data());
+      EXPECT_GT(v, last);
+      last = v;
+  }
+  auto lost = slow_ch.losses();
+  if (policy == ipc::backpressure::drop_newest) {
+      EXPECT_LT(sent, count);
+      EXPECT_EQ(received, sent);
+      EXPECT_EQ(lost.dropped, std::uint64_t(count - sent));
+      EXPECT_EQ(fast_ch.losses().dropped, lost.dropped);
+      EXPECT_EQ(lost.overwritten, 0u);
+  } else {
+      EXPECT_EQ(sent, count);
+      EXPECT_GT(lost.overwritten, 0u);
+      EXPECT_EQ(std::uint64_t(received) + lost.overwritten + lost.dropped, std::uint64_t(count));
+      EXPECT_EQ(fast_ch.losses().dropped, 0u);
+  }
+  if (policy == ipc::backpressure::overwrite_oldest) {
+      EXPECT_EQ(last, count - 1);
+  }
+  if (policy == ipc::backpressure::sample) {
+      EXPECT_GT(lost.dropped, 0u);
+  }
+  
+  // Caught up, the receiver gets every message again.
+  for (int i = 0; i < 8; ++i) {
+      ASSERT_TRUE(sender_ch.send(&i, sizeof(i), 0));
+      EXPECT_FALSE(slow_ch.try_recv().empty()) << i;
+  }
+  EXPECT_EQ(slow_ch.losses().dropped, lost.dropped);
+}
+
+// Helper to check the progress reported by the receivers
+template <typename Chan>
+void check_recv_stats(std::string const & name) {
+  Chan sender_ch(name.c_str(), sender);
+  EXPECT_TRUE(sender_ch.recv_stats().empty());
+  Chan fast_ch(name.c_str(), receiver);
+  Chan slow_ch(name.c_str(), receiver);
+  
+  for (int i = 0; i < 10; ++i) {
+      ASSERT_TRUE(sender_ch.send(&i, sizeof(i)));
+  }
+  ASSERT_EQ(sender_ch.recv_stats().size(), 2u); // sees the lag of both
+  for (int i = 0; i < 10; ++i) ASSERT_FALSE(fast_ch.try_recv().empty());
+  for (int i = 0; i < 3;  ++i) ASSERT_FALSE(slow_ch.try_recv().empty());
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  
+  auto stats = sender_ch.recv_stats();
+  ASSERT_EQ(stats.size(), 2u);
+  if (stats[0].lag > stats[1].lag) std::swap(stats[0], stats[1]);
+  EXPECT_NE(stats[0].id, stats[1].id);
+  EXPECT_EQ(stats[0].lag, 0u);
+  EXPECT_EQ(stats[1].lag, 7u);
+  EXPECT_EQ(stats[0].lag_max, 10u); // seen by the stats before receiving
+  EXPECT_EQ(stats[1].lag_max, 10u);
+  for (auto const & st : stats) {
+      EXPECT_EQ(st.capacity, 256u);
+      EXPECT_GE(st.idle_ns, 20u * 1000 * 1000);
+      EXPECT_EQ(st.losses.dropped + st.losses.overwritten, 0u);
+  }
+  
+  slow_ch.disconnect();
+  EXPECT_EQ(sender_ch.recv_stats().size(), 1u);
+}
+
+// Helper to check the counters of a channel, read with and without connecting
+template <typename Chan>
+void check_chan_stats(std::string const & name) {
+  chan_stats st {};
+  EXPECT_FALSE(Chan::stats(name.c_str(), st));
+  {
+    Chan sender_ch(name.c_str(), sender);
+    Chan receiver_ch(name.c_str(), receiver);
+    ASSERT_TRUE(receiver_ch.wait_for_recv(1, 1000));
+    EXPECT_FALSE(Chan::stats(name.c_str(), st)); // created by the first message
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(sender_ch.send(&i, sizeof(i)));
+    }
+    std::vector<char> large(200, 'x');
+    ASSERT_TRUE(sender_ch.send(large.data(), large.size()));
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_FALSE(receiver_ch.recv(1000).empty());
+    }
+    EXPECT_TRUE(receiver_ch.try_recv().empty()); // doesn't wait
+    EXPECT_TRUE(receiver_ch.recv(10).empty());
+
+    ASSERT_TRUE(Chan::stats(name.c_str(), st));
+    EXPECT_EQ(st.msgs_sent,  6u);
+    EXPECT_EQ(st.bytes_sent, 5 * sizeof(int) + large.size());
+    EXPECT_EQ(st.msgs_recv,  6u);
+    EXPECT_EQ(st.bytes_recv, st.bytes_sent);
+    EXPECT_EQ(st.large_sends,    1u);
+    EXPECT_EQ(st.fragment_sends, 0u);
+    EXPECT_EQ(st.force_pushes,   0u);
+    EXPECT_EQ(st.wait_timeouts,  1u);
+
+    auto own = sender_ch.stats();
+    EXPECT_EQ(own.msgs_sent, st.msgs_sent);
+    EXPECT_EQ(own.msgs_recv, st.msgs_recv);
+  }
+  // The counters go away with the last connection.
+  EXPECT_FALSE(Chan::stats(name.c_str(), st));
+}
+
+// Helper to check the latency recorded for the stamped messages
+template <typename Chan>
+void check_latency(std::string const & name) {
+  Chan sender_ch(name.c_str(), sender);
+  Chan receiver1(name.c_str(), receiver);
+  Chan receiver2(name.c_str(), receiver);
+  ASSERT_TRUE(sender_ch.wait_for_recv(2, 1000));
+
+  // Not stamped by default.
+  int v = 0;
+  ASSERT_TRUE(sender_ch.send(&v, sizeof(v)));
+  ASSERT_FALSE(receiver1.recv(1000).empty());
+  ASSERT_FALSE(receiver2.recv(1000).empty());
+  EXPECT_EQ(sender_ch.stats().latency.count, 0u);
+  // The histograms are only created for tracing.
+  auto histograms_exist = [&name] {
+      shm::handle h;
+      return h.acquire(("__IPC_SHM__LT_CONN__" + name).c_str(), 1, shm::open);
+  };
+  EXPECT_FALSE(histograms_exist());
+
+  ASSERT_TRUE(sender_ch.trace_latency());
+  EXPECT_TRUE(histograms_exist());
+  ASSERT_TRUE(sender_ch.send(&v, sizeof(v)));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  ASSERT_FALSE(receiver1.recv(1000).empty());
+  ASSERT_FALSE(receiver2.recv(1000).empty());
+  for (int i = 0; i < 99; ++i) {
+      ASSERT_TRUE(sender_ch.send(&i, sizeof(i)));
+      ASSERT_FALSE(receiver1.recv(1000).empty());
+  }
+  std::vector<char> large(300, 'x');
+  ASSERT_TRUE(sender_ch.send(large.data(), large.size()));
+  ASSERT_FALSE(receiver1.recv(1000).empty());
+  // No room is left for the stamp.
+  std::vector<char> full(ipc::data_length, 'y');
+  ASSERT_TRUE(sender_ch.send(full.data(), full.size()));
+  ASSERT_FALSE(receiver1.recv(1000).empty());
+
+  auto lat = sender_ch.stats().latency;
+  EXPECT_EQ(lat.count, 102u);
+  EXPECT_LE(lat.p50_ns,  lat.p99_ns);
+  EXPECT_LE(lat.p99_ns,  lat.p999_ns);
+  EXPECT_LE(lat.p999_ns, lat.max_ns);
+  EXPECT_GE(lat.max_ns,  5u * 1000 * 1000);
+
+  auto stats = sender_ch.recv_stats();
+  ASSERT_EQ(stats.size(), 2u);
+  if (stats[0].latency.count < stats[1].latency.count) std::swap(stats[0], stats[1]);
+  EXPECT_EQ(stats[0].latency.count, 101u);
+  EXPECT_EQ(stats[1].latency.count, 1u);
+  EXPECT_GE(stats[1].latency.p50_ns, 5u * 1000 * 1000);
+}
+
+// Helper to check a channel inspected from outside
+template <typename Chan>
+void check_inspect(std::string const & name) {
+  chan_info info;
+  EXPECT_FALSE(Chan::inspect(name.c_str(), info));
+
+  Chan sender_ch(name.c_str(), sender);
+  Chan fast_ch(name.c_str(), receiver);
+  Chan slow_ch(name.c_str(), receiver);
+  ASSERT_TRUE(sender_ch.wait_for_recv(2, 1000));
+  for (int i = 0; i < 9; ++i) {
+      ASSERT_TRUE(sender_ch.send(&i, sizeof(i)));
+  }
+  std::vector<char> large(2000, 'x');
+  ASSERT_TRUE(sender_ch.send(large.data(), large.size()));
+  for (int i = 0; i < 10; ++i) ASSERT_FALSE(fast_ch.recv(1000).empty());
+  for (int i = 0; i < 3;  ++i) ASSERT_FALSE(slow_ch.recv(1000).empty());
+
+  ASSERT_TRUE(Chan::inspect(name.c_str(), info));
+  EXPECT_EQ(info.capacity, 256u);
+  EXPECT_EQ(info.occupancy, 7u);
+  EXPECT_NE(info.receivers, 0u);
+  EXPECT_EQ((info.receivers & (info.receivers - 1)) != 0, true); // 2 receivers
+  ASSERT_EQ(info.recv_count, 2u);
+  EXPECT_EQ(info.recvs[0].lag + info.recvs[1].lag, 7u);
+  EXPECT_EQ(info.stats.msgs_sent, 10u);
+  EXPECT_EQ(info.stats.msgs_recv, 13u);
+
+  auto chunks = Chan::chunk_stats({nullptr}, name.c_str());
+  ASSERT_EQ(chunks.size(), 1u);
+  EXPECT_EQ(chunks[0].chunk_size, 2048u);
+  EXPECT_EQ(chunks[0].capacity, 32u);
+  EXPECT_GE(chunks[0].in_use, 1u); // still held by the slow receiver
+
+  // Inspecting doesn't connect.
+  EXPECT_EQ(sender_ch.recv_count(), 2u);
+}
+
 } // anonymous namespace
 
 // ========== Route Tests (Single Producer, Multiple Consumer) ==========
@@ -447,6 +719,41 @@ TEST_F(RouteTest, OneSenderMultipleReceivers) {
   }
 }
 
+// Test receivers only get the messages published to their topics
+TEST_F(RouteTest, PublishSubscribe) {
+  check_publish_subscribe<route>(generate_unique_ipc_name("route_topics"));
+}
+
+// Test the receivers which can't keep up lose messages instead of being disconnected
+TEST_F(RouteTest, Backpressure) {
+  for (auto policy : {ipc::backpressure::drop_newest,
+                      ipc::backpressure::overwrite_oldest,
+                      ipc::backpressure::sample}) {
+      SCOPED_TRACE(static_cast<unsigned>(policy));
+      check_backpressure<route>(generate_unique_ipc_name("route_backpressure"), policy);
+  }
+}
+
+// Test the sender could see how far behind each receiver is
+TEST_F(RouteTest, RecvStats) {
+  check_recv_stats<route>(generate_unique_ipc_name("route_recv_stats"));
+}
+
+// Test the counters of the channel
+TEST_F(RouteTest, Stats) {
+  check_chan_stats<route>(generate_unique_ipc_name("route_stats"));
+}
+
+// Test the latency of the messages stamped by the sender
+TEST_F(RouteTest, Latency) {
+  check_latency<route>(generate_unique_ipc_name("route_latency"));
+}
+
+// Test inspecting the channel without connecting to it
+TEST_F(RouteTest, Inspect) {
+  check_inspect<route>(generate_unique_ipc_name("route_inspect"));
+}
+
 // ========== Channel Tests (Multiple Producer, Multiple Consumer) ==========
 
 class ChannelTest : public ::testing::Test {
@@ -641,3 +948,335 @@ TEST_F(ChannelTest, Handle) {
   handle_t h = ch.handle();
   EXPECT_NE(h, nullptr);
 }
+
+// Test recv_into with a message that fits into the caller's buffer
+TEST_F(ChannelTest, RecvInto) {
+  std::string name = generate_unique_ipc_name("channel_recv_into");
+  
+  channel sender_ch(name.c_str(), sender);
+  channel receiver_ch(name.c_str(), receiver);
+  
+  ASSERT_TRUE(sender_ch.send(std::string("RecvInto Test")));
+  
+  char out[64] = {};
+  std::size_t n = receiver_ch.recv_into(out, sizeof(out), 1000);
+  EXPECT_EQ(n, std::strlen("RecvInto Test") + 1);
+  EXPECT_STREQ(out, "RecvInto Test");
+  
+  EXPECT_EQ(receiver_ch.try_recv_into(out, sizeof(out)), 0u);
+}
+
+// Test recv_into with large messages, stored in chunks or dedicated segments
+TEST_F(ChannelTest, RecvIntoLarge) {
+  std::string name = generate_unique_ipc_name("channel_recv_into_large");
+  std::string pref = generate_unique_prefix("recv_into_large");
+  
+  channel sender_ch(prefix{pref.c_str()}, name.c_str(), sender);
+  channel receiver_ch(prefix{pref.c_str()}, name.c_str(), receiver);
+  
+  // More messages than the chunk pool of the prefix could hold, the rest are carried by the segments of the sender.
+  const int count = 40;
+  const std::size_t size = 1000;
+  for (int i = 0; i < count; ++i) {
+      std::vector<ipc::byte_t> data(size, static_cast<ipc::byte_t>(i));
+      ASSERT_TRUE(sender_ch.send(data.data(), data.size()));
+  }
+  
+  std::vector<ipc::byte> out(2048);
+  for (int i = 0; i < count; ++i) {
+      std::size_t n = receiver_ch.recv_into(out, 1000);
+      ASSERT_EQ(n, size);
+      for (std::size_t k = 0; k < n; ++k) {
+          ASSERT_EQ(static_cast<ipc::byte_t>(out[k]), static_cast<ipc::byte_t>(i));
+      }
+  }
+}
+
+// Test recv_into with a buffer that is too small
+TEST_F(ChannelTest, RecvIntoTooSmall) {
+  std::string name = generate_unique_ipc_name("channel_recv_into_small");
+  
+  channel sender_ch(name.c_str(), sender);
+  channel receiver_ch(name.c_str(), receiver);
+  
+  std::string big(500, 'x');
+  ASSERT_TRUE(sender_ch.send(std::string("0123456789")));
+  ASSERT_TRUE(sender_ch.send(big));
+  
+  char out[8] = {};
+  // The message is kept until a large enough buffer is given.
+  EXPECT_EQ(receiver_ch.recv_into(out, sizeof(out), 1000), 11u);
+  EXPECT_EQ(receiver_ch.recv_into(nullptr, 0, 1000), 11u);
+  
+  char out2[16] = {};
+  EXPECT_EQ(receiver_ch.recv_into(out2, sizeof(out2), 1000), 11u);
+  EXPECT_STREQ(out2, "0123456789");
+  
+  EXPECT_EQ(receiver_ch.recv_into(out2, sizeof(out2), 1000), big.size() + 1);
+  // A pending message is returned by recv as well.
+  buffer buf = receiver_ch.recv(1000);
+  ASSERT_EQ(buf.size(), big.size() + 1);
+  EXPECT_EQ(big, static_cast<char const *>(buf.data()));
+}
+
+// Test large messages from multiple senders, fragments of different messages must not be mixed up
+TEST_F(ChannelTest, MultipleSendersLargeMessages) {
+  std::string name = generate_unique_ipc_name("channel_multi_large");
+  
+  channel receiver_ch(name.c_str(), receiver);
+  ASSERT_TRUE(receiver_ch.valid());
+  
+  const int num_senders = 3;
+  const int messages_per_sender = 30;
+  const std::size_t size = 1000;
+  
+  std::vector<std::thread> senders;
+  for (int i = 0; i < num_senders; ++i) {
+      senders.emplace_back([&, i]() {
+          channel ch(name.c_str(), sender);
+          for (int j = 0; j < messages_per_sender; ++j) {
+              std::vector<ipc::byte_t> data(size, static_cast<ipc::byte_t>(i * messages_per_sender + j));
+              EXPECT_TRUE(ch.send(data.data(), data.size()));
+          }
+      });
+  }
+  
+  int received = 0;
+  while (received < num_senders * messages_per_sender) {
+      buffer buf = receiver_ch.recv(1000);
+      ASSERT_FALSE(buf.empty());
+      ASSERT_EQ(buf.size(), size);
+      auto p = buf.get<ipc::byte_t const *>();
+      for (std::size_t k = 1; k < size; ++k) {
+          ASSERT_EQ(p[k], p[0]);
+      }
+      ++received;
+  }
+  
+  for (auto& t : senders) {
+      t.join();
+  }
+}
+
+// Test a message beyond the chunk storage, it's carried by a dedicated segment
+TEST_F(ChannelTest, HugeMessage) {
+  std::string name = generate_unique_ipc_name("channel_huge");
+  
+  channel sender_ch(name.c_str(), sender);
+  channel receiver_ch(name.c_str(), receiver);
+  
+  const std::size_t size = ipc::huge_msg_limit * 3 + 7;
+  std::vector<ipc::byte_t> data(size);
+  for (std::size_t i = 0; i < size; ++i) data[i] = static_cast<ipc::byte_t>(i * 31);
+  
+  for (int round = 0; round < 3; ++round) {
+      ASSERT_TRUE(sender_ch.send(data.data(), data.size()));
+      buffer buf = receiver_ch.recv(1000);
+      ASSERT_EQ(buf.size(), size);
+      EXPECT_EQ(std::memcmp(buf.data(), data.data(), size), 0);
+  }
+  
+  ASSERT_TRUE(sender_ch.send(data.data(), data.size()));
+  std::vector<ipc::byte> out(size);
+  ASSERT_EQ(receiver_ch.recv_into(out, 1000), size);
+  EXPECT_EQ(std::memcmp(out.data(), data.data(), size), 0);
+}
+
+// Test a large message waits for a free storage, instead of being split into fragments
+TEST_F(ChannelTest, LargeMessageWaitsForStorage) {
+  std::string name = generate_unique_ipc_name("channel_wait_storage");
+  std::string pref = generate_unique_prefix("wait_storage");
+  
+  channel sender_ch(prefix{pref.c_str()}, name.c_str(), sender);
+  channel receiver_ch(prefix{pref.c_str()}, name.c_str(), receiver);
+  
+  std::vector<ipc::byte_t> data(1000, 1);
+  int sent = 0;
+  while ((sent < 100) && sender_ch.try_send(data.data(), data.size(), 0)) ++sent;
+  // The chunks of the pool, then the dedicated segments of this sender are all held now.
+  EXPECT_EQ(sent, static_cast<int>(2 * ipc::large_msg_cache));
+  
+  auto st = sender_ch.stats();
+  EXPECT_EQ(st.storage_fallbacks, static_cast<std::uint64_t>(ipc::large_msg_cache));
+  EXPECT_FALSE(sender_ch.try_send(data.data(), data.size(), 10));
+  EXPECT_EQ(sender_ch.stats().wait_timeouts, st.wait_timeouts + 1);
+  // counted once per message, not on each retry of the wait
+  EXPECT_EQ(sender_ch.stats().storage_fallbacks, st.storage_fallbacks);
+  
+  std::thread receiver_thread([&]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      buffer buf = receiver_ch.recv(1000);
+      EXPECT_EQ(buf.size(), data.size());
+  });
+  EXPECT_TRUE(sender_ch.try_send(data.data(), data.size(), 1000));
+  receiver_thread.join();
+  EXPECT_EQ(sender_ch.stats().large_sends, st.large_sends + 1);
+  EXPECT_EQ(sender_ch.stats().fragment_sends, 0u);
+  
+  for (int i = 0; i < sent; ++i) {
+      buffer buf = receiver_ch.recv(1000);
+      ASSERT_EQ(buf.size(), data.size());
+      EXPECT_EQ(std::memcmp(buf.data(), data.data(), data.size()), 0);
+  }
+}
+
+// Test a receiver disconnecting recycles the storages of the large messages it hasn't read
+TEST_F(ChannelTest, DisconnectRecyclesUnreadStorages) {
+  std::string name = generate_unique_ipc_name("channel_drain_storage");
+  std::string pref = generate_unique_prefix("drain_storage");
+  
+  channel sender_ch(prefix{pref.c_str()}, name.c_str(), sender);
+  channel receiver_ch(prefix{pref.c_str()}, name.c_str(), receiver);
+  
+  std::vector<ipc::byte_t> data(1000, 3);
+  int sent = 0;
+  while ((sent < 100) && sender_ch.try_send(data.data(), data.size(), 0)) ++sent;
+  EXPECT_EQ(sent, static_cast<int>(2 * ipc::large_msg_cache));
+  
+  // The next receiver takes the same connected id.
+  receiver_ch.disconnect();
+  channel next_ch(prefix{pref.c_str()}, name.c_str(), receiver);
+  ASSERT_TRUE(sender_ch.try_send(data.data(), data.size(), 0));
+  auto chunks = channel::chunk_stats(prefix{pref.c_str()}, name.c_str());
+  ASSERT_EQ(chunks.size(), 1u);
+  EXPECT_EQ(chunks[0].in_use, 1u);
+  EXPECT_EQ(next_ch.recv(1000).size(), data.size());
+}
+
+// Test the chunks held only by the receivers which have gone are taken back by the sender
+TEST_F(ChannelTest, ChunksOfGoneReceiversReclaimed) {
+  std::string name = generate_unique_ipc_name("channel_reclaim_chunks");
+  std::string pref = generate_unique_prefix("reclaim_chunks");
+  
+  channel sender_ch(prefix{pref.c_str()}, name.c_str(), sender);
+  channel slow_ch(prefix{pref.c_str()}, name.c_str(), receiver); // never reads
+  channel fast_ch(prefix{pref.c_str()}, name.c_str(), receiver);
+  
+  std::vector<ipc::byte_t> data(1000, 4);
+  for (std::size_t i = 0; i < ipc::large_msg_cache; ++i) {
+      ASSERT_TRUE(sender_ch.try_send(data.data(), data.size(), 0));
+      ASSERT_EQ(fast_ch.recv(1000).size(), data.size());
+  }
+  auto chunks = channel::chunk_stats(prefix{pref.c_str()}, name.c_str());
+  ASSERT_EQ(chunks.size(), 1u);
+  EXPECT_EQ(chunks[0].in_use, static_cast<std::uint32_t>(ipc::large_msg_cache)); // held by the slow receiver
+  
+  // Fills the queue, then the slow receiver is disconnected without recycling anything.
+  int v = 0;
+  for (std::size_t i = ipc::large_msg_cache; i < 256; ++i) {
+      ASSERT_TRUE(sender_ch.try_send(&v, sizeof(v), 0));
+      ASSERT_FALSE(fast_ch.recv(1000).empty());
+  }
+  ASSERT_TRUE(sender_ch.send(&v, sizeof(v), 0));
+  ASSERT_FALSE(fast_ch.recv(1000).empty());
+  EXPECT_EQ(sender_ch.recv_count(), 1u);
+  // The overwritten message has given its chunk back, the second one reclaims the rest.
+  chunks = channel::chunk_stats(prefix{pref.c_str()}, name.c_str());
+  EXPECT_EQ(chunks[0].in_use, static_cast<std::uint32_t>(ipc::large_msg_cache - 1));
+  ASSERT_TRUE(sender_ch.try_send(data.data(), data.size(), 0));
+  ASSERT_TRUE(sender_ch.try_send(data.data(), data.size(), 0));
+  chunks = channel::chunk_stats(prefix{pref.c_str()}, name.c_str());
+  EXPECT_EQ(chunks[0].in_use, 2u);
+  EXPECT_EQ(fast_ch.recv(1000).size(), data.size());
+  EXPECT_EQ(fast_ch.recv(1000).size(), data.size());
+}
+
+// Test a large message is still readable after its sender has gone
+TEST_F(ChannelTest, HugeMessageOutlivesSender) {
+  std::string name = generate_unique_ipc_name("channel_huge_orphan");
+  
+  channel receiver_ch(name.c_str(), receiver);
+  std::vector<ipc::byte_t> data(ipc::huge_msg_limit + 1, 7);
+  {
+      channel sender_ch(name.c_str(), sender);
+      ASSERT_TRUE(sender_ch.send(data.data(), data.size()));
+  }
+  buffer buf = receiver_ch.recv(1000);
+  ASSERT_EQ(buf.size(), data.size());
+  EXPECT_EQ(std::memcmp(buf.data(), data.data(), data.size()), 0);
+}
+
+// Test a sender doesn't create the waiters it never waits on
+TEST_F(ChannelTest, SenderOpensWaitersLazily) {
+#if defined(_WIN32)
+  GTEST_SKIP() << "the waiters are kernel objects on Windows";
+#endif
+  std::string name = generate_unique_ipc_name("channel_lazy_waiters");
+  auto waiter_exists = [&name](char const *kind) {
+      std::string cond_name = std::string("__IPC_SHM__") + kind + name + "_WAITER_COND_";
+      shm::handle h;
+      return h.acquire(cond_name.c_str(), 1, shm::open);
+  };
+  
+  channel sender_ch(name.c_str(), sender);
+  ASSERT_TRUE(sender_ch.valid());
+  EXPECT_FALSE(sender_ch.wait_for_recv(1, 0));
+  EXPECT_FALSE(waiter_exists("CC_CONN__"));
+  EXPECT_FALSE(waiter_exists("WT_CONN__"));
+  
+  // Waiting for a receiver opens the waiter on demand.
+  EXPECT_FALSE(sender_ch.wait_for_recv(1, 100));
+  EXPECT_FALSE(waiter_exists("WT_CONN__"));
+  channel receiver_ch(name.c_str(), receiver);
+  EXPECT_TRUE(sender_ch.wait_for_recv(1, 1000));
+}
+
+// Test receivers only get the messages published to their topics
+TEST_F(ChannelTest, PublishSubscribe) {
+  check_publish_subscribe<channel>(generate_unique_ipc_name("channel_topics"));
+}
+
+// Test the receivers which can't keep up lose messages instead of being disconnected
+TEST_F(ChannelTest, Backpressure) {
+  for (auto policy : {ipc::backpressure::drop_newest,
+                      ipc::backpressure::overwrite_oldest,
+                      ipc::backpressure::sample}) {
+      SCOPED_TRACE(static_cast<unsigned>(policy));
+      check_backpressure<channel>(generate_unique_ipc_name("channel_backpressure"), policy);
+  }
+}
+
+// Test a blocking sender waits for a slow receiver, whatever the timeout
+TEST_F(ChannelTest, BackpressureBlock) {
+  std::string name = generate_unique_ipc_name("channel_block");
+  const int count = 1000;
+  
+  channel receiver_ch(name.c_str(), receiver);
+  std::thread sender_t([&] {
+      channel sender_ch(name.c_str(), sender);
+      ASSERT_TRUE(sender_ch.backpressure(ipc::backpressure::block));
+      for (int i = 0; i < count; ++i) {
+          ASSERT_TRUE(sender_ch.send(&i, sizeof(i), 0));
+      }
+  });
+  
+  for (int i = 0; i < count; ++i) {
+      if (i % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      buffer buf = receiver_ch.recv(1000);
+      ASSERT_EQ(buf.size(), sizeof(i));
+      EXPECT_EQ(*static_cast<int const *>(buf.data()), i);
+  }
+  sender_t.join();
+  EXPECT_EQ(receiver_ch.losses().dropped, 0u);
+  EXPECT_EQ(receiver_ch.losses().overwritten, 0u);
+}
+
+// Test the sender could see how far behind each receiver is
+TEST_F(ChannelTest, RecvStats) {
+  check_recv_stats<channel>(generate_unique_ipc_name("channel_recv_stats"));
+}
+
+// Test the counters of the channel
+TEST_F(ChannelTest, Stats) {
+  check_chan_stats<channel>(generate_unique_ipc_name("channel_stats"));
+}
+
+// Test the latency of the messages stamped by the sender
+TEST_F(ChannelTest, Latency) {
+  check_latency<channel>(generate_unique_ipc_name("channel_latency"));
+}
+
+// Test inspecting the channel without connecting to it
+TEST_F(ChannelTest, Inspect) {
+  check_inspect<channel>(generate_unique_ipc_name("channel_inspect"));
+}
@@ -18,6 +18,8 @@
 #include <chrono>
 #include <atomic>
 #include <vector>
+#include <cstddef>
+#include <functional>
 #include "libipc/mutex.h"
 #include "libipc/def.h"
 
@@ -499,3 +501,40 @@ TEST_F(MutexTest, LockAfterClear) {
   bool locked = mtx.lock();
   EXPECT_FALSE(locked);
 }
+
+// Test mutexes opened on the same caller-provided memory
+TEST_F(MutexTest, OpenOnMemory) {
+  if (mutex::storage_size() == 0) {
+      GTEST_SKIP() << "in-place mutex is not supported";
+  }
+  alignas(std::max_align_t) char mem[256] {};
+  ASSERT_GE(sizeof(mem), mutex::storage_size());
+  
+  mutex mtx1, mtx2;
+  EXPECT_FALSE(mtx1.open(mem, 0, true));
+  ASSERT_TRUE(mtx1.open(mem, sizeof(mem), true));
+  ASSERT_TRUE(mtx2.open(mem, sizeof(mem), false));
+  EXPECT_EQ(mtx1.native(), mtx2.native());
+  
+  int counter = 0;
+  auto task = [&](mutex &mtx) {
+      for (int i = 0; i < 1000; ++i) {
+          mtx.lock();
+          ++counter;
+          mtx.unlock();
+      }
+  };
+  std::thread t1(task, std::ref(mtx1));
+  std::thread t2(task, std::ref(mtx2));
+  t1.join();
+  t2.join();
+  EXPECT_EQ(counter, 2000);
+  
+  // Closing one of them leaves the memory to the other.
+  mtx1.close();
+  EXPECT_FALSE(mtx1.valid());
+  EXPECT_TRUE(mtx2.lock());
+  EXPECT_TRUE(mtx2.unlock());
+  mtx2.clear();
+  EXPECT_FALSE(mtx2.valid());
+}
@@ -0,0 +1,156 @@
+/**
+ * @file test_seqlock.cpp
+ * @brief Unit tests for ipc::seqlock and ipc::snapshot_chan
+ *
+ * This test suite covers:
+ * - Stores and loads of the in-place seqlock, and torn reads under contention
+ * - Publishing and reading snapshots through a named segment
+ * - Blocking on changes, with and without timeout
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libipc/seqlock.h"
+
+using namespace ipc;
+
+namespace {
+
+std::string generate_unique_name(const char* prefix) {
+  static int counter = 0;
+  return std::string(prefix) + "_seqlock_" + std::to_string(++counter);
+}
+
+struct book_t {
+  std::uint64_t bid;
+  std::uint64_t ask;
+  std::uint64_t check;
+};
+
+} // anonymous namespace
+
+class SeqlockTest : public ::testing::Test {
+protected:
+  void TearDown() override {
+  }
+};
+
+TEST_F(SeqlockTest, StoreLoad) {
+  seqlock<book_t> sl;
+  EXPECT_TRUE(sl.empty());
+  EXPECT_EQ(sl.sequence(), 0u);
+
+  sl.store(book_t{1, 2, 3});
+  EXPECT_FALSE(sl.empty());
+  EXPECT_EQ(sl.sequence(), 2u);
+
+  book_t b {};
+  std::uint64_t seq = 0;
+  EXPECT_TRUE(sl.try_load(b, &seq));
+  EXPECT_EQ(seq, 2u);
+  EXPECT_EQ(b.ask, 2u);
+
+  sl.store(book_t{4, 5, 6});
+  EXPECT_EQ(sl.load(b), 4u);
+  EXPECT_EQ(b.bid, 4u);
+}
+
+TEST_F(SeqlockTest, NoTornRead) {
+  seqlock<book_t> sl;
+  std::atomic<bool> done {false};
+  std::atomic<int> torn {0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      book_t b;
+      while (!done.load(std::memory_order_relaxed)) {
+        if ((sl.load(b) != 0) && (b.check != b.bid + b.ask)) {
+          torn.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+  }
+  for (std::uint64_t i = 1; i <= 100000; ++i) {
+    sl.store(book_t{i, i * 2, i * 3});
+  }
+  done.store(true, std::memory_order_relaxed);
+  for (auto &t : readers) t.join();
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(sl.sequence(), 200000u);
+}
+
+TEST_F(SeqlockTest, SnapshotChanReadWrite) {
+  std::string name = generate_unique_name("read_write");
+  snapshot_chan<book_t> writer {name.c_str()};
+  snapshot_chan<book_t> reader {name.c_str()};
+  ASSERT_TRUE(writer.valid());
+  ASSERT_TRUE(reader.valid());
+  EXPECT_STREQ(reader.name(), name.c_str());
+
+  book_t b {};
+  EXPECT_EQ(reader.read(b), 0u);
+
+  EXPECT_TRUE(writer.write(book_t{10, 20, 30}));
+  EXPECT_TRUE(writer.write(book_t{11, 21, 32}));
+  EXPECT_EQ(reader.read(b), 4u);
+  EXPECT_EQ(b.bid, 11u);
+  EXPECT_EQ(b.check, 32u);
+
+  // Another type is rejected.
+  snapshot_chan<std::uint64_t> wrong;
+  EXPECT_FALSE(wrong.open(name.c_str()));
+
+  reader.close();
+  writer.clear();
+  EXPECT_FALSE(writer.valid());
+  EXPECT_FALSE(writer.write(book_t{}));
+}
+
+TEST_F(SeqlockTest, SnapshotChanWaitTimeout) {
+  std::string name = generate_unique_name("wait_timeout");
+  snapshot_chan<int> chan {name.c_str()};
+  ASSERT_TRUE(chan.valid());
+  ASSERT_TRUE(chan.write(1));
+
+  int v = 0;
+  auto seq = chan.read(v);
+  EXPECT_EQ(chan.wait_for_change(seq, v, 50), 0u);
+
+  // An older sequence returns immediately.
+  EXPECT_EQ(chan.wait_for_change(0, v, 50), seq);
+  EXPECT_EQ(v, 1);
+  chan.clear();
+}
+
+TEST_F(SeqlockTest, SnapshotChanWaitForChange) {
+  std::string name = generate_unique_name("wait_change");
+  constexpr int loops = 100;
+
+  std::atomic<int> last {0};
+  std::thread reader {[&] {
+    snapshot_chan<int> chan {name.c_str()};
+    int v = 0;
+    std::uint64_t seq = chan.read(v);
+    while (v < loops) {
+      auto s = chan.wait_for_change(seq, v, 5000);
+      if (s == 0) break;
+      EXPECT_GT(s, seq);
+      seq = s;
+    }
+    last.store(v);
+  }};
+
+  snapshot_chan<int> chan {name.c_str()};
+  ASSERT_TRUE(chan.valid());
+  for (int i = 1; i <= loops; ++i) {
+    chan.write(i);
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  reader.join();
+  EXPECT_EQ(last.load(), loops);
+  chan.clear();
+}
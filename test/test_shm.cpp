@@ -519,3 +519,114 @@ TEST_F(ShmTest, LargeSegment) {
       }
   }
 }
+
+// ========== Mapping cache Tests ==========
+
+// Test handles with the same name share one mapping
+TEST_F(ShmTest, HandleCacheSharesMapping) {
+  std::string name = generate_unique_name("cache_share");
+  
+  shm::handle h1(name.c_str(), 512);
+  ASSERT_TRUE(h1.valid());
+  EXPECT_EQ(h1.ref(), 1);
+  {
+      shm::handle h2(name.c_str(), 512, shm::open);
+      ASSERT_TRUE(h2.valid());
+      EXPECT_EQ(h2.get(), h1.get());
+      EXPECT_EQ(h2.size(), h1.size());
+      // Each handle still counts as a reference.
+      EXPECT_EQ(h1.ref(), 2);
+      EXPECT_EQ(h2.ref(), 2);
+  }
+  EXPECT_EQ(h1.ref(), 1);
+  
+  // Exclusive creation fails as the segment exists.
+  shm::handle h3;
+  EXPECT_FALSE(h3.acquire(name.c_str(), 512, shm::create));
+  
+  h1.clear();
+}
+
+// Test detaching a shared mapping gives an id of its own
+TEST_F(ShmTest, HandleCacheDetach) {
+  std::string name = generate_unique_name("cache_detach");
+  
+  shm::handle h1(name.c_str(), 256);
+  shm::handle h2(name.c_str(), 256);
+  ASSERT_TRUE(h1.valid());
+  ASSERT_TRUE(h2.valid());
+  static_cast<int*>(h1.get())[0] = 42;
+  
+  shm::id_t id = h2.detach();
+  ASSERT_NE(id, nullptr);
+  EXPECT_FALSE(h2.valid());
+  EXPECT_EQ(h1.ref(), 2);
+  
+  shm::handle h3;
+  h3.attach(id);
+  ASSERT_TRUE(h3.valid());
+  EXPECT_EQ(static_cast<int*>(h3.get())[0], 42);
+  h3.release();
+  EXPECT_EQ(h1.ref(), 1);
+  
+  h1.clear();
+}
+
+// Test clearing evicts the mapping from the cache
+TEST_F(ShmTest, HandleCacheClear) {
+  std::string name = generate_unique_name("cache_clear");
+  
+  shm::handle h1(name.c_str(), 256);
+  ASSERT_TRUE(h1.valid());
+  static_cast<int*>(h1.get())[0] = 42;
+  h1.clear();
+  
+  shm::handle h2(name.c_str(), 256);
+  ASSERT_TRUE(h2.valid());
+  EXPECT_EQ(static_cast<int*>(h2.get())[0], 0);
+  EXPECT_EQ(h2.ref(), 1);
+  
+  h2.clear();
+  shm::handle h3(name.c_str(), 256, shm::open);
+  EXPECT_FALSE(h3.valid());
+}
+
+// Test a name removed and created again is not served from the old mapping
+TEST_F(ShmTest, HandleCacheRemovedName) {
+  std::string name = generate_unique_name("cache_removed");
+  
+  shm::handle h1(name.c_str(), 256);
+  ASSERT_TRUE(h1.valid());
+  static_cast<int*>(h1.get())[0] = 42;
+  shm::remove(name.c_str());
+  
+  shm::handle h2(name.c_str(), 256);
+  ASSERT_TRUE(h2.valid());
+  EXPECT_NE(h2.get(), h1.get());
+  EXPECT_EQ(static_cast<int*>(h2.get())[0], 0);
+  EXPECT_EQ(h2.ref(), 1);
+  // The old mapping stays with its handle.
+  EXPECT_EQ(static_cast<int*>(h1.get())[0], 42);
+  
+  h2.clear();
+  h1.release();
+}
+
+// Test clearing a shared mapping leaves it to the other handles
+TEST_F(ShmTest, HandleCacheClearShared) {
+  std::string name = generate_unique_name("cache_clear_shared");
+  
+  shm::handle h1(name.c_str(), 256);
+  shm::handle h2(name.c_str(), 256, shm::open);
+  ASSERT_TRUE(h1.valid());
+  ASSERT_TRUE(h2.valid());
+  static_cast<int*>(h1.get())[0] = 42;
+  h1.clear();
+  EXPECT_FALSE(h1.valid());
+  ASSERT_TRUE(h2.valid());
+  EXPECT_EQ(static_cast<int*>(h2.get())[0], 42);
+  
+  shm::handle h3(name.c_str(), 256, shm::open);
+  EXPECT_FALSE(h3.valid());
+  h2.release();
+}
@@ -0,0 +1,164 @@
+/**
+ * @file test_shm_hash_map.cpp
+ * @brief Unit tests for ipc::shm_hash_map
+ *
+ * This test suite covers:
+ * - Opening, capacity rounding and parameter checks
+ * - Insert, assign and lookup through several handles of the same segment
+ * - Full maps and iteration
+ * - Concurrent writers and readers (no torn values)
+ */
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libipc/shm_hash_map.h"
+
+using namespace ipc;
+
+namespace {
+
+std::string generate_unique_name(const char* prefix) {
+  static int counter = 0;
+  return std::string(prefix) + "_shm_hash_map_" + std::to_string(++counter);
+}
+
+struct quote_t {
+  std::uint64_t bid;
+  std::uint64_t ask;
+  std::uint64_t seq;
+};
+
+} // anonymous namespace
+
+class ShmHashMapTest : public ::testing::Test {
+protected:
+  void TearDown() override {
+  }
+};
+
+TEST_F(ShmHashMapTest, Open) {
+  std::string name = generate_unique_name("open");
+  shm_hash_map<int, int> map;
+  EXPECT_FALSE(map.valid());
+  EXPECT_FALSE(map.insert_or_assign(1, 1));
+  EXPECT_FALSE(map.open(name.c_str(), 0));
+
+  ASSERT_TRUE(map.open(name.c_str(), 100));
+  EXPECT_TRUE(map.valid());
+  EXPECT_EQ(map.capacity(), 128u);
+  EXPECT_TRUE(map.empty());
+  EXPECT_STREQ(map.name(), name.c_str());
+
+  // Another capacity or value type is rejected.
+  shm_hash_map<int, int> other;
+  EXPECT_FALSE(other.open(name.c_str(), 64));
+  shm_hash_map<int, short> wrong;
+  EXPECT_FALSE(wrong.open(name.c_str(), 100));
+  EXPECT_TRUE(map.insert_or_assign(1, 1));
+
+  map.clear();
+  EXPECT_FALSE(map.valid());
+}
+
+TEST_F(ShmHashMapTest, InsertAndFind) {
+  std::string name = generate_unique_name("insert_find");
+  shm_hash_map<std::uint64_t, quote_t> writer {name.c_str(), 1024};
+  shm_hash_map<std::uint64_t, quote_t> reader {name.c_str(), 1024};
+  ASSERT_TRUE(writer.valid());
+  ASSERT_TRUE(reader.valid());
+
+  quote_t q {};
+  EXPECT_FALSE(reader.find(42, q));
+  EXPECT_FALSE(reader.contains(42));
+
+  for (std::uint64_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(writer.insert_or_assign(i * 7919, quote_t{i, i + 1, 0}));
+  }
+  EXPECT_EQ(reader.size(), 1000u);
+  for (std::uint64_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(reader.find(i * 7919, q));
+    EXPECT_EQ(q.bid, i);
+    EXPECT_EQ(q.ask, i + 1);
+  }
+
+  // Assigning an existing key doesn't add one.
+  ASSERT_TRUE(writer.insert_or_assign(7919, quote_t{100, 200, 1}));
+  EXPECT_EQ(reader.size(), 1000u);
+  ASSERT_TRUE(reader.find(7919, q));
+  EXPECT_EQ(q.bid, 100u);
+  EXPECT_EQ(q.seq, 1u);
+
+  reader.close();
+  writer.clear();
+}
+
+TEST_F(ShmHashMapTest, Full) {
+  std::string name = generate_unique_name("full");
+  shm_hash_map<int, int> map {name.c_str(), 8};
+  ASSERT_TRUE(map.valid());
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(map.insert_or_assign(i, i * 10));
+  }
+  EXPECT_FALSE(map.insert_or_assign(8, 80));
+  EXPECT_TRUE(map.insert_or_assign(3, 33));
+  EXPECT_FALSE(map.contains(8));
+
+  int sum = 0, count = 0;
+  map.for_each([&](int key, int value) {
+    ++count;
+    sum += value - key * 10;
+  });
+  EXPECT_EQ(count, 8);
+  EXPECT_EQ(sum, 3);
+  map.clear();
+}
+
+TEST_F(ShmHashMapTest, ConcurrentReadWrite) {
+  std::string name = generate_unique_name("concurrent");
+  constexpr std::uint64_t key_count = 64;
+  constexpr int writer_count = 4;
+  constexpr int reader_count = 4;
+  constexpr std::uint64_t loops = 20000;
+
+  shm_hash_map<std::uint64_t, quote_t> map {name.c_str(), key_count * 2};
+  ASSERT_TRUE(map.valid());
+
+  std::atomic<bool> done {false};
+  std::atomic<int> torn {0};
+  std::vector<std::thread> readers;
+  for (int r = 0; r < reader_count; ++r) {
+    readers.emplace_back([&] {
+      shm_hash_map<std::uint64_t, quote_t> view {name.c_str(), key_count * 2};
+      quote_t q;
+      while (!done.load(std::memory_order_relaxed)) {
+        for (std::uint64_t k = 0; k < key_count; ++k) {
+          if (view.find(k, q) && ((q.ask != q.bid + k) || (q.seq != q.bid * 3))) {
+            torn.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+      }
+    });
+  }
+  std::vector<std::thread> writers;
+  for (int w = 0; w < writer_count; ++w) {
+    writers.emplace_back([&, w] {
+      shm_hash_map<std::uint64_t, quote_t> view {name.c_str(), key_count * 2};
+      for (std::uint64_t i = 0; i < loops; ++i) {
+        std::uint64_t k = (i + w) % key_count;
+        std::uint64_t v = i * writer_count + w;
+        view.insert_or_assign(k, quote_t{v, v + k, v * 3});
+      }
+    });
+  }
+  for (auto &t : writers) t.join();
+  done.store(true, std::memory_order_relaxed);
+  for (auto &t : readers) t.join();
+
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(map.size(), key_count);
+  map.clear();
+}
@@ -0,0 +1,336 @@
+/*
+ * ipc-load: a synthetic load generator, for capacity planning.
+ *
+ * usage: ipc-load [-k route|channel] [-b policy] [-P producers] [-C consumers] [-s sizes]
+ *                 [-r rate] [-B burst] [-t seconds] [name]
+ *   -k  the channel, ipc::channel (default) or ipc::route (a single producer)
+ *   -b  the backpressure policy of the producers:
+ *       disconnect, block (default), drop, overwrite or sample, see 'ipc::backpressure'
+ *   -P  the producers, 1 by default
+ *   -C  the consumers, 1 by default
+ *   -s  the distribution of the message sizes, in bytes:
+ *       fixed:N (default fixed:256), uniform:MIN-MAX, lognormal:MEDIAN,SIGMA,
+ *       bimodal:SMALL,LARGE,P (a message is LARGE with the probability P)
+ *   -r  the messages per second of all the producers, 0 (default) for as fast as possible
+ *   -B  sends the messages in bursts of this many back to back, at the same average rate
+ *   -t  the duration in seconds, 10 by default
+ *   name  the channel, "ipc-load" by default
+ *
+ * The producers & consumers are threads of this process, each with a connection of its own.
+ * Every message starts with the time it is sent & a sequence number of its producer,
+ * so it is at least 16 bytes; the consumers measure the latency and the lost messages from them.
+*/
+
+#include <signal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/ipc.h"
+#include "libipc/utility/log_histogram.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+std::atomic<bool> is_quit__ {false};
+
+struct msg_head {
+    std::uint64_t sent_ns;
+    std::uint32_t producer;
+    std::uint32_t seq;
+};
+
+struct size_dist {
+    enum kind_t { fixed, uniform, lognormal, bimodal } kind = fixed;
+    double a = 256, b = 0, c = 0;
+
+    bool parse(char const *s) {
+        char const *colon = std::strchr(s, ':');
+        if (colon == nullptr) return false;
+        std::string k {s, colon};
+        char *end = nullptr;
+        a = std::strtod(colon + 1, &end);
+        auto next = [&end]() -> double {
+            if ((*end != ',') && (*end != '-')) return -1;
+            return std::strtod(end + 1, &end);
+        };
+        if      (k == "fixed")     { kind = fixed; }
+        else if (k == "uniform")   { kind = uniform;   b = next(); if (b < a) return false; }
+        else if (k == "lognormal") { kind = lognormal; b = next(); if (b <= 0) return false; }
+        else if (k == "bimodal")   { kind = bimodal;   b = next(); c = next(); if ((c < 0) || (c > 1)) return false; }
+        else return false;
+        return (a > 0) && (*end == '\0');
+    }
+
+    std::size_t clamp(double v) const {
+        return static_cast<std::size_t>((std::max)(double(sizeof(msg_head)), (std::min)(v, 16.0 * 1024 * 1024)));
+    }
+
+    std::size_t max_size() const {
+        switch (kind) {
+        case uniform:   return clamp(b);
+        case lognormal: return clamp(16.0 * 1024 * 1024);
+        case bimodal:   return clamp((std::max)(a, b));
+        default:        return clamp(a);
+        }
+    }
+
+    template <typename R>
+    std::size_t operator()(R &rng) const {
+        switch (kind) {
+        case uniform:
+            return clamp(std::uniform_real_distribution<double>{a, b + 1}(rng));
+        case lognormal:
+            return clamp(std::lognormal_distribution<double>{std::log(a), b}(rng));
+        case bimodal:
+            return clamp(std::bernoulli_distribution{c}(rng) ? b : a);
+        default:
+            return clamp(a);
+        }
+    }
+};
+
+struct options {
+    bool               route     = false;
+    ipc::backpressure  policy    = ipc::backpressure::block;
+    std::size_t        producers = 1;
+    std::size_t        consumers = 1;
+    size_dist          sizes;
+    double             rate      = 0;
+    std::size_t        burst     = 1;
+    double             seconds   = 10;
+    std::string        name      = "ipc-load";
+};
+
+/* Counted by all the threads. */
+struct counters {
+    std::atomic<std::uint64_t> sent       {0};
+    std::atomic<std::uint64_t> sent_bytes {0};
+    std::atomic<std::uint64_t> failed     {0};
+    std::atomic<std::uint64_t> recv       {0};
+    std::atomic<std::uint64_t> recv_bytes {0};
+    std::atomic<std::uint64_t> gaps       {0}; // messages missing from the sequences of the producers
+    std::atomic<std::uint64_t> dropped    {0};
+    std::atomic<std::uint64_t> overwritten{0};
+    std::atomic<unsigned>      producing  {0};
+    ipc::log_histogram         latency;
+};
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        steady_clock::now().time_since_epoch()).count());
+}
+
+int usage() {
+    std::fprintf(stderr, "usage: ipc-load [-k route|channel] [-b disconnect|block|drop|overwrite|sample] "
+                         "[-P producers] [-C consumers] [-s fixed:N|uniform:MIN-MAX|lognormal:MEDIAN,SIGMA|bimodal:SMALL,LARGE,P] "
+                         "[-r rate] [-B burst] [-t seconds] [name]\n");
+    return -1;
+}
+
+template <typename Chan>
+void produce(options const &opt, counters &cnt, std::size_t id, steady_clock::time_point end) {
+    Chan ch {opt.name.c_str(), ipc::sender};
+    ch.backpressure(opt.policy);
+    ch.wait_for_recv(opt.consumers);
+    std::mt19937_64 rng {id * 7919 + 1};
+    std::vector<char> buf(opt.sizes.max_size());
+    double interval = (opt.rate > 0) ? static_cast<double>(opt.burst) * static_cast<double>(opt.producers) / opt.rate : 0;
+    auto start = steady_clock::now();
+    std::uint32_t seq = 0;
+    for (std::uint64_t n = 0; !is_quit__.load(std::memory_order_relaxed); ++n) {
+        if (interval > 0) {
+            // open loop: a late burst is sent at once, to keep up with the rate
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<steady_clock::duration>(
+                std::chrono::duration<double>(interval * static_cast<double>(n))));
+        }
+        if (steady_clock::now() >= end) break;
+        for (std::size_t i = 0; i < opt.burst; ++i) {
+            std::size_t size = opt.sizes(rng);
+            msg_head head {now_ns(), static_cast<std::uint32_t>(id), seq++};
+            std::memcpy(buf.data(), &head, sizeof(head));
+            if (ch.send(buf.data(), size)) {
+                cnt.sent      .fetch_add(1, std::memory_order_relaxed);
+                cnt.sent_bytes.fetch_add(size, std::memory_order_relaxed);
+            }
+            else cnt.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    cnt.producing.fetch_sub(1, std::memory_order_release);
+}
+
+template <typename Chan>
+void consume(options const &opt, counters &cnt, std::atomic<unsigned> &ready) {
+    Chan ch {opt.name.c_str(), ipc::receiver};
+    ready.fetch_add(1, std::memory_order_release);
+    std::vector<std::uint32_t> next(opt.producers, 0);
+    for (;;) {
+        auto buf = ch.recv(100);
+        if (buf.empty()) {
+            // drains the queue after the producers are done
+            if (cnt.producing.load(std::memory_order_acquire) == 0) break;
+            continue;
+        }
+        msg_head head;
+        if (buf.size() < sizeof(head)) continue;
+        std::memcpy(&head, buf.data(), sizeof(head));
+        cnt.latency.record(now_ns() - head.sent_ns);
+        cnt.recv      .fetch_add(1, std::memory_order_relaxed);
+        cnt.recv_bytes.fetch_add(buf.size(), std::memory_order_relaxed);
+        if (head.producer < next.size()) {
+            auto &nx = next[head.producer];
+            if (head.seq > nx) cnt.gaps.fetch_add(head.seq - nx, std::memory_order_relaxed);
+            nx = head.seq + 1;
+        }
+    }
+    auto ls = ch.losses();
+    cnt.dropped    .fetch_add(ls.dropped, std::memory_order_relaxed);
+    cnt.overwritten.fetch_add(ls.overwritten, std::memory_order_relaxed);
+}
+
+void print_latency(ipc::log_histogram const &h) {
+    double const qs[] = {0.5, 0.9, 0.99, 0.999, 1.0};
+    std::uint64_t v[5] {};
+    auto total = h.quantiles(qs, v, 5);
+    if (total == 0) {
+        std::printf("latency: -\n");
+        return;
+    }
+    std::printf("latency: p50 %.1f us, p90 %.1f us, p99 %.1f us, p999 %.1f us, max %.1f us\n",
+                v[0] / 1e3, v[1] / 1e3, v[2] / 1e3, v[3] / 1e3, v[4] / 1e3);
+    // sums up the log-scaled buckets by powers of 2
+    std::printf("%12s %12s %8s\n", "< us", "messages", "%");
+    std::uint64_t bin = 0;
+    for (std::size_t i = 0; i < ipc::log_histogram::bucket_count; ++i) {
+        bin += h.count(i);
+        auto hi = ipc::log_histogram::highest_of(i) + 1;
+        bool edge = (i + 1 == ipc::log_histogram::bucket_count) || ((hi & (hi - 1)) == 0 && hi >= 1024);
+        if (!edge || (bin == 0)) continue;
+        std::printf("%12.3f %12llu %8.3f\n", static_cast<double>(hi) / 1e3,
+                    static_cast<unsigned long long>(bin), 100.0 * static_cast<double>(bin) / static_cast<double>(total));
+        bin = 0;
+    }
+}
+
+template <typename Chan>
+int run(options const &opt) {
+    std::unique_ptr<counters> cnt {new counters{}};
+    std::atomic<unsigned> ready {0};
+    cnt->producing.store(static_cast<unsigned>(opt.producers));
+
+    std::vector<std::thread> consumers, producers;
+    for (std::size_t i = 0; i < opt.consumers; ++i) {
+        consumers.emplace_back([&] { consume<Chan>(opt, *cnt, ready); });
+    }
+    while (ready.load(std::memory_order_acquire) < opt.consumers) std::this_thread::yield();
+    auto start = steady_clock::now();
+    auto end   = start + std::chrono::duration_cast<steady_clock::duration>(std::chrono::duration<double>(opt.seconds));
+    for (std::size_t i = 0; i < opt.producers; ++i) {
+        producers.emplace_back([&, i] { produce<Chan>(opt, *cnt, i, end); });
+    }
+
+    // reports every second
+    std::uint64_t last_sent = 0, last_recv = 0, last_bytes = 0;
+    auto last_tp = start;
+    while ((cnt->producing.load(std::memory_order_acquire) != 0) && !is_quit__.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto tp = steady_clock::now();
+        double secs = std::chrono::duration<double>(tp - last_tp).count();
+        if (secs < 1) continue;
+        std::uint64_t sent = cnt->sent, recv = cnt->recv, bytes = cnt->recv_bytes;
+        std::printf("[%5.1f s] sent %.1f msg/s, received %.1f msg/s, %.2f MB/s, failed %llu\n",
+                    std::chrono::duration<double>(tp - start).count(),
+                    static_cast<double>(sent - last_sent) / secs, static_cast<double>(recv - last_recv) / secs,
+                    static_cast<double>(bytes - last_bytes) / secs / (1024.0 * 1024.0),
+                    static_cast<unsigned long long>(cnt->failed.load()));
+        std::fflush(stdout);
+        last_sent = sent; last_recv = recv; last_bytes = bytes; last_tp = tp;
+    }
+    for (auto &t : producers) t.join();
+    double secs = std::chrono::duration<double>(steady_clock::now() - start).count();
+    for (auto &t : consumers) t.join();
+
+    std::uint64_t sent = cnt->sent, recv = cnt->recv;
+    std::printf("== %s (%s), %zu producer(s), %zu consumer(s), %.1f s\n", opt.name.c_str(),
+                opt.route ? "route" : "channel", opt.producers, opt.consumers, secs);
+    std::printf("sent: %llu msgs, %.1f msg/s, %.2f MB/s, failed %llu\n",
+                static_cast<unsigned long long>(sent), static_cast<double>(sent) / secs,
+                static_cast<double>(cnt->sent_bytes.load()) / secs / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(cnt->failed.load()));
+    std::printf("received: %llu msgs (%llu expected), %.1f msg/s, %.2f MB/s\n",
+                static_cast<unsigned long long>(recv), static_cast<unsigned long long>(sent * opt.consumers),
+                static_cast<double>(recv) / secs,
+                static_cast<double>(cnt->recv_bytes.load()) / secs / (1024.0 * 1024.0));
+    std::printf("lost: %llu missing in sequence, %llu dropped, %llu overwritten\n",
+                static_cast<unsigned long long>(cnt->gaps.load()),
+                static_cast<unsigned long long>(cnt->dropped.load()),
+                static_cast<unsigned long long>(cnt->overwritten.load()));
+    print_latency(cnt->latency);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> char const * { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        char const *v = nullptr;
+        if ((std::strcmp(argv[i], "-k") == 0) && (v = next())) {
+            if      (std::strcmp(v, "route")   == 0) opt.route = true;
+            else if (std::strcmp(v, "channel") == 0) opt.route = false;
+            else return usage();
+        } else if ((std::strcmp(argv[i], "-b") == 0) && (v = next())) {
+            if      (std::strcmp(v, "disconnect") == 0) opt.policy = ipc::backpressure::disconnect_slow;
+            else if (std::strcmp(v, "block")      == 0) opt.policy = ipc::backpressure::block;
+            else if (std::strcmp(v, "drop")       == 0) opt.policy = ipc::backpressure::drop_newest;
+            else if (std::strcmp(v, "overwrite")  == 0) opt.policy = ipc::backpressure::overwrite_oldest;
+            else if (std::strcmp(v, "sample")     == 0) opt.policy = ipc::backpressure::sample;
+            else return usage();
+        } else if ((std::strcmp(argv[i], "-P") == 0) && (v = next())) {
+            opt.producers = std::strtoul(v, nullptr, 10);
+        } else if ((std::strcmp(argv[i], "-C") == 0) && (v = next())) {
+            opt.consumers = std::strtoul(v, nullptr, 10);
+        } else if ((std::strcmp(argv[i], "-s") == 0) && (v = next())) {
+            if (!opt.sizes.parse(v)) return usage();
+        } else if ((std::strcmp(argv[i], "-r") == 0) && (v = next())) {
+            opt.rate = std::strtod(v, nullptr);
+        } else if ((std::strcmp(argv[i], "-B") == 0) && (v = next())) {
+            opt.burst = std::strtoul(v, nullptr, 10);
+        } else if ((std::strcmp(argv[i], "-t") == 0) && (v = next())) {
+            opt.seconds = std::strtod(v, nullptr);
+        } else if (argv[i][0] != '-') {
+            opt.name = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if ((opt.producers == 0) || (opt.consumers == 0) || (opt.consumers > 32) || (opt.burst == 0) ||
+        (opt.rate < 0) || (opt.seconds <= 0)) {
+        return usage();
+    }
+    if (opt.route && (opt.producers > 1)) {
+        std::fprintf(stderr, "a route has a single producer\n");
+        return -1;
+    }
+
+    auto exit = [](int) {
+        is_quit__.store(true, std::memory_order_release);
+    };
+    ::signal(SIGINT , exit);
+    ::signal(SIGTERM, exit);
+
+    return opt.route ? run<ipc::route>(opt) : run<ipc::channel>(opt);
+}
@@ -0,0 +1,151 @@
+/*
+ * ipc-stat: prints the state of a live channel, without connecting to it.
+ *
+ * usage: ipc-stat [-r] [-p prefix] [-i interval_ms] [-n count] name
+ *   -r  the channel is an ipc::route, otherwise an ipc::channel
+ *   -p  the prefix the channel was created with
+ *   -i  the interval between two reports, 1000 ms by default
+ *   -n  the number of reports, 0 (default) for running until interrupted
+*/
+
+#include <signal.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+#include "libipc/ipc.h"
+
+namespace {
+
+std::atomic<bool> is_quit__ {false};
+
+struct options {
+    bool        route    = false;
+    std::string prefix;
+    std::string name;
+    unsigned    interval = 1000;
+    unsigned    count    = 0;
+};
+
+int usage() {
+    std::fprintf(stderr, "usage: ipc-stat [-r] [-p prefix] [-i interval_ms] [-n count] name\n");
+    return -1;
+}
+
+double us_of(std::uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+void print_latency(char const *title, ipc::latency_stat const &lat) {
+    if (lat.count == 0) {
+        std::printf("%s: -\n", title);
+        return;
+    }
+    std::printf("%s: %llu msgs, p50 %.1f us, p99 %.1f us, p999 %.1f us, max %.1f us\n", title,
+                static_cast<unsigned long long>(lat.count),
+                us_of(lat.p50_ns), us_of(lat.p99_ns), us_of(lat.p999_ns), us_of(lat.max_ns));
+}
+
+void print_info(options const &opt, ipc::chan_info const &info, ipc::chan_stats const &last, double secs) {
+    auto const &st = info.stats;
+    unsigned recvs = 0;
+    for (auto cc = info.receivers; cc != 0; cc &= cc - 1) ++recvs;
+    std::printf("== %s%s%s (%s)\n", opt.prefix.c_str(), opt.prefix.empty() ? "" : "/", opt.name.c_str(),
+                opt.route ? "route" : "channel");
+    std::printf("receivers: 0x%08x (%u), occupancy: %u/%u\n", info.receivers, recvs, info.occupancy, info.capacity);
+    if (secs > 0) {
+        std::printf("send: %.1f msg/s, %.1f KB/s; recv: %.1f msg/s, %.1f KB/s\n",
+                    static_cast<double>(st.msgs_sent  - last.msgs_sent)  / secs,
+                    static_cast<double>(st.bytes_sent - last.bytes_sent) / secs / 1024.0,
+                    static_cast<double>(st.msgs_recv  - last.msgs_recv)  / secs,
+                    static_cast<double>(st.bytes_recv - last.bytes_recv) / secs / 1024.0);
+    }
+    std::printf("totals: sent %llu (fragmented %llu, large %llu), received %llu, "
+                "force_push %llu, timeouts %llu, storage fallbacks %llu\n",
+                static_cast<unsigned long long>(st.msgs_sent),
+                static_cast<unsigned long long>(st.fragment_sends),
+                static_cast<unsigned long long>(st.large_sends),
+                static_cast<unsigned long long>(st.msgs_recv),
+                static_cast<unsigned long long>(st.force_pushes),
+                static_cast<unsigned long long>(st.wait_timeouts),
+                static_cast<unsigned long long>(st.storage_fallbacks));
+    print_latency("latency", st.latency);
+    if (info.recv_count != 0) {
+        std::printf("%4s %6s %8s %10s %10s %12s %10s %10s\n",
+                    "id", "lag", "lag_max", "idle_ms", "dropped", "overwritten", "p50_us", "p99_us");
+        for (std::uint32_t i = 0; i < info.recv_count; ++i) {
+            auto const &r = info.recvs[i];
+            std::printf("%4u %6u %8u %10.1f %10llu %12llu %10.1f %10.1f\n",
+                        r.id, r.lag, r.lag_max, static_cast<double>(r.idle_ns) / 1e6,
+                        static_cast<unsigned long long>(r.losses.dropped),
+                        static_cast<unsigned long long>(r.losses.overwritten),
+                        us_of(r.latency.p50_ns), us_of(r.latency.p99_ns));
+        }
+    }
+}
+
+template <typename Chan>
+int run(options const &opt) {
+    ipc::prefix pref {opt.prefix.empty() ? nullptr : opt.prefix.c_str()};
+    ipc::chan_stats last {};
+    auto last_tp = std::chrono::steady_clock::now();
+    bool first = true;
+    for (unsigned n = 0; (opt.count == 0) || (n < opt.count); ++n) {
+        if (n != 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(opt.interval));
+        }
+        if (is_quit__.load(std::memory_order_acquire)) break;
+        ipc::chan_info info;
+        if (!Chan::inspect(pref, opt.name.c_str(), info)) {
+            std::printf("== %s: no such channel\n", opt.name.c_str());
+            first = true;
+            continue;
+        }
+        auto tp = std::chrono::steady_clock::now();
+        double secs = first ? 0 : std::chrono::duration<double>(tp - last_tp).count();
+        print_info(opt, info, last, secs);
+        for (auto const &c : Chan::chunk_stats(pref, opt.name.c_str())) {
+            std::printf("chunks of %u bytes: %u/%u in use\n", c.chunk_size, c.in_use, c.capacity);
+        }
+        std::fflush(stdout);
+        last    = info.stats;
+        last_tp = tp;
+        first   = false;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+    options opt;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-r") == 0) {
+            opt.route = true;
+        } else if ((std::strcmp(argv[i], "-p") == 0) && (i + 1 < argc)) {
+            opt.prefix = argv[++i];
+        } else if ((std::strcmp(argv[i], "-i") == 0) && (i + 1 < argc)) {
+            opt.interval = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if ((std::strcmp(argv[i], "-n") == 0) && (i + 1 < argc)) {
+            opt.count = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if ((argv[i][0] != '-') && opt.name.empty()) {
+            opt.name = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (opt.name.empty()) return usage();
+
+    auto exit = [](int) {
+        is_quit__.store(true, std::memory_order_release);
+    };
+    ::signal(SIGINT , exit);
+    ::signal(SIGTERM, exit);
+
+    return opt.route ? run<ipc::route>(opt) : run<ipc::channel>(opt);
+}
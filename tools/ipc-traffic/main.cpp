@@ -0,0 +1,227 @@
+/*
+ * ipc-traffic: records the traffic of a live channel into a log, and replays it into another channel.
+ *
+ * usage:
+ *   ipc-traffic record [-r] [-p prefix] [-n count] [-t seconds] name file
+ *     attaches to the channel as one more receiver, and logs the time, size & payload of each message,
+ *     until interrupted, or after 'count' messages or 'seconds'.
+ *   ipc-traffic replay [-r] [-p prefix] [-s speed] [-w receivers] [-l loops] name file
+ *     sends the logged messages into the channel, paced as recorded (speed 1, by default),
+ *     'speed' times as fast, or as fast as possible with speed 0;
+ *     waits for 'receivers' (1 by default) to connect first.
+ *   ipc-traffic info file
+ *     prints the counts & the distribution of the message sizes of a log.
+ *   -r  the channel is an ipc::route, otherwise an ipc::channel
+ *   -p  the prefix the channel was created with
+*/
+
+#include <signal.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libipc/ipc.h"
+
+#include "traffic_log.h"
+
+namespace {
+
+using steady_clock = std::chrono::steady_clock;
+
+std::atomic<bool> is_quit__ {false};
+
+struct options {
+    std::string command;
+    bool        route     = false;
+    std::string prefix;
+    std::string name;
+    std::string file;
+    std::uint64_t count   = 0;
+    double      seconds   = 0;
+    double      speed     = 1;
+    std::size_t receivers = 1;
+    unsigned    loops     = 1;
+};
+
+int usage() {
+    std::fprintf(stderr, "usage: ipc-traffic record [-r] [-p prefix] [-n count] [-t seconds] name file\n"
+                         "       ipc-traffic replay [-r] [-p prefix] [-s speed] [-w receivers] [-l loops] name file\n"
+                         "       ipc-traffic info file\n");
+    return -1;
+}
+
+std::uint64_t ns_since(steady_clock::time_point tp) {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - tp).count());
+}
+
+template <typename Chan>
+int record(options const &opt) {
+    ipc::prefix pref {opt.prefix.empty() ? nullptr : opt.prefix.c_str()};
+    Chan ch {pref, opt.name.c_str(), ipc::receiver};
+    if (!ch.valid()) {
+        std::fprintf(stderr, "fail connecting to %s\n", opt.name.c_str());
+        return -1;
+    }
+    traffic::writer log;
+    if (!log.open(opt.file.c_str(), opt.name.c_str(), opt.route)) {
+        std::fprintf(stderr, "fail opening %s\n", opt.file.c_str());
+        return -1;
+    }
+    std::fprintf(stderr, "recording %s into %s, ctrl+c to stop\n", opt.name.c_str(), opt.file.c_str());
+    auto start = steady_clock::now();
+    bool first = true;
+    steady_clock::time_point t0;
+    std::uint64_t n = 0;
+    while (!is_quit__.load(std::memory_order_acquire)) {
+        if ((opt.count != 0) && (n >= opt.count)) break;
+        if ((opt.seconds > 0) && (std::chrono::duration<double>(steady_clock::now() - start).count() >= opt.seconds)) break;
+        auto buf = ch.recv(100);
+        if (buf.empty()) continue;
+        if (first) {
+            t0    = steady_clock::now();
+            first = false;
+        }
+        if (!log.append(ns_since(t0), buf.data(), buf.size())) {
+            std::fprintf(stderr, "fail writing %s\n", opt.file.c_str());
+            return -1;
+        }
+        ++n;
+    }
+    auto const &h = log.header();
+    std::printf("recorded %llu messages, %llu bytes, in %.3f s\n",
+                static_cast<unsigned long long>(h.count), static_cast<unsigned long long>(h.bytes),
+                static_cast<double>(h.duration) / 1e9);
+    return 0;
+}
+
+template <typename Chan>
+int replay(options const &opt) {
+    traffic::reader log;
+    if (!log.open(opt.file.c_str())) {
+        std::fprintf(stderr, "fail reading %s\n", opt.file.c_str());
+        return -1;
+    }
+    ipc::prefix pref {opt.prefix.empty() ? nullptr : opt.prefix.c_str()};
+    Chan ch {pref, opt.name.c_str(), ipc::sender};
+    if (!ch.valid()) {
+        std::fprintf(stderr, "fail connecting to %s\n", opt.name.c_str());
+        return -1;
+    }
+    if ((opt.receivers != 0) && !ch.wait_for_recv(opt.receivers)) {
+        return -1;
+    }
+    std::uint64_t sent = 0, bytes = 0, failed = 0;
+    auto start = steady_clock::now();
+    for (unsigned loop = 0; (loop < opt.loops) && !is_quit__.load(std::memory_order_acquire); ++loop) {
+        auto t0 = steady_clock::now();
+        traffic::for_each(log, [&](traffic::record_t const &rec, void const *payload) {
+            if (is_quit__.load(std::memory_order_relaxed)) return false;
+            if (opt.speed > 0) {
+                auto due = t0 + std::chrono::nanoseconds(static_cast<std::int64_t>(static_cast<double>(rec.time) / opt.speed));
+                std::this_thread::sleep_until(due);
+            }
+            if (ch.send(payload, rec.size)) {
+                ++sent;
+                bytes += rec.size;
+            }
+            else ++failed;
+            return true;
+        });
+    }
+    double secs = std::chrono::duration<double>(steady_clock::now() - start).count();
+    std::printf("replayed %llu messages, %llu bytes, in %.3f s (%.1f msg/s, %.1f MB/s), %llu failed\n",
+                static_cast<unsigned long long>(sent), static_cast<unsigned long long>(bytes), secs,
+                static_cast<double>(sent) / secs, static_cast<double>(bytes) / secs / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(failed));
+    return (failed == 0) ? 0 : 1;
+}
+
+int info(options const &opt) {
+    traffic::reader log;
+    if (!log.open(opt.file.c_str())) {
+        std::fprintf(stderr, "fail reading %s\n", opt.file.c_str());
+        return -1;
+    }
+    auto const *h = reinterpret_cast<traffic::header_t const *>(log.data());
+    std::vector<std::uint32_t> sizes;
+    traffic::for_each(log, [&sizes](traffic::record_t const &rec, void const *) {
+        sizes.push_back(rec.size);
+        return true;
+    });
+    std::printf("%s (%s), %llu messages, %llu bytes, in %.3f s\n", h->name, h->route ? "route" : "channel",
+                static_cast<unsigned long long>(h->count), static_cast<unsigned long long>(h->bytes),
+                static_cast<double>(h->duration) / 1e9);
+    if (sizes.size() != h->count) {
+        std::printf("the log is cut off, %zu messages are readable\n", sizes.size());
+    }
+    if (sizes.empty()) return 0;
+    std::sort(sizes.begin(), sizes.end());
+    auto at = [&sizes](double q) {
+        return sizes[static_cast<std::size_t>(q * static_cast<double>(sizes.size() - 1))];
+    };
+    std::printf("sizes: min %u, p50 %u, p90 %u, p99 %u, max %u\n",
+                sizes.front(), at(0.5), at(0.9), at(0.99), sizes.back());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char ** argv) {
+    options opt;
+    if (argc < 2) return usage();
+    opt.command = argv[1];
+    std::vector<std::string> args;
+    for (int i = 2; i < argc; ++i) {
+        auto next = [&]() -> char const * { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        char const *v = nullptr;
+        if (std::strcmp(argv[i], "-r") == 0) {
+            opt.route = true;
+        } else if ((std::strcmp(argv[i], "-p") == 0) && (v = next())) {
+            opt.prefix = v;
+        } else if ((std::strcmp(argv[i], "-n") == 0) && (v = next())) {
+            opt.count = std::strtoull(v, nullptr, 10);
+        } else if ((std::strcmp(argv[i], "-t") == 0) && (v = next())) {
+            opt.seconds = std::strtod(v, nullptr);
+        } else if ((std::strcmp(argv[i], "-s") == 0) && (v = next())) {
+            opt.speed = std::strtod(v, nullptr);
+        } else if ((std::strcmp(argv[i], "-w") == 0) && (v = next())) {
+            opt.receivers = std::strtoul(v, nullptr, 10);
+        } else if ((std::strcmp(argv[i], "-l") == 0) && (v = next())) {
+            opt.loops = static_cast<unsigned>(std::strtoul(v, nullptr, 10));
+        } else if (argv[i][0] != '-') {
+            args.push_back(argv[i]);
+        } else {
+            return usage();
+        }
+    }
+
+    auto exit = [](int) {
+        is_quit__.store(true, std::memory_order_release);
+    };
+    ::signal(SIGINT , exit);
+    ::signal(SIGTERM, exit);
+
+    if (opt.command == "info") {
+        if (args.size() != 1) return usage();
+        opt.file = args[0];
+        return info(opt);
+    }
+    if ((args.size() != 2) || (opt.speed < 0)) return usage();
+    opt.name = args[0];
+    opt.file = args[1];
+    if (opt.command == "record") {
+        return opt.route ? record<ipc::route>(opt) : record<ipc::channel>(opt);
+    }
+    if (opt.command == "replay") {
+        return opt.route ? replay<ipc::route>(opt) : replay<ipc::channel>(opt);
+    }
+    return usage();
+}
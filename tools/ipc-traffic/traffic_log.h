@@ -0,0 +1,238 @@
+/*
+ * The binary log of the recorded traffic of a channel, written & read through a memory mapping.
+ *
+ * layout: header_t, then the records one after another, each of them:
+ *   record_t, the payload, padded to 8 bytes.
+ * The count in the header is updated after each record, so a recording killed halfway is still readable.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32)
+#include <cstdio>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace traffic {
+
+constexpr char          magic[8] = {'I', 'P', 'C', 'T', 'R', 'A', 'F', 'F'};
+constexpr std::uint32_t version  = 1;
+
+struct header_t {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t route;      // 1 if recorded from an ipc::route
+    std::uint64_t count;      // the records
+    std::uint64_t bytes;      // the payloads
+    std::uint64_t duration;   // ns, from the first record to the last one
+    char          name[64];   // the channel, for reference
+};
+
+struct record_t {
+    std::uint64_t time;       // ns since the first record
+    std::uint32_t size;       // of the payload
+    std::uint32_t reserved;
+};
+
+inline std::size_t padded(std::size_t size) noexcept {
+    return (size + 7) & ~std::size_t(7);
+}
+
+#if defined(_WIN32)
+
+/* Without a mapping here, the log is written & read with the C streams. */
+class writer {
+    std::FILE *fp_ = nullptr;
+    header_t   hdr_ {};
+
+public:
+    ~writer() { close(); }
+
+    bool open(char const *path, char const *name, bool route) {
+        if ((fp_ = std::fopen(path, "wb")) == nullptr) return false;
+        std::memcpy(hdr_.magic, magic, sizeof(magic));
+        hdr_.version = version;
+        hdr_.route   = route ? 1 : 0;
+        std::strncpy(hdr_.name, name, sizeof(hdr_.name) - 1);
+        return std::fwrite(&hdr_, sizeof(hdr_), 1, fp_) == 1;
+    }
+
+    bool append(std::uint64_t time, void const *data, std::size_t size) {
+        record_t rec {time, static_cast<std::uint32_t>(size), 0};
+        static char const zeros[8] {};
+        if ((std::fwrite(&rec, sizeof(rec), 1, fp_) != 1) ||
+            ((size != 0) && (std::fwrite(data, size, 1, fp_) != 1)) ||
+            ((padded(size) != size) && (std::fwrite(zeros, padded(size) - size, 1, fp_) != 1))) {
+            return false;
+        }
+        hdr_.count   += 1;
+        hdr_.bytes   += size;
+        hdr_.duration = time;
+        return true;
+    }
+
+    header_t const &header() const noexcept { return hdr_; }
+
+    void close() {
+        if (fp_ == nullptr) return;
+        std::fseek(fp_, 0, SEEK_SET);
+        std::fwrite(&hdr_, sizeof(hdr_), 1, fp_);
+        std::fclose(fp_);
+        fp_ = nullptr;
+    }
+};
+
+class reader {
+    std::vector<char> buf_;
+
+public:
+    bool open(char const *path) {
+        std::FILE *fp = std::fopen(path, "rb");
+        if (fp == nullptr) return false;
+        std::fseek(fp, 0, SEEK_END);
+        buf_.resize(static_cast<std::size_t>(std::ftell(fp)));
+        std::fseek(fp, 0, SEEK_SET);
+        bool ok = buf_.empty() || (std::fread(buf_.data(), buf_.size(), 1, fp) == 1);
+        std::fclose(fp);
+        return ok && valid();
+    }
+
+    char const *data() const noexcept { return buf_.data(); }
+    std::size_t size() const noexcept { return buf_.size(); }
+
+    bool valid() const noexcept {
+        return (size() >= sizeof(header_t)) && (std::memcmp(data(), magic, sizeof(magic)) == 0);
+    }
+};
+
+#else /*!_WIN32*/
+
+class writer {
+    int         fd_   = -1;
+    char       *base_ = nullptr;
+    std::size_t cap_  = 0; // the size of the file & mapping
+    std::size_t used_ = 0;
+
+    header_t *hdr() noexcept { return reinterpret_cast<header_t *>(base_); }
+
+    bool reserve(std::size_t size) {
+        if (used_ + size <= cap_) return true;
+        std::size_t cap = cap_;
+        while (cap < used_ + size) cap *= 2;
+        if (base_ != nullptr) ::munmap(base_, cap_);
+        base_ = nullptr;
+        if (::ftruncate(fd_, static_cast<off_t>(cap)) != 0) return false;
+        void *p = ::mmap(nullptr, cap, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) return false;
+        base_ = static_cast<char *>(p);
+        cap_  = cap;
+        return true;
+    }
+
+public:
+    ~writer() { close(); }
+
+    bool open(char const *path, char const *name, bool route) {
+        fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) return false;
+        cap_ = 1024 * 1024; // doubled whenever it is full
+        if (::ftruncate(fd_, static_cast<off_t>(cap_)) != 0) return false;
+        void *p = ::mmap(nullptr, cap_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) return false;
+        base_ = static_cast<char *>(p);
+        header_t h {};
+        std::memcpy(h.magic, magic, sizeof(magic));
+        h.version = version;
+        h.route   = route ? 1 : 0;
+        std::strncpy(h.name, name, sizeof(h.name) - 1);
+        std::memcpy(base_, &h, sizeof(h));
+        used_ = sizeof(h);
+        return true;
+    }
+
+    bool append(std::uint64_t time, void const *data, std::size_t size) {
+        if (!reserve(sizeof(record_t) + padded(size))) return false;
+        record_t rec {time, static_cast<std::uint32_t>(size), 0};
+        std::memcpy(base_ + used_, &rec, sizeof(rec));
+        if (size != 0) std::memcpy(base_ + used_ + sizeof(rec), data, size);
+        used_ += sizeof(record_t) + padded(size);
+        hdr()->count   += 1;
+        hdr()->bytes   += size;
+        hdr()->duration = time;
+        return true;
+    }
+
+    header_t const &header() const noexcept { return *reinterpret_cast<header_t const *>(base_); }
+
+    /* Cuts the file down to what has been written. */
+    void close() {
+        if (base_ != nullptr) ::munmap(base_, cap_);
+        base_ = nullptr;
+        if (fd_ < 0) return;
+        if (::ftruncate(fd_, static_cast<off_t>(used_)) != 0) {/* keeps the padding */}
+        ::close(fd_);
+        fd_ = -1;
+    }
+};
+
+class reader {
+    char       *base_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    ~reader() {
+        if (base_ != nullptr) ::munmap(base_, size_);
+    }
+
+    bool open(char const *path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if ((::fstat(fd, &st) != 0) || (st.st_size == 0)) {
+            ::close(fd);
+            return false;
+        }
+        void *p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base_ = static_cast<char *>(p);
+        size_ = static_cast<std::size_t>(st.st_size);
+        return valid();
+    }
+
+    char const *data() const noexcept { return base_; }
+    std::size_t size() const noexcept { return size_; }
+
+    bool valid() const noexcept {
+        return (size() >= sizeof(header_t)) && (std::memcmp(data(), magic, sizeof(magic)) == 0);
+    }
+};
+
+#endif/*!_WIN32*/
+
+/* Walks the records of a log, 'f(record_t const &, void const *payload)'. */
+template <typename F>
+std::uint64_t for_each(reader const &rd, F &&f) {
+    auto const *hdr = reinterpret_cast<header_t const *>(rd.data());
+    std::size_t pos = sizeof(header_t);
+    std::uint64_t n = 0;
+    for (; (n < hdr->count) && (pos + sizeof(record_t) <= rd.size()); ++n) {
+        record_t rec;
+        std::memcpy(&rec, rd.data() + pos, sizeof(rec));
+        if (pos + sizeof(record_t) + rec.size > rd.size()) break; // cut off
+        if (!f(rec, rd.data() + pos + sizeof(record_t))) return n + 1;
+        pos += sizeof(record_t) + padded(rec.size);
+    }
+    return n;
+}
+
+} // namespace traffic